@@ -0,0 +1,314 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Steers the pad UART interrupts onto the CPU that runs the main loop.
+
+#define _GNU_SOURCE
+
+#include "irq-affinity.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../clock/clock.h"
+#include "../stats/histogram.h"
+
+#define WAKEUP_SAMPLES 200
+#define WAKEUP_GAP_US 200   // Long enough for the reader to be asleep when the wake comes.
+
+static const char *proc_root = IRQ_AFFINITY_PROC_ROOT;
+
+void irq_affinity_set_proc_root(const char *root)
+{
+    proc_root = (root && *root) ? root : IRQ_AFFINITY_PROC_ROOT;
+}
+
+int irq_affinity_pin_self(int cpu)
+{
+    if (cpu == IRQ_AFFINITY_CURRENT) {
+        cpu = sched_getcpu();
+        if (cpu < 0) {
+            perror("sched_getcpu");
+            return -1;
+        }
+    }
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        fprintf(stderr, "Invalid CPU %d\n", cpu);
+        return -1;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof set, &set) != 0) {
+        fprintf(stderr, "Failed to pin to CPU%d: %s\n", cpu, strerror(errno));
+        return -1;
+    }
+    return cpu;
+}
+
+// Does the row mention name as a whole word (actions are comma/space separated)?
+static bool actions_match(const char *actions, const char *name)
+{
+    size_t len = strlen(name);
+    for (const char *p = actions; (p = strstr(p, name)) != NULL; p += len) {
+        bool start = p == actions || p[-1] == ' ' || p[-1] == ',' || p[-1] == '\t';
+        char end = p[len];
+        if (start && (end == '\0' || end == '\n' || end == ' ' || end == ',')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int find_irq_by_name(const char *name)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof path, "%s/interrupts", proc_root);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    // "uartN" is what the Allwinner vendor driver registers instead of "ttySN".
+    char alias[32] = "";
+    const char *digits = name + strcspn(name, "0123456789");
+    if (strncmp(name, "ttyS", 4) == 0 && *digits) {
+        snprintf(alias, sizeof alias, "uart%s", digits);
+    }
+
+    char line[512];
+    int irq = -1;
+    while (irq < 0 && fgets(line, sizeof line, f)) {
+        char *end;
+        long n = strtol(line, &end, 10);
+        if (end == line || *end != ':') {
+            continue; // Header, or IPI/NMI rows.
+        }
+        // Whole-word matches only, so the counts and chip columns cannot collide.
+        const char *actions = end + 1;
+        if (actions_match(actions, name) || (alias[0] && actions_match(actions, alias))) {
+            irq = (int)n;
+        }
+    }
+    fclose(f);
+    return irq;
+}
+
+int irq_affinity_find_irq(const char *tty_path)
+{
+    const char *base = strrchr(tty_path, '/');
+    int irq = find_irq_by_name(base ? base + 1 : tty_path);
+    if (irq >= 0) {
+        return irq;
+    }
+
+    char resolved[PATH_MAX];
+    if (realpath(tty_path, resolved) && strcmp(resolved, tty_path) != 0) {
+        base = strrchr(resolved, '/');
+        irq = find_irq_by_name(base ? base + 1 : resolved);
+    }
+    return irq;
+}
+
+static int read_affinity(const char *path, char *buf, size_t size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t r = read(fd, buf, size - 1);
+    close(fd);
+    if (r <= 0) {
+        return -1;
+    }
+    buf[r] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// The only CPU in a list such as "2", "0-3" or "0,2-3"; -1 if it names several or none.
+static int single_cpu(const char *list)
+{
+    int found = -1;
+    const char *p = list;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10);
+        if (end == p || lo < 0) {
+            return -1;
+        }
+        long hi = lo;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p || hi < lo) {
+                return -1;
+            }
+        }
+        if (hi != lo || (found >= 0 && found != lo)) {
+            return -1;
+        }
+        found = (int)lo;
+        if (*end == ',') {
+            ++end;
+        } else if (*end != '\0') {
+            return -1;
+        }
+        p = end;
+    }
+    return found;
+}
+
+static int write_affinity(const char *path, const char *list)
+{
+    int fd = open(path, O_WRONLY | O_TRUNC);
+    if (fd < 0) {
+        return -1;
+    }
+    int res = write(fd, list, strlen(list)) < 0 ? -1 : 0;
+    close(fd);
+    return res;
+}
+
+int irq_affinity_steer(const char *tty_path, int cpu, irq_affinity_prev_t *prev, FILE *out)
+{
+    irq_affinity_prev_t found = { .irq = -1, .cpu = -1, .list = "?" };
+    if (prev) {
+        *prev = found;
+    }
+    int irq = irq_affinity_find_irq(tty_path);
+    if (irq < 0) {
+        fprintf(out, "%s: no IRQ listed in %s/interrupts\n", tty_path, proc_root);
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    char after[IRQ_AFFINITY_LIST_LEN] = "";
+    char want[16];
+    snprintf(path, sizeof path, "%s/irq/%d/smp_affinity_list", proc_root, irq);
+    snprintf(want, sizeof want, "%d", cpu);
+    if (read_affinity(path, found.list, sizeof found.list) == 0) {
+        found.cpu = single_cpu(found.list);
+    }
+    if (found.cpu == cpu) {
+        fprintf(out, "%s: IRQ %d already on CPU%d\n", tty_path, irq, cpu);
+        if (prev) {
+            prev->cpu = cpu;
+        }
+        return irq;
+    }
+
+    if (write_affinity(path, want) != 0) {
+        fprintf(out, "%s: IRQ %d: failed to write %s: %s\n", tty_path, irq, path, strerror(errno));
+        return -1;
+    }
+    found.irq = irq;
+    if (prev) {
+        *prev = found;
+    }
+    if (read_affinity(path, after, sizeof after) != 0 || strcmp(after, want) != 0) {
+        fprintf(out, "%s: IRQ %d: affinity reads back as \"%s\", wanted %s\n", tty_path, irq, after, want);
+        return -1;
+    }
+    fprintf(out, "%s: IRQ %d affinity %s%s -> %s\n", tty_path, irq, found.list,
+            found.cpu < 0 && strcmp(found.list, "?") != 0 ? " (spread)" : "", after);
+    return irq;
+}
+
+int irq_affinity_restore(const irq_affinity_prev_t *prev, FILE *out)
+{
+    if (prev->irq < 0 || strcmp(prev->list, "?") == 0) {
+        return 0;
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof path, "%s/irq/%d/smp_affinity_list", proc_root, prev->irq);
+    if (write_affinity(path, prev->list) != 0) {
+        fprintf(out, "IRQ %d: failed to restore affinity %s: %s\n", prev->irq, prev->list, strerror(errno));
+        return -1;
+    }
+    fprintf(out, "IRQ %d affinity restored to %s\n", prev->irq, prev->list);
+    return 0;
+}
+
+typedef struct {
+    int cpu;
+    int go_fd;      // Reader -> waker: take the next sample.
+    int wake_fd;    // Waker -> reader: the timed wakeup.
+    bool stop;
+    bool pinned;    // The waker really runs on cpu.
+    int64_t sent_ns;
+} waker_t;
+
+static void *waker_main(void *arg)
+{
+    waker_t *w = arg;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    w->pinned = pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+
+    const struct timespec gap = { .tv_sec = 0, .tv_nsec = WAKEUP_GAP_US * 1000L };
+    uint64_t v;
+    while (read(w->go_fd, &v, sizeof v) == (ssize_t)sizeof v && !__atomic_load_n(&w->stop, __ATOMIC_ACQUIRE)) {
+        nanosleep(&gap, NULL);
+        __atomic_store_n(&w->sent_ns, clock_now_ns(), __ATOMIC_RELEASE);
+        v = 1;
+        if (write(w->wake_fd, &v, sizeof v) != (ssize_t)sizeof v) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+void irq_affinity_report_wakeup(int from_cpu, int to_cpu, FILE *out)
+{
+    waker_t w = { .cpu = from_cpu, .go_fd = eventfd(0, EFD_CLOEXEC), .wake_fd = eventfd(0, EFD_CLOEXEC) };
+    pthread_t thread;
+    if (w.go_fd < 0 || w.wake_fd < 0 || pthread_create(&thread, NULL, waker_main, &w) != 0) {
+        perror("wakeup probe");
+        if (w.go_fd >= 0) {
+            close(w.go_fd);
+        }
+        if (w.wake_fd >= 0) {
+            close(w.wake_fd);
+        }
+        return;
+    }
+
+    histogram_t hist;
+    histogram_reset(&hist);
+    for (int i = 0; i < WAKEUP_SAMPLES; ++i) {
+        uint64_t v = 1;
+        if (write(w.go_fd, &v, sizeof v) != (ssize_t)sizeof v ||
+            read(w.wake_fd, &v, sizeof v) != (ssize_t)sizeof v) {
+            break;
+        }
+        int64_t lat = clock_now_ns() - __atomic_load_n(&w.sent_ns, __ATOMIC_ACQUIRE);
+        histogram_add(&hist, (uint64_t)(lat > 0 ? lat : 0));
+    }
+    uint64_t v = 1;
+    __atomic_store_n(&w.stop, true, __ATOMIC_RELEASE);
+    if (write(w.go_fd, &v, sizeof v) == (ssize_t)sizeof v) {
+        pthread_join(thread, NULL);
+    } else {
+        pthread_detach(thread);
+    }
+    close(w.go_fd);
+    close(w.wake_fd);
+
+    char label[48];
+    snprintf(label, sizeof label, "wakeup CPU%d->CPU%d%s", from_cpu, to_cpu,
+             w.pinned ? "" : " (CPU offline, unpinned)");
+    histogram_print(&hist, label, out);
+}
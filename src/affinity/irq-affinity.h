@@ -0,0 +1,78 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdio.h>
+
+#define IRQ_AFFINITY_PROC_ROOT "/proc"
+#define IRQ_AFFINITY_CURRENT (-1)   // Pin to whichever CPU the daemon starts on.
+#define IRQ_AFFINITY_LIST_LEN 64
+
+/**
+ * An interrupt's affinity from before it was steered, kept so it can be put back.
+ */
+typedef struct {
+    int irq;                            // IRQ whose affinity was changed, -1 if none.
+    int cpu;                            // The one CPU it was on, -1 if spread or unknown.
+    char list[IRQ_AFFINITY_LIST_LEN];   // smp_affinity_list as found, e.g. "0-3".
+} irq_affinity_prev_t;
+
+/**
+ * Point /proc lookups (interrupts, irq/N/smp_affinity_list) at another tree (e.g. a mock).
+ *
+ * @param root Directory laid out like /proc; NULL restores the default.
+ * @return void
+ */
+void irq_affinity_set_proc_root(const char *root);
+
+/**
+ * Pin the calling thread to one CPU.
+ *
+ * @param cpu CPU number, or IRQ_AFFINITY_CURRENT for the CPU it is running on now.
+ * @return The CPU pinned to, -1 on error.
+ */
+int irq_affinity_pin_self(int cpu);
+
+/**
+ * Find the interrupt of a serial port in <proc>/interrupts. The port's name (ttyS3, also
+ * tried as uart3 for the vendor driver) is matched against the action column, first as
+ * given and then after resolving symlinks. The kernel only lists it while the port is open.
+ *
+ * @param tty_path Serial device path, e.g. /dev/ttyS3.
+ * @return IRQ number, -1 if not listed.
+ */
+int irq_affinity_find_irq(const char *tty_path);
+
+/**
+ * Route a serial port's interrupt to one CPU via <proc>/irq/N/smp_affinity_list and read
+ * it back. Logs the old and new affinity to out; a list naming several CPUs is "spread".
+ *
+ * @param tty_path Serial device path.
+ * @param cpu      Target CPU.
+ * @param prev     Receives the previous affinity for irq_affinity_restore(); may be NULL.
+ * @param out      Log stream.
+ * @return IRQ number on success, -1 if the IRQ was not found or the write did not stick.
+ */
+int irq_affinity_steer(const char *tty_path, int cpu, irq_affinity_prev_t *prev, FILE *out);
+
+/**
+ * Write back the affinity list irq_affinity_steer() found. No-op if nothing was changed.
+ *
+ * @param prev Previous affinity.
+ * @param out  Log stream.
+ * @return 0 on success or no-op, -1 if the write failed.
+ */
+int irq_affinity_restore(const irq_affinity_prev_t *prev, FILE *out);
+
+/**
+ * Measure thread wakeup latency from one CPU to another (eventfd write -> blocked read
+ * returns), as a stand-in for the IRQ/flip-buffer -> reader wakeup. Prints a histogram.
+ * The calling thread must already run on to_cpu.
+ *
+ * @param from_cpu CPU the waker thread is pinned to.
+ * @param to_cpu   CPU of the calling thread (label only).
+ * @param out      Destination stream.
+ * @return void
+ */
+void irq_affinity_report_wakeup(int from_cpu, int to_cpu, FILE *out);
@@ -0,0 +1,155 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Helpers shared by the benches that drive a child daemon through pty pads.
+
+#define _GNU_SOURCE
+
+#include "bench-daemon.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../clock/clock.h"
+#include "../gpio/gpio.h"
+
+int bench_open_pty(int *master_fd, char *slave_name, size_t len)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (master < 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+    if (grantpt(master) != 0 || unlockpt(master) != 0 || ptsname_r(master, slave_name, len) != 0) {
+        perror("pty setup");
+        close(master);
+        return -1;
+    }
+    *master_fd = master;
+    return 0;
+}
+
+int bench_mock_gpio_tree(char *root)
+{
+    static const int lines[] = { GPIO_LEFT_ENABLE, GPIO_RIGHT_ENABLE, GPIO_RUMBLE, GPIO_DIP_SWITCH, GPIO_5V_ENABLE };
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof lines / sizeof lines[0]; ++i) {
+        if (gpio_mock_create_line(root, lines[i], "out", 0) != 0) {
+            perror("mock gpio tree");
+            gpio_mock_remove_tree(root);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+pid_t bench_spawn_daemon(char *const argv[])
+{
+    return bench_spawn_daemon_rt(argv, 0);
+}
+
+static void child_fail(int err_fd)
+{
+    int err = errno;
+    if (write(err_fd, &err, sizeof err) < 0) {
+        // Nothing left to report to; the parent sees EOF and a dead child.
+    }
+    _exit(127);
+}
+
+pid_t bench_spawn_daemon_rt(char *const argv[], int rt_priority)
+{
+    // A close-on-exec pipe carries errno from a failed child setup; EOF means it exec'd.
+    int err_pipe[2];
+    if (pipe2(err_pipe, O_CLOEXEC) != 0) {
+        perror("pipe2");
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(err_pipe[0]);
+        struct sched_param rt = { .sched_priority = rt_priority };
+        if (rt_priority > 0 && sched_setscheduler(0, SCHED_FIFO, &rt) != 0) {
+            child_fail(err_pipe[1]);
+        }
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+            close(devnull);
+        }
+        execv("/proc/self/exe", argv);
+        child_fail(err_pipe[1]);
+    }
+
+    close(err_pipe[1]);
+    int err = 0;
+    ssize_t n;
+    do {
+        n = read(err_pipe[0], &err, sizeof err);
+    } while (n < 0 && errno == EINTR);
+    close(err_pipe[0]);
+    if (n == (ssize_t)sizeof err) {
+        waitpid(pid, NULL, 0);
+        errno = err;
+        return -1;
+    }
+    return pid;
+}
+
+int bench_next_event(bench_event_reader_t *r, int timeout_ms, struct input_event *ev)
+{
+    int64_t deadline = clock_now_ns() + (int64_t)timeout_ms * 1000000LL;
+    while (r->len < sizeof *ev) {
+        int64_t left_ms = (deadline - clock_now_ns()) / 1000000LL;
+        struct pollfd pfd = { .fd = r->fd, .events = POLLIN };
+        int ret = poll(&pfd, 1, left_ms > 0 ? (int)left_ms : 0);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return ret < 0 ? -1 : 0;
+        }
+        ssize_t n = read(r->fd, r->buf + r->len, sizeof r->buf - r->len);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        r->len += (size_t)n;
+    }
+    memcpy(ev, r->buf, sizeof *ev);
+    r->len -= sizeof *ev;
+    memmove(r->buf, r->buf + sizeof *ev, r->len);
+    return 1;
+}
+
+bool bench_settle(bench_event_reader_t *r, int first_ms, int quiet_ms)
+{
+    struct input_event ev;
+    if (bench_next_event(r, first_ms, &ev) != 1) {
+        fprintf(stderr, "bench: daemon never emitted its initial state\n");
+        return false;
+    }
+    int res;
+    while ((res = bench_next_event(r, quiet_ms, &ev)) == 1) {
+    }
+    return res == 0;
+}
@@ -0,0 +1,78 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <linux/input.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * Reassembles input_events from a stream that may split them (pipe reads).
+ */
+typedef struct {
+    int fd;
+    uint8_t buf[sizeof(struct input_event) * 16];
+    size_t len;
+} bench_event_reader_t;
+
+/**
+ * Open a pty pair to stand in for one pad's serial port.
+ *
+ * @param master_fd  Receives the master side (written by the bench).
+ * @param slave_name Receives the slave path (handed to the daemon).
+ * @param len        Size of slave_name.
+ * @return 0 on success, -1 on error.
+ */
+int bench_open_pty(int *master_fd, char *slave_name, size_t len);
+
+/**
+ * Create a mock sysfs GPIO tree with every line the daemon drives.
+ *
+ * @param root mkdtemp() template, replaced with the created directory. The caller removes
+ *             it with gpio_mock_remove_tree() once the daemon is gone.
+ * @return 0 on success (nothing is left behind on error), -1 on error.
+ */
+int bench_mock_gpio_tree(char *root);
+
+/**
+ * Run this binary again as a daemon child with stdout/stderr silenced.
+ *
+ * @param argv NULL-terminated argument vector (argv[0] included).
+ * @return Child pid, -1 if fork failed.
+ */
+pid_t bench_spawn_daemon(char *const argv[]);
+
+/**
+ * Like bench_spawn_daemon(), with the child switched to SCHED_FIFO before it execs, so the
+ * daemon runs under the policy from its first instruction.
+ *
+ * @param argv        NULL-terminated argument vector (argv[0] included).
+ * @param rt_priority SCHED_FIFO priority; 0 keeps the inherited policy.
+ * @return Child pid, -1 with errno set if fork failed or the child could not take the
+ *         policy or exec (the child is reaped in that case).
+ */
+pid_t bench_spawn_daemon_rt(char *const argv[], int rt_priority);
+
+/**
+ * Next complete event from a daemon's event stream.
+ *
+ * @param r          Reader.
+ * @param timeout_ms Longest wait for the event to complete.
+ * @param ev         Destination.
+ * @return 1 on success, 0 on timeout, -1 on EOF or error.
+ */
+int bench_next_event(bench_event_reader_t *r, int timeout_ms, struct input_event *ev);
+
+/**
+ * Swallow a fresh daemon's priming burst: wait up to first_ms for its first event, then
+ * until the stream has been quiet for quiet_ms.
+ *
+ * @param r        Reader.
+ * @param first_ms Wait for the first event.
+ * @param quiet_ms Quiet period that ends the burst.
+ * @return true once settled, false if nothing came or the stream closed.
+ */
+bool bench_settle(bench_event_reader_t *r, int first_ms, int quiet_ms);
@@ -0,0 +1,301 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Energy bench: real-time trace replay into child daemons while sampling power_supply counters.
+
+#define _GNU_SOURCE
+
+#include "energy-bench.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../clock/clock.h"
+#include "../gpio/gpio.h"
+#include "../sim/trace.h"
+#include "bench-daemon.h"
+
+#define ENERGY_SAMPLE_MS 100
+#define ENERGY_SETTLE_MS 500
+#define ENERGY_MAX_ARGS 32
+
+typedef struct {
+    const char *power_dir;
+    volatile bool stop;
+    bool have_power;        // current_now and voltage_now were readable.
+    bool have_energy;       // energy_now was readable at both ends.
+    double energy_j;        // Integrated I*V.
+    double energy_now_j;    // energy_now delta.
+    double peak_w;
+    double seconds;         // Time covered by the integration.
+    unsigned int samples;
+} power_sampler_t;
+
+typedef struct {
+    uint64_t cpu_ns;
+    uint64_t ctx_switches;
+} proc_counters_t;
+
+static bool read_long(const char *dir, const char *node, long long *out)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof path, "%s/%s", dir, node);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    bool ok = fscanf(f, "%lld", out) == 1;
+    fclose(f);
+    return ok;
+}
+
+static void *sampler_main(void *arg)
+{
+    power_sampler_t *s = arg;
+    long long energy_start = 0;
+    long long energy_end = 0;
+    bool energy_ok = read_long(s->power_dir, "energy_now", &energy_start);
+
+    int64_t last = clock_now_ns();
+    s->have_power = true;
+    while (!s->stop) {
+        clock_sleep_ms(ENERGY_SAMPLE_MS);
+        long long ua = 0;
+        long long uv = 0;
+        if (!read_long(s->power_dir, "current_now", &ua) || !read_long(s->power_dir, "voltage_now", &uv)) {
+            s->have_power = false;
+            continue;
+        }
+        int64_t now = clock_now_ns();
+        // Drivers disagree on the sign of a discharging current.
+        double watts = (double)llabs(ua) * 1e-6 * (double)uv * 1e-6;
+        s->energy_j += watts * (double)(now - last) / 1e9;
+        s->seconds += (double)(now - last) / 1e9;
+        if (watts > s->peak_w) {
+            s->peak_w = watts;
+        }
+        s->samples++;
+        last = now;
+    }
+
+    if (energy_ok && read_long(s->power_dir, "energy_now", &energy_end)) {
+        s->have_energy = true;
+        s->energy_now_j = (double)(energy_start - energy_end) * 3.6e-3; // uWh -> J
+    }
+    s->have_power = s->have_power && s->samples > 0;
+    return NULL;
+}
+
+// On-CPU time from schedstat (ns) with a utime+stime fallback, plus context switches.
+static void read_proc_counters(pid_t pid, proc_counters_t *c)
+{
+    char path[64];
+    memset(c, 0, sizeof *c);
+
+    snprintf(path, sizeof path, "/proc/%d/schedstat", (int)pid);
+    FILE *f = fopen(path, "r");
+    unsigned long long ns = 0;
+    if (f && fscanf(f, "%llu", &ns) == 1) {
+        c->cpu_ns = ns;
+    } else {
+        if (f) {
+            fclose(f);
+        }
+        snprintf(path, sizeof path, "/proc/%d/stat", (int)pid);
+        f = fopen(path, "r");
+        unsigned long utime = 0;
+        unsigned long stime = 0;
+        if (f && fscanf(f, "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                        &utime, &stime) == 2) {
+            c->cpu_ns = (uint64_t)(utime + stime) * (1000000000ULL / (uint64_t)sysconf(_SC_CLK_TCK));
+        }
+    }
+    if (f) {
+        fclose(f);
+    }
+
+    snprintf(path, sizeof path, "/proc/%d/status", (int)pid);
+    f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+    char line[128];
+    unsigned long long n;
+    while (fgets(line, sizeof line, f)) {
+        if (sscanf(line, "voluntary_ctxt_switches: %llu", &n) == 1 ||
+            sscanf(line, "nonvoluntary_ctxt_switches: %llu", &n) == 1) {
+            c->ctx_switches += n;
+        }
+    }
+    fclose(f);
+}
+
+static pid_t spawn_daemon(const char *config, const char *left, const char *right, const char *gpio_root)
+{
+    char args[512];
+    char left_arg[PATH_MAX + 16];
+    char right_arg[PATH_MAX + 16];
+    char gpio_arg[PATH_MAX + 16];
+    char *argv[ENERGY_MAX_ARGS];
+    int argc = 0;
+
+    snprintf(args, sizeof args, "%s", config);
+    snprintf(left_arg, sizeof left_arg, "--left-serial=%s", left);
+    snprintf(right_arg, sizeof right_arg, "--right-serial=%s", right);
+    snprintf(gpio_arg, sizeof gpio_arg, "--gpio-root=%s", gpio_root);
+
+    argv[argc++] = "trimui_inputd";
+    for (char *save = NULL, *tok = strtok_r(args, " ", &save);
+         tok && argc < ENERGY_MAX_ARGS - 6; tok = strtok_r(NULL, " ", &save)) {
+        argv[argc++] = tok;
+    }
+    argv[argc++] = left_arg;
+    argv[argc++] = right_arg;
+    argv[argc++] = gpio_arg;
+    argv[argc++] = "--null-output";
+    argv[argc++] = "--control=";
+    argv[argc] = NULL;
+    return bench_spawn_daemon(argv);
+}
+
+// Write the trace's serial records to the pads at their recorded offsets.
+static int64_t replay_trace(const char *trace_path, int left_fd, int right_fd)
+{
+    trace_reader_t reader;
+    if (trace_open(&reader, trace_path) != 0) {
+        return -1;
+    }
+
+    trace_record_t rec;
+    int64_t first_ns = -1;
+    int64_t start = clock_now_ns();
+    int64_t last_offset = 0;
+    while (trace_next(&reader, &rec) == 1) {
+        if (first_ns < 0) {
+            first_ns = rec.t_ns;
+        }
+        last_offset = rec.t_ns - first_ns;
+        int64_t due = start + last_offset;
+        int64_t now = clock_now_ns();
+        if (due > now) {
+            struct timespec ts = { .tv_sec = (time_t)((due - now) / 1000000000LL),
+                                   .tv_nsec = (long)((due - now) % 1000000000LL) };
+            nanosleep(&ts, NULL);
+        }
+        if (rec.kind == TRACE_END) {
+            break;
+        }
+        int fd = (rec.kind == TRACE_SERIAL_LEFT) ? left_fd : (rec.kind == TRACE_SERIAL_RIGHT) ? right_fd : -1;
+        if (fd >= 0 && write(fd, rec.data, rec.len) < 0) {
+            perror("pty write");
+        }
+    }
+    trace_close(&reader);
+    return clock_now_ns() - start;
+}
+
+static bool run_config(const char *trace_path, const char *power_dir, const char *config,
+                       const char *gpio_root)
+{
+    int left_fd = -1;
+    int right_fd = -1;
+    char left_name[64];
+    char right_name[64];
+    if (bench_open_pty(&left_fd, left_name, sizeof left_name) != 0) {
+        return false;
+    }
+    if (bench_open_pty(&right_fd, right_name, sizeof right_name) != 0) {
+        close(left_fd);
+        return false;
+    }
+
+    pid_t pid = spawn_daemon(config, left_name, right_name, gpio_root);
+    if (pid < 0) {
+        close(left_fd);
+        close(right_fd);
+        return false;
+    }
+    clock_sleep_ms(ENERGY_SETTLE_MS);
+
+    power_sampler_t sampler = { .power_dir = power_dir };
+    pthread_t sampler_thread;
+    bool sampling = pthread_create(&sampler_thread, NULL, sampler_main, &sampler) == 0;
+
+    proc_counters_t before;
+    proc_counters_t after;
+    read_proc_counters(pid, &before);
+    int64_t elapsed = replay_trace(trace_path, left_fd, right_fd);
+    read_proc_counters(pid, &after);
+
+    if (sampling) {
+        sampler.stop = true;
+        pthread_join(sampler_thread, NULL);
+    }
+
+    int status = 0;
+    kill(pid, SIGTERM);
+    waitpid(pid, &status, 0);
+    close(left_fd);
+    close(right_fd);
+
+    bool exited_early = WIFEXITED(status) && WEXITSTATUS(status) != 0;
+    if (elapsed <= 0 || exited_early) {
+        fprintf(stderr, "  [%s] failed (%s)\n", config,
+                elapsed <= 0 ? "trace replay" : "daemon exited early");
+        return false;
+    }
+
+    double secs = (double)elapsed / 1e9;
+    double cpu_ms = (double)(after.cpu_ns - before.cpu_ns) / 1e6;
+    double wakeups = (double)(after.ctx_switches - before.ctx_switches) / secs;
+    fprintf(stderr, "  [%s]\n    %.1f s, cpu %.1f ms (%.2f%%), %.0f wakeups/s", config, secs, cpu_ms,
+            cpu_ms / (secs * 10.0), wakeups);
+    if (sampler.have_power) {
+        fprintf(stderr, ", %.1f mW avg, %.1f mW peak, %.3f J", sampler.energy_j / sampler.seconds * 1e3,
+                sampler.peak_w * 1e3, sampler.energy_j);
+    } else {
+        fprintf(stderr, ", power n/a");
+    }
+    if (sampler.have_energy) {
+        fprintf(stderr, " (energy_now %.3f J)", sampler.energy_now_j);
+    }
+    fprintf(stderr, "\n");
+    return true;
+}
+
+int energy_bench_run(const char *trace_path, const char *power_dir,
+                     const char *const *configs, size_t config_count)
+{
+    static const char *const default_configs[] = { "--poll-timeout=1", "--poll-timeout=0" };
+    if (config_count == 0) {
+        configs = default_configs;
+        config_count = sizeof default_configs / sizeof default_configs[0];
+    }
+
+    // The motor and pad rails stay on a mock tree: only the daemon's own cost is measured.
+    char gpio_root[] = "/tmp/tsp-energy-XXXXXX";
+    if (bench_mock_gpio_tree(gpio_root) != 0) {
+        return 1;
+    }
+
+    fprintf(stderr, "Energy bench: %s, power_supply %s, %zu configurations\n",
+            trace_path, power_dir, config_count);
+    int failures = 0;
+    for (size_t i = 0; i < config_count; ++i) {
+        if (!run_config(trace_path, power_dir, configs[i], gpio_root)) {
+            ++failures;
+        }
+    }
+    gpio_mock_remove_tree(gpio_root);
+    return failures ? 1 : 0;
+}
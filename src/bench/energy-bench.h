@@ -0,0 +1,23 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stddef.h>
+
+#define ENERGY_POWER_SUPPLY_DEFAULT "/sys/class/power_supply/axp2202-battery"
+#define ENERGY_MAX_CONFIGS 8
+
+/**
+ * Replay a trace's serial input in real time into a daemon instance per configuration
+ * (pty pads, no uinput device, mock GPIO tree) while sampling the battery's
+ * current_now/voltage_now/energy_now and the daemon's CPU time and context switches.
+ *
+ * @param trace_path   Recorded trace; only its L/R serial records are replayed.
+ * @param power_dir    power_supply directory (sysfs or a mock with the same files).
+ * @param configs      Extra daemon arguments per configuration, space separated.
+ * @param config_count Number of configurations; 0 compares the default poll timeouts.
+ * @return 0 if every configuration ran, 1 otherwise.
+ */
+int energy_bench_run(const char *trace_path, const char *power_dir,
+                     const char *const *configs, size_t config_count);
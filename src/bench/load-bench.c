@@ -0,0 +1,519 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Latency-under-load bench: contention hogs plus a real daemon child fed through pty pads.
+
+#define _GNU_SOURCE
+
+#include "load-bench.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/input.h>
+#include <linux/magic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/vfs.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../clock/clock.h"
+#include "../gpio/gpio.h"
+#include "../serial/serial-joystick.h"
+#include "../stats/histogram.h"
+#include "bench-daemon.h"
+
+#define BENCH_DEFAULT_FRAMES 1000
+#define BENCH_DEFAULT_RATE_HZ 250
+#define BENCH_MAX_FRAMES 65535
+#define BENCH_MAX_HOGS 64
+#define BENCH_IDLE_TIMEOUT_MS 200
+#define BENCH_START_TIMEOUT_MS 5000
+#define BENCH_SETTLE_MS 300
+#define BENCH_RT_PRIORITY 50
+#define BENCH_SEQ_WINDOW 256        // Frames one report may skip and still be matched.
+#define HOG_MEM_BYTES (32u * 1024u * 1024u)
+#define HOG_IO_BYTES (64u * 1024u)
+
+// Daemon configurations compared under the same load.
+typedef enum {
+    LOAD_MODE_DEFAULT = 0,
+    LOAD_MODE_TIMEOUT,
+    LOAD_MODE_BOOST,
+    LOAD_MODE_REALTIME,
+    LOAD_MODE_COUNT
+} load_mode_t;
+
+static const char *const load_mode_names[LOAD_MODE_COUNT] = {
+    "default", "timeout", "boost", "realtime"
+};
+
+typedef struct {
+    unsigned int cpu_hogs;
+    unsigned int mem_hogs;
+    unsigned int io_hogs;
+    unsigned int frames;
+    unsigned int rate_hz;
+    unsigned int modes;             // Bitmask of load_mode_t.
+    const char *io_dir;             // Where the I/O hogs write (NULL = pick a block-backed one).
+} bench_cfg_t;
+
+typedef struct {
+    const bench_cfg_t *cfg;
+    int master_fd;                  // Right pad pty; the sequence number rides in the buttons.
+    int64_t *send_ns;               // Per-sequence write time, 0 until the feeder sent it.
+    volatile bool feeder_done;
+} bench_run_t;
+
+static const char *hog_io_dir;
+
+static bool parse_spec(char *spec, bench_cfg_t *cfg)
+{
+    enum { SPEC_CPU, SPEC_MEM, SPEC_IO, SPEC_FRAMES, SPEC_RATE, SPEC_MODE, SPEC_IODIR };
+    char *const tokens[] = { "cpu", "mem", "io", "frames", "rate", "mode", "iodir", NULL };
+    unsigned int chosen_modes = 0;
+
+    while (spec && *spec) {
+        char *value = NULL;
+        int key = getsubopt(&spec, tokens, &value);
+        if (key < 0 || value == NULL) {
+            fprintf(stderr, "bench: bad option '%s'\n", value ? value : "?");
+            return false;
+        }
+        if (key == SPEC_IODIR) {
+            cfg->io_dir = value;
+            continue;
+        }
+        if (key == SPEC_MODE) {
+            int m;
+            for (m = 0; m < LOAD_MODE_COUNT; ++m) {
+                if (strcmp(value, load_mode_names[m]) == 0) {
+                    break;
+                }
+            }
+            if (m == LOAD_MODE_COUNT) {
+                fprintf(stderr, "bench: unknown mode '%s'\n", value);
+                return false;
+            }
+            chosen_modes |= 1u << m;
+            continue;
+        }
+
+        char *end = NULL;
+        unsigned long n = strtoul(value, &end, 10);
+        if (end == value || *end != '\0') {
+            fprintf(stderr, "bench: '%s' is not a number\n", value);
+            return false;
+        }
+        switch (key) {
+        case SPEC_CPU:
+            cfg->cpu_hogs = (unsigned int)n;
+            break;
+        case SPEC_MEM:
+            cfg->mem_hogs = (unsigned int)n;
+            break;
+        case SPEC_IO:
+            cfg->io_hogs = (unsigned int)n;
+            break;
+        case SPEC_FRAMES:
+            cfg->frames = (unsigned int)n;
+            break;
+        case SPEC_RATE:
+            cfg->rate_hz = (unsigned int)n;
+            break;
+        }
+    }
+
+    if (chosen_modes) {
+        cfg->modes = chosen_modes;
+    }
+    if (cfg->frames == 0 || cfg->frames > BENCH_MAX_FRAMES || cfg->rate_hz == 0) {
+        fprintf(stderr, "bench: frames must be 1..%d and rate non-zero\n", BENCH_MAX_FRAMES);
+        return false;
+    }
+    if (cfg->cpu_hogs + cfg->mem_hogs + cfg->io_hogs > BENCH_MAX_HOGS) {
+        fprintf(stderr, "bench: at most %d hogs\n", BENCH_MAX_HOGS);
+        return false;
+    }
+    return true;
+}
+
+static bool is_ram_backed(const char *dir)
+{
+    struct statfs fs;
+    return statfs(dir, &fs) == 0 && (fs.f_type == TMPFS_MAGIC || fs.f_type == RAMFS_MAGIC);
+}
+
+// fsync on tmpfs is free, so the I/O hogs need a directory on a real block device.
+static const char *pick_io_dir(void)
+{
+    static const char *const candidates[] = { "/mnt/UDISK", "/var/tmp", "." };
+    for (size_t i = 0; i < sizeof candidates / sizeof candidates[0]; ++i) {
+        if (access(candidates[i], W_OK) == 0 && !is_ram_backed(candidates[i])) {
+            return candidates[i];
+        }
+    }
+    return ".";
+}
+
+// --- Contention stand-ins (forked so they compete as separate tasks) ---
+
+static void hog_cpu(void)
+{
+    volatile uint64_t x = 0;
+    for (;;) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+}
+
+static void hog_mem(void)
+{
+    uint8_t *a = malloc(HOG_MEM_BYTES);
+    uint8_t *b = malloc(HOG_MEM_BYTES);
+    if (!a || !b) {
+        _exit(1);
+    }
+    memset(a, 0x5A, HOG_MEM_BYTES);
+    for (;;) {
+        memcpy(b, a, HOG_MEM_BYTES);
+        memcpy(a, b, HOG_MEM_BYTES);
+    }
+}
+
+static void hog_io(void)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof path, "%s/trimui_inputd_hog-XXXXXX", hog_io_dir);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        _exit(1);
+    }
+    unlink(path);
+
+    static uint8_t block[HOG_IO_BYTES];
+    memset(block, 0xA5, sizeof block);
+    for (unsigned int i = 0;; ++i) {
+        if (write(fd, block, sizeof block) < 0 || fsync(fd) < 0) {
+            _exit(1);
+        }
+        // Keep the file bounded; the point is the fsync traffic, not the disk usage.
+        if ((i & 0xFF) == 0xFF) {
+            if (ftruncate(fd, 0) < 0 || lseek(fd, 0, SEEK_SET) < 0) {
+                _exit(1);
+            }
+        }
+    }
+}
+
+static unsigned int spawn_hogs(void (*body)(void), unsigned int count, pid_t *pids, unsigned int used)
+{
+    pid_t parent = getpid();
+    for (unsigned int i = 0; i < count; ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != parent) {
+                _exit(0);
+            }
+            body();
+            _exit(0);
+        }
+        pids[used++] = pid;
+    }
+    return used;
+}
+
+static void stop_hogs(pid_t *pids, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i) {
+        kill(pids[i], SIGKILL);
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        waitpid(pids[i], NULL, 0);
+    }
+}
+
+// --- Pad simulator ---
+
+// Every frame changes the right pad's buttons, so every frame the daemon handles produces
+// a report. The low 8 bits of (seq + 1) are the button byte; seq 0 must differ from idle.
+static uint8_t seq_buttons(unsigned int seq)
+{
+    return (uint8_t)(seq + 1);
+}
+
+static void *feeder_main(void *arg)
+{
+    bench_run_t *run = arg;
+    const int64_t period_ns = 1000000000LL / run->cfg->rate_hz;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (unsigned int seq = 0; seq < run->cfg->frames; ++seq) {
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        // Centered stick: only the buttons move.
+        uint8_t frame[SERIAL_FRAME_LEN] = { 0xFF, 0x01, seq_buttons(seq), 0x08, 0x00, 0x08, 0x00 };
+        __atomic_store_n(&run->send_ns[seq], clock_now_ns(), __ATOMIC_RELEASE);
+        if (write(run->master_fd, frame, sizeof frame) != (ssize_t)sizeof frame) {
+            perror("pty write");
+            break;
+        }
+    }
+    run->feeder_done = true;
+    return NULL;
+}
+
+// --- Reader side: the daemon's reports on its event sink ---
+
+// Right pad button byte bit for a key code, as the daemon maps it (0 if not a right pad key).
+static uint8_t right_button_mask(uint16_t code)
+{
+    static const struct {
+        uint16_t code;
+        uint8_t mask;
+    } map[] = {
+        { BTN_TR, 0x01u }, { BTN_TR2, 0x02u }, { BTN_NORTH, 0x04u }, { BTN_WEST, 0x08u },
+        { BTN_SOUTH, 0x10u }, { BTN_EAST, 0x20u }, { BTN_SELECT, 0x40u }, { BTN_START, 0x80u },
+    };
+    for (size_t i = 0; i < sizeof map / sizeof map[0]; ++i) {
+        if (map[i].code == code) {
+            return map[i].mask;
+        }
+    }
+    return 0;
+}
+
+typedef struct {
+    histogram_t latency;
+    unsigned int surfaced;
+} load_result_t;
+
+// Match reports to frames until every frame surfaced or the stream went quiet after the feeder.
+static bool collect(bench_run_t *run, bench_event_reader_t *reader, load_result_t *res)
+{
+    uint8_t buttons = 0;
+    bool changed = false;
+    int next_seq = 0;
+
+    while (res->surfaced < run->cfg->frames) {
+        struct input_event ev;
+        int rd = bench_next_event(reader, BENCH_IDLE_TIMEOUT_MS, &ev);
+        if (rd < 0) {
+            fprintf(stderr, "bench: event stream closed (daemon exited?)\n");
+            return false;
+        }
+        if (rd == 0) {
+            if (run->feeder_done) {
+                break;
+            }
+            continue;
+        }
+        if (ev.type == EV_KEY) {
+            uint8_t mask = right_button_mask(ev.code);
+            buttons = ev.value ? (uint8_t)(buttons | mask) : (uint8_t)(buttons & ~mask);
+            changed |= mask != 0;
+            continue;
+        }
+        if (ev.type != EV_SYN || ev.code != SYN_REPORT || !changed) {
+            continue;
+        }
+        changed = false;
+        int64_t done = clock_now_ns();
+
+        // The report shows the newest frame handled; frames skipped in between were coalesced.
+        for (int seq = next_seq; seq < (int)run->cfg->frames && seq < next_seq + BENCH_SEQ_WINDOW; ++seq) {
+            int64_t sent = __atomic_load_n(&run->send_ns[seq], __ATOMIC_ACQUIRE);
+            if (sent == 0) {
+                break;
+            }
+            if (seq_buttons((unsigned int)seq) == buttons) {
+                histogram_add(&res->latency, (uint64_t)(done - sent));
+                res->surfaced++;
+                next_seq = seq + 1;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+
+static int run_mode(const bench_cfg_t *cfg, load_mode_t mode, FILE *out)
+{
+    bench_run_t run;
+    memset(&run, 0, sizeof run);
+    run.cfg = cfg;
+    run.send_ns = calloc(cfg->frames, sizeof run.send_ns[0]);
+    if (!run.send_ns) {
+        perror("calloc");
+        return -1;
+    }
+
+    char gpio_root[] = "/tmp/tsp-load-XXXXXX";
+    int left_fd = -1;
+    char left_name[64];
+    char right_name[64];
+    run.master_fd = -1;
+    if (bench_mock_gpio_tree(gpio_root) != 0) {
+        free(run.send_ns);
+        return -1;
+    }
+    int pipe_fds[2] = { -1, -1 };
+    if (bench_open_pty(&left_fd, left_name, sizeof left_name) != 0 ||
+        bench_open_pty(&run.master_fd, right_name, sizeof right_name) != 0 ||
+        pipe(pipe_fds) != 0 || fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC) != 0) {
+        perror("bench setup");
+        if (left_fd >= 0) {
+            close(left_fd);
+        }
+        if (run.master_fd >= 0) {
+            close(run.master_fd);
+        }
+        if (pipe_fds[0] >= 0) {
+            close(pipe_fds[0]);
+            close(pipe_fds[1]);
+        }
+        gpio_mock_remove_tree(gpio_root);
+        free(run.send_ns);
+        return -1;
+    }
+
+    char left_arg[PATH_MAX + 16];
+    char right_arg[PATH_MAX + 16];
+    char gpio_arg[PATH_MAX + 16];
+    char sink_arg[64];
+    snprintf(left_arg, sizeof left_arg, "--left-serial=%s", left_name);
+    snprintf(right_arg, sizeof right_arg, "--right-serial=%s", right_name);
+    snprintf(gpio_arg, sizeof gpio_arg, "--gpio-root=%s", gpio_root);
+    // Only the write end crosses exec; the daemon opens it by /dev/fd path.
+    snprintf(sink_arg, sizeof sink_arg, "--event-sink=/dev/fd/%d", pipe_fds[1]);
+    char *argv[9];
+    int argc = 0;
+    argv[argc++] = "trimui_inputd";
+    argv[argc++] = left_arg;
+    argv[argc++] = right_arg;
+    argv[argc++] = gpio_arg;
+    argv[argc++] = sink_arg;
+    argv[argc++] = "--control=";
+    if (mode == LOAD_MODE_TIMEOUT) {
+        argv[argc++] = "--poll-timeout=1";
+    } else if (mode == LOAD_MODE_BOOST) {
+        argv[argc++] = "--uclamp";
+        argv[argc++] = "--pm-qos";
+    }
+    argv[argc] = NULL;
+
+    // The child takes SCHED_FIFO before exec, so startup and the settle already run under it.
+    pid_t pid = bench_spawn_daemon_rt(argv, mode == LOAD_MODE_REALTIME ? BENCH_RT_PRIORITY : 0);
+    const int spawn_errno = errno;
+    close(pipe_fds[1]);
+    const bool ran = pid > 0;
+    const bool skipped = !ran && mode == LOAD_MODE_REALTIME && (spawn_errno == EPERM || spawn_errno == EINVAL);
+    if (skipped) {
+        fprintf(out, "  %-8s skipped (%s)\n", load_mode_names[mode], strerror(spawn_errno));
+    }
+
+    load_result_t res;
+    memset(&res, 0, sizeof res);
+    histogram_reset(&res.latency);
+    bench_event_reader_t reader = { .fd = pipe_fds[0] };
+    bool ok = ran && bench_settle(&reader, BENCH_START_TIMEOUT_MS, BENCH_SETTLE_MS);
+    if (ok) {
+        pthread_t feeder;
+        if (pthread_create(&feeder, NULL, feeder_main, &run) != 0) {
+            fprintf(stderr, "bench: unable to start feeder thread\n");
+            ok = false;
+        } else {
+            ok = collect(&run, &reader, &res);
+            pthread_join(feeder, NULL);
+        }
+    }
+
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+    if (ok) {
+        histogram_print(&res.latency, load_mode_names[mode], out);
+        fprintf(out, "  %-8s dropped %u/%u frames\n", load_mode_names[mode],
+                cfg->frames - res.surfaced, cfg->frames);
+    }
+
+    close(pipe_fds[0]);
+    close(left_fd);
+    close(run.master_fd);
+    gpio_mock_remove_tree(gpio_root);
+    free(run.send_ns);
+    return (ok || skipped) ? 0 : -1;
+}
+
+int load_bench_run(const char *spec)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    bench_cfg_t cfg = {
+        .cpu_hogs = cpus > 0 ? (unsigned int)cpus : 1,
+        .mem_hogs = 1,
+        .io_hogs = 1,
+        .frames = BENCH_DEFAULT_FRAMES,
+        .rate_hz = BENCH_DEFAULT_RATE_HZ,
+        .modes = (1u << LOAD_MODE_COUNT) - 1,
+        .io_dir = NULL,
+    };
+
+    char *spec_copy = spec ? strdup(spec) : NULL;
+    if (spec && !spec_copy) {
+        perror("strdup");
+        return 1;
+    }
+    bool ok = parse_spec(spec_copy, &cfg);
+    if (!ok) {
+        free(spec_copy);
+        return 1;
+    }
+    hog_io_dir = cfg.io_dir ? cfg.io_dir : pick_io_dir();
+
+    FILE *out = stderr;
+    fprintf(out, "Load bench: %u frames @ %u Hz, hogs cpu=%u mem=%u io=%u, io dir %s\n",
+            cfg.frames, cfg.rate_hz, cfg.cpu_hogs, cfg.mem_hogs, cfg.io_hogs, hog_io_dir);
+    if (cfg.io_hogs && is_ram_backed(hog_io_dir)) {
+        fprintf(out, "  warning: %s is RAM-backed; the I/O hogs only load the CPU\n", hog_io_dir);
+    }
+
+    pid_t hogs[BENCH_MAX_HOGS];
+    unsigned int hog_count = 0;
+    hog_count = spawn_hogs(hog_cpu, cfg.cpu_hogs, hogs, hog_count);
+    hog_count = spawn_hogs(hog_mem, cfg.mem_hogs, hogs, hog_count);
+    hog_count = spawn_hogs(hog_io, cfg.io_hogs, hogs, hog_count);
+
+    int failures = 0;
+    for (int m = 0; m < LOAD_MODE_COUNT; ++m) {
+        if (cfg.modes & (1u << m)) {
+            if (run_mode(&cfg, (load_mode_t)m, out) != 0) {
+                ++failures;
+            }
+        }
+    }
+
+    stop_hogs(hogs, hog_count);
+    free(spec_copy);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,18 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+/**
+ * Measure frame-to-event latency of the serial input path while CPU, memory-bandwidth
+ * and fsync-heavy I/O hogs compete for the machine.
+ *
+ * Each mode (default, timeout, boost, realtime) runs the real daemon as a child on pty
+ * pads with a pipe event sink. A feeder thread writes pad frames carrying a sequence number
+ * in the button byte at a fixed rate. Per mode it reports p50/p99/p99.9 write-to-event
+ * latency and the number of frames that never surfaced.
+ *
+ * @param spec Comma separated key=value list (cpu, mem, io, iodir, frames, rate, mode); NULL for defaults.
+ * @return 0 on success, 1 on setup failure or bad spec.
+ */
+int load_bench_run(const char *spec);
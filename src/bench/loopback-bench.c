@@ -0,0 +1,442 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Loopback bench: pty frame in, evdev (or pipe sink) event out, through a real daemon child.
+
+#define _GNU_SOURCE
+
+#include "loopback-bench.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../clock/clock.h"
+#include "../gpio/gpio.h"
+#include "../power/uclamp.h"
+#include "../serial/serial-joystick.h"
+#include "../stats/histogram.h"
+#include "bench-daemon.h"
+
+#define LOOPBACK_DEFAULT_SAMPLES 2000
+#define LOOPBACK_MAX_SAMPLES 1000000
+#define LOOPBACK_DEFAULT_GAP_US 2000
+#define LOOPBACK_DEVICE_NAME "TRIMUI Smart Pro Controller"
+#define LOOPBACK_DEVICE_WAIT_MS 5000
+#define LOOPBACK_SETTLE_MS 300
+#define LOOPBACK_TIMEOUT_MS 100
+#define LOOPBACK_START_MASK 0x80u   // Right pad Start -> BTN_START.
+#define LOOPBACK_MAX_NODES 64
+
+typedef enum {
+    SINK_AUTO = 0,
+    SINK_EVDEV,
+    SINK_PIPE
+} sink_kind_t;
+
+// Which daemons to run: unboosted, --uclamp, or one of each for a comparison.
+typedef enum {
+    UCLAMP_PASS_OFF = 0,
+    UCLAMP_PASS_ON,
+    UCLAMP_PASS_BOTH
+} uclamp_pass_t;
+
+typedef struct {
+    unsigned int samples;
+    unsigned int gap_us;
+    sink_kind_t sink;
+    uclamp_pass_t uclamp;
+} loopback_cfg_t;
+
+static bool parse_spec(char *spec, loopback_cfg_t *cfg)
+{
+    enum { SPEC_SAMPLES, SPEC_GAP, SPEC_SINK, SPEC_UCLAMP };
+    char *const tokens[] = { "samples", "gap", "sink", "uclamp", NULL };
+
+    while (spec && *spec) {
+        char *value = NULL;
+        int key = getsubopt(&spec, tokens, &value);
+        if (key < 0 || value == NULL) {
+            fprintf(stderr, "loopback: bad option '%s'\n", value ? value : "?");
+            return false;
+        }
+        if (key == SPEC_SINK) {
+            if (strcmp(value, "auto") == 0) {
+                cfg->sink = SINK_AUTO;
+            } else if (strcmp(value, "evdev") == 0) {
+                cfg->sink = SINK_EVDEV;
+            } else if (strcmp(value, "pipe") == 0) {
+                cfg->sink = SINK_PIPE;
+            } else {
+                fprintf(stderr, "loopback: unknown sink '%s'\n", value);
+                return false;
+            }
+            continue;
+        }
+        if (key == SPEC_UCLAMP) {
+            if (strcmp(value, "off") == 0) {
+                cfg->uclamp = UCLAMP_PASS_OFF;
+            } else if (strcmp(value, "on") == 0) {
+                cfg->uclamp = UCLAMP_PASS_ON;
+            } else if (strcmp(value, "both") == 0) {
+                cfg->uclamp = UCLAMP_PASS_BOTH;
+            } else {
+                fprintf(stderr, "loopback: uclamp must be off, on or both\n");
+                return false;
+            }
+            continue;
+        }
+
+        char *end = NULL;
+        unsigned long n = strtoul(value, &end, 10);
+        if (end == value || *end != '\0') {
+            fprintf(stderr, "loopback: '%s' is not a number\n", value);
+            return false;
+        }
+        if (key == SPEC_SAMPLES) {
+            cfg->samples = (unsigned int)n;
+        } else {
+            cfg->gap_us = (unsigned int)n;
+        }
+    }
+
+    if (cfg->samples == 0 || cfg->samples > LOOPBACK_MAX_SAMPLES) {
+        fprintf(stderr, "loopback: samples must be 1..%d\n", LOOPBACK_MAX_SAMPLES);
+        return false;
+    }
+    return true;
+}
+
+// Event node numbers that exist right now, so the daemon's new node can be told apart
+// from a stock inputd exposing the same name.
+static size_t list_event_nodes(int *nodes, size_t max)
+{
+    DIR *dir = opendir("/dev/input");
+    if (!dir) {
+        return 0;
+    }
+    size_t count = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) && count < max) {
+        int n;
+        if (sscanf(de->d_name, "event%d", &n) == 1) {
+            nodes[count++] = n;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+static int open_new_evdev(const int *before, size_t before_count, char *path, size_t path_len)
+{
+    int64_t deadline = clock_now_ns() + (int64_t)LOOPBACK_DEVICE_WAIT_MS * 1000000LL;
+    while (clock_now_ns() < deadline) {
+        int nodes[LOOPBACK_MAX_NODES];
+        size_t count = list_event_nodes(nodes, LOOPBACK_MAX_NODES);
+        for (size_t i = 0; i < count; ++i) {
+            bool seen = false;
+            for (size_t j = 0; j < before_count && !seen; ++j) {
+                seen = (nodes[i] == before[j]);
+            }
+            if (seen) {
+                continue;
+            }
+            snprintf(path, path_len, "/dev/input/event%d", nodes[i]);
+            int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            char name[128] = { 0 };
+            if (ioctl(fd, EVIOCGNAME(sizeof name - 1), name) >= 0 && strcmp(name, LOOPBACK_DEVICE_NAME) == 0) {
+                // Stamp events with the same clock the bench uses for the frame writes.
+                int clk = CLOCK_MONOTONIC;
+                ioctl(fd, EVIOCSCLOCKID, &clk);
+                return fd;
+            }
+            close(fd);
+        }
+        clock_sleep_ms(20);
+    }
+    fprintf(stderr, "loopback: no new \"%s\" evdev node within %d ms\n",
+            LOOPBACK_DEVICE_NAME, LOOPBACK_DEVICE_WAIT_MS);
+    return -1;
+}
+
+static void write_frame(int fd, uint8_t buttons)
+{
+    // Centered stick so only the button changes.
+    const uint8_t frame[SERIAL_FRAME_LEN] = { 0xFF, 0x01, buttons, 0x08, 0x00, 0x08, 0x00 };
+    if (write(fd, frame, sizeof frame) != (ssize_t)sizeof frame) {
+        perror("pty write");
+    }
+}
+
+static int64_t event_ns(const struct input_event *ev)
+{
+    return (int64_t)ev->input_event_sec * 1000000000LL + (int64_t)ev->input_event_usec * 1000LL;
+}
+
+// Signed distance a - b between two wrapping 32-bit microsecond stamps, in nanoseconds.
+static int64_t stamp_delta_ns(uint32_t a, uint32_t b)
+{
+    return (int64_t)(int32_t)(a - b) * 1000LL;
+}
+
+// Read the rest of the report the matched key belongs to, picking up its MSC_TIMESTAMP.
+static bool report_stamp(bench_event_reader_t *r, uint32_t *stamp)
+{
+    bool found = false;
+    struct input_event ev;
+    while (bench_next_event(r, LOOPBACK_TIMEOUT_MS, &ev) == 1) {
+        if (ev.type == EV_MSC && ev.code == MSC_TIMESTAMP) {
+            *stamp = (uint32_t)ev.value;
+            found = true;
+        } else if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+            break;
+        }
+    }
+    return found;
+}
+
+// Histograms of one pass (one child daemon).
+typedef struct {
+    histogram_t to_reader;
+    histogram_t to_core;
+    histogram_t stamp_err;
+    histogram_t stamp_age;
+    int64_t stamp_bias_sum;
+    unsigned int lost;
+} loopback_result_t;
+
+static bool run_pass(const loopback_cfg_t *cfg, bool boost, loopback_result_t *res)
+{
+    histogram_reset(&res->to_reader);
+    histogram_reset(&res->to_core);
+    histogram_reset(&res->stamp_err);
+    histogram_reset(&res->stamp_age);
+    res->stamp_bias_sum = 0;
+    res->lost = 0;
+
+    char gpio_root[] = "/tmp/tsp-loopback-XXXXXX";
+    int left_fd = -1;
+    int right_fd = -1;
+    char left_name[64];
+    char right_name[64];
+    if (bench_mock_gpio_tree(gpio_root) != 0) {
+        return false;
+    }
+    if (bench_open_pty(&left_fd, left_name, sizeof left_name) != 0 ||
+        bench_open_pty(&right_fd, right_name, sizeof right_name) != 0) {
+        if (left_fd >= 0) {
+            close(left_fd);
+        }
+        gpio_mock_remove_tree(gpio_root);
+        return false;
+    }
+
+    int pipe_fds[2] = { -1, -1 };
+    int before[LOOPBACK_MAX_NODES];
+    size_t before_count = 0;
+    char left_arg[PATH_MAX + 16];
+    char right_arg[PATH_MAX + 16];
+    char gpio_arg[PATH_MAX + 16];
+    char sink_arg[64];
+    char *argv[9];
+    int argc = 0;
+
+    snprintf(left_arg, sizeof left_arg, "--left-serial=%s", left_name);
+    snprintf(right_arg, sizeof right_arg, "--right-serial=%s", right_name);
+    snprintf(gpio_arg, sizeof gpio_arg, "--gpio-root=%s", gpio_root);
+    argv[argc++] = "trimui_inputd";
+    argv[argc++] = left_arg;
+    argv[argc++] = right_arg;
+    argv[argc++] = gpio_arg;
+    argv[argc++] = "--control=";
+    if (boost) {
+        argv[argc++] = "--uclamp";
+    }
+    if (cfg->sink == SINK_PIPE) {
+        // Only the write end crosses exec; the daemon opens it by /dev/fd path.
+        if (pipe(pipe_fds) != 0 || fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC) != 0) {
+            perror("pipe");
+            close(left_fd);
+            close(right_fd);
+            gpio_mock_remove_tree(gpio_root);
+            return false;
+        }
+        snprintf(sink_arg, sizeof sink_arg, "--event-sink=/dev/fd/%d", pipe_fds[1]);
+        argv[argc++] = sink_arg;
+    } else {
+        before_count = list_event_nodes(before, LOOPBACK_MAX_NODES);
+    }
+    argv[argc] = NULL;
+
+    pid_t pid = bench_spawn_daemon(argv);
+    if (pipe_fds[1] >= 0) {
+        close(pipe_fds[1]);
+    }
+    if (pid < 0) {
+        if (pipe_fds[0] >= 0) {
+            close(pipe_fds[0]);
+        }
+        close(left_fd);
+        close(right_fd);
+        gpio_mock_remove_tree(gpio_root);
+        return false;
+    }
+
+    bench_event_reader_t reader = { .fd = pipe_fds[0] };
+    char evdev_path[64] = "pipe";
+    if (cfg->sink == SINK_EVDEV) {
+        reader.fd = open_new_evdev(before, before_count, evdev_path, sizeof evdev_path);
+    }
+
+    bool daemon_ok = reader.fd >= 0 && bench_settle(&reader, LOOPBACK_DEVICE_WAIT_MS, LOOPBACK_SETTLE_MS);
+    if (daemon_ok) {
+        fprintf(stderr, "Loopback bench: %u samples, gap %u us (+jitter), sink %s, uclamp %s\n",
+                cfg->samples, cfg->gap_us, evdev_path, boost ? "on" : "off");
+    }
+
+    unsigned int seed = (unsigned int)getpid();
+    for (unsigned int i = 0; daemon_ok && i < cfg->samples; ++i) {
+        int want = (i % 2 == 0) ? 1 : 0;
+        int64_t sent = clock_now_ns();
+        write_frame(right_fd, want ? LOOPBACK_START_MASK : 0);
+
+        bool matched = false;
+        while (!matched) {
+            struct input_event ev;
+            int64_t left_ms = LOOPBACK_TIMEOUT_MS - (clock_now_ns() - sent) / 1000000LL;
+            int rd = bench_next_event(&reader, left_ms > 0 ? (int)left_ms : 0, &ev);
+            if (rd < 0) {
+                fprintf(stderr, "loopback: event stream closed (daemon exited?)\n");
+                daemon_ok = false;
+                break;
+            }
+            if (rd == 0) {
+                ++res->lost;
+                break;
+            }
+            if (ev.type == EV_KEY && ev.code == BTN_START && ev.value == want) {
+                int64_t now = clock_now_ns();
+                histogram_add(&res->to_reader, (uint64_t)(now - sent));
+                if (cfg->sink == SINK_EVDEV && event_ns(&ev) >= sent) {
+                    histogram_add(&res->to_core, (uint64_t)(event_ns(&ev) - sent));
+                }
+                // The frame goes out in one write, so on a real UART its first byte would
+                // have started SERIAL_FRAME_LEN byte times before the last one landed.
+                uint32_t stamp;
+                if (report_stamp(&reader, &stamp)) {
+                    int64_t start_ns = sent - (int64_t)SERIAL_FRAME_LEN * SERIAL_BYTE_NS;
+                    int64_t err = stamp_delta_ns(stamp, (uint32_t)(start_ns / 1000));
+                    res->stamp_bias_sum += err;
+                    histogram_add(&res->stamp_err, (uint64_t)(err < 0 ? -err : err));
+                    int64_t age = stamp_delta_ns((uint32_t)(now / 1000), stamp);
+                    histogram_add(&res->stamp_age, (uint64_t)(age > 0 ? age : 0));
+                }
+                matched = true;
+            }
+        }
+
+        // Jitter the gap so samples do not phase-lock with a periodic loop timeout.
+        unsigned int gap = cfg->gap_us + (cfg->gap_us ? (unsigned int)rand_r(&seed) % (cfg->gap_us / 2 + 1) : 0);
+        struct timespec ts = { .tv_sec = gap / 1000000u, .tv_nsec = (long)(gap % 1000000u) * 1000L };
+        nanosleep(&ts, NULL);
+    }
+
+    kill(pid, SIGTERM);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (reader.fd >= 0) {
+        close(reader.fd);
+    }
+    close(left_fd);
+    close(right_fd);
+    gpio_mock_remove_tree(gpio_root);
+    return daemon_ok;
+}
+
+static void print_pass(const loopback_cfg_t *cfg, const loopback_result_t *res)
+{
+    if (cfg->sink == SINK_EVDEV) {
+        histogram_print(&res->to_core, "input core", stderr);
+    }
+    histogram_print(&res->to_reader, "reader", stderr);
+    if (res->stamp_err.count > 0) {
+        histogram_print(&res->stamp_err, "stamp |error|", stderr);
+        histogram_print(&res->stamp_age, "stamp age at read", stderr);
+        fprintf(stderr, "stamp bias %+" PRId64 " ns (mean of %" PRIu64 " stamped reports)\n",
+                res->stamp_bias_sum / (int64_t)res->stamp_err.count, res->stamp_err.count);
+    } else {
+        fprintf(stderr, "no MSC_TIMESTAMP seen on matched reports\n");
+    }
+    fprintf(stderr, "lost %u of %u samples (no event within %d ms)\n", res->lost, cfg->samples,
+            LOOPBACK_TIMEOUT_MS);
+}
+
+int loopback_bench_run(const char *spec)
+{
+    loopback_cfg_t cfg = {
+        .samples = LOOPBACK_DEFAULT_SAMPLES,
+        .gap_us = LOOPBACK_DEFAULT_GAP_US,
+        .sink = SINK_AUTO,
+        .uclamp = UCLAMP_PASS_OFF,
+    };
+    char *spec_copy = spec ? strdup(spec) : NULL;
+    if (spec && !spec_copy) {
+        perror("strdup");
+        return 1;
+    }
+    bool ok = parse_spec(spec_copy, &cfg);
+    free(spec_copy);
+    if (!ok) {
+        return 1;
+    }
+    if (cfg.sink == SINK_AUTO) {
+        cfg.sink = (access("/dev/uinput", W_OK) == 0) ? SINK_EVDEV : SINK_PIPE;
+    }
+    if (cfg.uclamp != UCLAMP_PASS_OFF && !uclamp_supported()) {
+        // The boosted daemon would just log the failure and run unboosted.
+        fprintf(stderr, "loopback: kernel has no utilization clamping (CONFIG_UCLAMP_TASK); "
+                "boosted passes measure the unboosted path\n");
+    }
+
+    static loopback_result_t results[2];
+    const bool passes[2] = { cfg.uclamp != UCLAMP_PASS_ON, cfg.uclamp != UCLAMP_PASS_OFF };
+    bool daemon_ok = true;
+    for (int boost = 0; boost < 2 && daemon_ok; ++boost) {
+        if (!passes[boost]) {
+            continue;
+        }
+        daemon_ok = run_pass(&cfg, boost != 0, &results[boost]);
+        if (results[boost].to_reader.count == 0) {
+            fprintf(stderr, "loopback: no samples came back\n");
+            return 1;
+        }
+        print_pass(&cfg, &results[boost]);
+    }
+
+    if (daemon_ok && passes[0] && passes[1]) {
+        const histogram_t *off = &results[0].to_reader;
+        const histogram_t *on = &results[1].to_reader;
+        fprintf(stderr, "uclamp boost: reader p50 %.1f -> %.1f us, p99 %.1f -> %.1f us, mean %.1f -> %.1f us\n",
+                histogram_percentile(off, 50) / 1e3, histogram_percentile(on, 50) / 1e3,
+                histogram_percentile(off, 99) / 1e3, histogram_percentile(on, 99) / 1e3,
+                (double)off->sum_ns / (double)off->count / 1e3, (double)on->sum_ns / (double)on->count / 1e3);
+    }
+    return daemon_ok ? 0 : 1;
+}
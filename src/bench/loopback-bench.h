@@ -0,0 +1,17 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+/**
+ * End-to-end latency as a consumer sees it: a child daemon reads pty pads, and the bench
+ * toggles a button with one frame at a time and waits for the matching EV_KEY on the
+ * daemon's evdev node (or on a pipe given to --event-sink when uinput is unavailable).
+ * Reports frame-write -> read() latency and, on evdev, frame-write -> input core stamp.
+ * uclamp=both runs a plain and a --uclamp daemon back to back and compares them.
+ *
+ * @param spec Comma separated key=value list (samples, gap, sink=auto|evdev|pipe,
+ *             uclamp=off|on|both); NULL for defaults.
+ * @return 0 on success, 1 on setup failure, bad spec, or if no sample came back.
+ */
+int loopback_bench_run(const char *spec);
@@ -0,0 +1,386 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Mutation fuzzer and per-byte bench for the serial frame parser and calibration loader.
+
+#include "parser-bench.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../calibration/cross-axis.h"
+#include "../clock/clock.h"
+#include "../config/config.h"
+#include "../serial/serial-joystick.h"
+#include "../stats/histogram.h"
+
+#define FUZZ_DEFAULT_ITERATIONS 200000u
+#define FUZZ_MAX_INPUT 512
+#define FUZZ_CALIBRATION_EVERY 64
+#define FUZZ_MAX_REPORTS 10
+#define BENCH_STREAM_BYTES (4u * 1024u * 1024u)
+#define BENCH_CHUNK 32
+#define BENCH_RUNS 3
+// A pathological stream may cost up to SERIAL_FRAME_LEN steps per byte; allow timing slack on top.
+#define BENCH_MAX_RATIO (2.0 * SERIAL_FRAME_LEN)
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void)
+{
+    uint64_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    rng_state = x;
+    return x;
+}
+
+static unsigned int rng_below(unsigned int n)
+{
+    return (unsigned int)(rng_next() % n);
+}
+
+static size_t put_frame(uint8_t *out, uint8_t buttons, uint16_t x, uint16_t y)
+{
+    out[0] = 0xFF;
+    out[1] = 0x01;
+    out[2] = buttons;
+    out[3] = (uint8_t)(x >> 8);
+    out[4] = (uint8_t)x;
+    out[5] = (uint8_t)(y >> 8);
+    out[6] = (uint8_t)y;
+    return SERIAL_FRAME_LEN;
+}
+
+// Random frames (buttons may be 0xFF, X low byte may be 0x01, ...) then byte-level mutations.
+static size_t gen_input(uint8_t *buf, size_t cap)
+{
+    static const uint8_t magic[] = { 0xFF, 0x01, 0x00, 0x0F, 0x10, 0xF0 };
+    size_t len = 0;
+    unsigned int style = rng_below(3);
+
+    while (len + SERIAL_FRAME_LEN <= cap && rng_below(16) != 0) {
+        if (style == 0) {
+            buf[len++] = (uint8_t)rng_next();
+        } else if (style == 1) {
+            buf[len++] = magic[rng_below(sizeof magic)];
+        } else {
+            len += put_frame(buf + len, (uint8_t)rng_next(), (uint16_t)(rng_next() & 0x0FFF),
+                             (uint16_t)(rng_next() & 0x0FFF));
+        }
+    }
+
+    unsigned int mutations = rng_below(8);
+    for (unsigned int m = 0; m < mutations && len > 0; ++m) {
+        size_t at = rng_below((unsigned int)len);
+        switch (rng_below(4)) {
+        case 0:
+            buf[at] ^= (uint8_t)(1u << rng_below(8));
+            break;
+        case 1:
+            buf[at] = magic[rng_below(sizeof magic)];
+            break;
+        case 2:
+            memmove(buf + at, buf + at + 1, len - at - 1);
+            --len;
+            break;
+        default:
+            if (len < cap) {
+                memmove(buf + at + 1, buf + at, len - at);
+                buf[at] = 0xFF;
+                ++len;
+            }
+            break;
+        }
+    }
+    return len;
+}
+
+static bool sample_in_range(const joypad_struct_t *j)
+{
+    return j->header == 0xFF01 && j->x <= 0x0FFF && j->y <= 0x0FFF;
+}
+
+static bool fuzz_parser_once(unsigned int iteration, unsigned int *reports)
+{
+    uint8_t buf[FUZZ_MAX_INPUT];
+    size_t len = gen_input(buf, sizeof buf);
+    serial_parser_t parser;
+    memset(&parser, 0, sizeof parser);
+    bool ok = true;
+
+    // Feed in random chunk sizes, as read() would split the stream.
+    for (size_t off = 0; off < len;) {
+        size_t chunk = 1 + rng_below(BENCH_CHUNK);
+        if (chunk > len - off) {
+            chunk = len - off;
+        }
+        joypad_struct_t j;
+        memset(&j, 0, sizeof j);
+        int r = parseSerialBytes(&parser, buf + off, chunk, &j);
+        if (parser.framePos >= SERIAL_FRAME_LEN || (r == 1 && !sample_in_range(&j))) {
+            ok = false;
+        }
+        off += chunk;
+    }
+
+    // Whatever came before, three clean frames must leave the parser on the last one.
+    uint8_t tail[3 * SERIAL_FRAME_LEN];
+    uint16_t want_x = 0, want_y = 0;
+    uint8_t want_b = 0;
+    for (int f = 0; f < 3; ++f) {
+        want_b = (uint8_t)rng_next();
+        want_x = (uint16_t)(rng_next() & 0x0FFF);
+        want_y = (uint16_t)(rng_next() & 0x0FFF);
+        put_frame(tail + f * SERIAL_FRAME_LEN, want_b, want_x, want_y);
+    }
+    joypad_struct_t j;
+    memset(&j, 0, sizeof j);
+    int r = parseSerialBytes(&parser, tail, sizeof tail, &j);
+    if (r != 1 || j.buttons.b != want_b || j.x != want_x || j.y != want_y) {
+        ok = false;
+    }
+
+    if (!ok && (*reports)++ < FUZZ_MAX_REPORTS) {
+        fprintf(stderr, "  parser invariant violated at iteration %u, input:", iteration);
+        for (size_t i = 0; i < len; ++i) {
+            fprintf(stderr, " %02x", buf[i]);
+        }
+        fprintf(stderr, "\n");
+    }
+    return ok;
+}
+
+static void gen_config_line(FILE *f)
+{
+    static const char *const keys[] = {
+        "x_min", "x_max", "y_min", "y_max", "x_zero", "y_zero", "deadzone",
+        "cross_xx", "cross_xy", "cross_yx", "cross_yy", "bogus", ""
+    };
+    static const char *const odd_values[] = {
+        "", "-1", "65535", "65536", "4294967296", "12abc", " 7 ", "0x10", "=", "99999999999999999999"
+    };
+
+    switch (rng_below(6)) {
+    case 0: {
+        // Overlong line whose tail looks like a valid assignment.
+        unsigned int pad = 100 + rng_below(300);
+        for (unsigned int i = 0; i < pad; ++i) {
+            fputc('a' + (int)rng_below(26), f);
+        }
+        fprintf(f, "x_zero=%u\n", rng_below(70000));
+        break;
+    }
+    case 1:
+        fprintf(f, "%s\n", keys[rng_below(sizeof keys / sizeof keys[0])]);
+        break;
+    case 2:
+        fprintf(f, "%s=%s\n", keys[rng_below(sizeof keys / sizeof keys[0])],
+                odd_values[rng_below(sizeof odd_values / sizeof odd_values[0])]);
+        break;
+    case 3:
+        fprintf(f, "# %s=%u\n", keys[rng_below(sizeof keys / sizeof keys[0])], rng_below(5000));
+        break;
+    default:
+        fprintf(f, "%s = %u\n", keys[rng_below(sizeof keys / sizeof keys[0])], rng_below(70000));
+        break;
+    }
+}
+
+static bool fuzz_calibration_once(const char *dir, unsigned int iteration, unsigned int *reports)
+{
+    char path[256];
+    snprintf(path, sizeof path, "%s/joypad.config", dir);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    unsigned int lines = rng_below(12);
+    for (unsigned int i = 0; i < lines; ++i) {
+        gen_config_line(f);
+    }
+    fclose(f);
+
+    joypad_cali_t c;
+    load_calibration_chain(dir, NULL, dir, "joypad.config", &c);
+    bool ok = c.x_min <= c.x_zero && c.x_zero <= c.x_max &&
+              c.y_min <= c.y_zero && c.y_zero <= c.y_max && cross_axis_valid(&c);
+    if (!ok && (*reports)++ < FUZZ_MAX_REPORTS) {
+        fprintf(stderr, "  calibration invariant violated at iteration %u (x %u/%u/%u y %u/%u/%u)\n",
+                iteration, c.x_min, c.x_zero, c.x_max, c.y_min, c.y_zero, c.y_max);
+    }
+    return ok;
+}
+
+int parser_fuzz_run(const char *spec)
+{
+    unsigned long iterations = FUZZ_DEFAULT_ITERATIONS;
+    unsigned long long seed = (unsigned long long)clock_now_ns();
+    if (spec && *spec) {
+        char *end = NULL;
+        iterations = strtoul(spec, &end, 10);
+        if (end && *end == ',') {
+            seed = strtoull(end + 1, NULL, 0);
+        }
+    }
+    rng_state = seed ? seed : 1;
+
+    char dir[] = "/tmp/tsp-fuzz-XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    fprintf(stderr, "Parser fuzz: %lu iterations, seed %llu\n", iterations, seed);
+
+    config_set_verbose(false);
+    unsigned int reports = 0;
+    unsigned long parser_failures = 0;
+    unsigned long calibration_failures = 0;
+    unsigned long calibration_runs = 0;
+    for (unsigned long i = 0; i < iterations; ++i) {
+        if (!fuzz_parser_once((unsigned int)i, &reports)) {
+            ++parser_failures;
+        }
+        if (i % FUZZ_CALIBRATION_EVERY == 0) {
+            ++calibration_runs;
+            if (!fuzz_calibration_once(dir, (unsigned int)i, &reports)) {
+                ++calibration_failures;
+            }
+        }
+    }
+    config_set_verbose(true);
+
+    char path[256];
+    snprintf(path, sizeof path, "%s/joypad.config", dir);
+    unlink(path);
+    rmdir(dir);
+
+    fprintf(stderr, "Parser fuzz: %s (parser %lu/%lu failing, calibration %lu/%lu failing)\n",
+            (parser_failures || calibration_failures) ? "FAIL" : "PASS",
+            parser_failures, iterations, calibration_failures, calibration_runs);
+    return (parser_failures || calibration_failures) ? 1 : 0;
+}
+
+typedef enum {
+    STREAM_CLEAN = 0,
+    STREAM_NOISE,
+    STREAM_ALL_FF,
+    STREAM_FF01,
+    STREAM_LOOKALIKE,
+    STREAM_COUNT
+} stream_kind_t;
+
+static const char *const stream_names[STREAM_COUNT] = {
+    "clean frames", "random noise", "0xFF run", "0xFF 0x01 repeat", "header look-alikes"
+};
+
+static void fill_stream(uint8_t *buf, size_t len, stream_kind_t kind)
+{
+    size_t i = 0;
+    switch (kind) {
+    case STREAM_CLEAN:
+        while (i + SERIAL_FRAME_LEN <= len) {
+            i += put_frame(buf + i, (uint8_t)rng_next(), (uint16_t)(rng_next() & 0x0FFF),
+                           (uint16_t)(rng_next() & 0x0FFF));
+        }
+        break;
+    case STREAM_NOISE:
+        for (; i < len; ++i) {
+            buf[i] = (uint8_t)rng_next();
+        }
+        break;
+    case STREAM_ALL_FF:
+        memset(buf, 0xFF, len);
+        i = len;
+        break;
+    case STREAM_FF01:
+        for (; i < len; ++i) {
+            buf[i] = (i & 1) ? 0x01 : 0xFF;
+        }
+        break;
+    case STREAM_LOOKALIKE:
+        // Every false header completes a frame that fails the range check and forces a rescan.
+        for (; i < len; ++i) {
+            static const uint8_t pattern[] = { 0xFF, 0x01, 0xFF, 0xF0, 0x00, 0xF0, 0x00 };
+            buf[i] = pattern[i % sizeof pattern];
+        }
+        break;
+    default:
+        break;
+    }
+    memset(buf + i, 0, len - i);
+}
+
+static double time_stream(const uint8_t *buf, size_t len)
+{
+    double best = 0.0;
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        serial_parser_t parser;
+        memset(&parser, 0, sizeof parser);
+        joypad_struct_t j;
+        int64_t start = clock_now_ns();
+        for (size_t off = 0; off < len; off += BENCH_CHUNK) {
+            parseSerialBytes(&parser, buf + off, BENCH_CHUNK, &j);
+        }
+        double per_byte = (double)(clock_now_ns() - start) / (double)len;
+        if (run == 0 || per_byte < best) {
+            best = per_byte;
+        }
+    }
+    return best;
+}
+
+// Per-read distribution (timer overhead included, so only the tail shape is meaningful).
+static void time_reads(const uint8_t *buf, size_t len, histogram_t *h)
+{
+    serial_parser_t parser;
+    memset(&parser, 0, sizeof parser);
+    joypad_struct_t j;
+    histogram_reset(h);
+    for (size_t off = 0; off < len; off += BENCH_CHUNK) {
+        int64_t t0 = clock_now_ns();
+        parseSerialBytes(&parser, buf + off, BENCH_CHUNK, &j);
+        histogram_add(h, (uint64_t)(clock_now_ns() - t0));
+    }
+}
+
+int parser_bench_run(void)
+{
+    uint8_t *buf = malloc(BENCH_STREAM_BYTES);
+    if (!buf) {
+        perror("malloc");
+        return 1;
+    }
+    rng_state = 0x9E3779B97F4A7C15ULL;
+
+    fprintf(stderr, "Parser bench: %u KiB per stream, %d-byte reads, best of %d\n",
+            BENCH_STREAM_BYTES / 1024, BENCH_CHUNK, BENCH_RUNS);
+    double clean_ns = 0.0;
+    int failures = 0;
+    for (int k = 0; k < STREAM_COUNT; ++k) {
+        fill_stream(buf, BENCH_STREAM_BYTES, (stream_kind_t)k);
+        double per_byte = time_stream(buf, BENCH_STREAM_BYTES);
+        if (k == STREAM_CLEAN) {
+            clean_ns = per_byte;
+        }
+        histogram_t reads;
+        time_reads(buf, BENCH_STREAM_BYTES, &reads);
+        double ratio = clean_ns > 0.0 ? per_byte / clean_ns : 1.0;
+        bool over = ratio > BENCH_MAX_RATIO;
+        fprintf(stderr, "  %-20s %6.2f ns/byte (x%.2f of clean), %d-byte read p99 %6.0f ns p99.9 %6.0f ns%s\n",
+                stream_names[k], per_byte, ratio, BENCH_CHUNK,
+                (double)histogram_percentile(&reads, 99.0), (double)histogram_percentile(&reads, 99.9),
+                over ? "  OVER BOUND" : "");
+        if (over) {
+            ++failures;
+        }
+    }
+    free(buf);
+    return failures ? 1 : 0;
+}
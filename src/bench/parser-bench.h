@@ -0,0 +1,22 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+/**
+ * Fuzz the serial frame parser and the calibration loader with mutated inputs and check
+ * their invariants: only in-range frames are reported, the parser state stays bounded,
+ * clean frames after noise are recovered, and loaded calibrations are self-consistent.
+ *
+ * @param spec "ITERATIONS[,SEED]"; NULL for the defaults.
+ * @return 0 if no invariant was violated, 1 otherwise.
+ */
+int parser_fuzz_run(const char *spec);
+
+/**
+ * Time the frame parser per input byte on clean, noisy and pathological streams
+ * (runs of 0xFF, repeated 0xFF 0x01, header look-alikes in the payload).
+ *
+ * @return 0 on success, 1 if a stream exceeded the per-byte step bound.
+ */
+int parser_bench_run(void);
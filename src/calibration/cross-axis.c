@@ -0,0 +1,241 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Cross-axis coupling correction: estimation from a guided sweep and validity checks.
+
+#include "cross-axis.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../clock/clock.h"
+#include "../serial/serial-joystick.h"
+
+#define SWEEP_HOLD_THRESHOLD 0.7     // Normalized deflection that counts as "fully pushed".
+#define SWEEP_CENTER_THRESHOLD 0.2   // Both axes below this count as released.
+#define SWEEP_HOLD_MS 500            // Averaging window once the hold is stable.
+#define SWEEP_PHASE_TIMEOUT_MS 15000
+#define SWEEP_MIN_DET 0.1            // Holds spanning less than this are too skewed to invert.
+
+static double abs_d(double v)
+{
+    return v < 0.0 ? -v : v;
+}
+
+static int16_t to_q14(double v)
+{
+    return (int16_t)(v * CROSS_AXIS_ONE + (v >= 0.0 ? 0.5 : -0.5));
+}
+
+void cross_axis_identity(joypad_cali_t *c)
+{
+    c->cross_xx = CROSS_AXIS_ONE;
+    c->cross_xy = 0;
+    c->cross_yx = 0;
+    c->cross_yy = CROSS_AXIS_ONE;
+}
+
+bool cross_axis_is_identity(const joypad_cali_t *c)
+{
+    return c->cross_xx == CROSS_AXIS_ONE && c->cross_xy == 0 &&
+           c->cross_yx == 0 && c->cross_yy == CROSS_AXIS_ONE;
+}
+
+bool cross_axis_valid(const joypad_cali_t *c)
+{
+    return c->cross_xx >= CROSS_AXIS_ONE / 2 && c->cross_yy >= CROSS_AXIS_ONE / 2 &&
+           abs(c->cross_xy) <= CROSS_AXIS_MAX_COUPLING && abs(c->cross_yx) <= CROSS_AXIS_MAX_COUPLING;
+}
+
+int cross_axis_estimate(const cross_axis_hold_t holds[4], joypad_cali_t *c)
+{
+    double ax = (holds[0].x - holds[1].x) / 2.0;
+    double ay = (holds[0].y - holds[1].y) / 2.0;
+    double bx = (holds[2].x - holds[3].x) / 2.0;
+    double by = (holds[2].y - holds[3].y) / 2.0;
+    double det = ax * by - bx * ay;
+    if (abs_d(det) < SWEEP_MIN_DET) {
+        return -1;
+    }
+
+    double m[4] = {
+        ax * by / det, -ax * bx / det,
+        -by * ay / det, by * ax / det,
+    };
+    for (int i = 0; i < 4; ++i) {
+        if (abs_d(m[i]) >= (double)INT16_MAX / CROSS_AXIS_ONE) {
+            return -1;
+        }
+    }
+
+    joypad_cali_t next = *c;
+    next.cross_xx = to_q14(m[0]);
+    next.cross_xy = to_q14(m[1]);
+    next.cross_yx = to_q14(m[2]);
+    next.cross_yy = to_q14(m[3]);
+    if (!cross_axis_valid(&next)) {
+        return -1;
+    }
+    *c = next;
+    return 0;
+}
+
+// Same scaling as the daemon's axis mapping, as a fraction of full scale.
+static double normalize(uint16_t raw, uint16_t min, uint16_t max, uint16_t zero)
+{
+    int32_t centered = (int32_t)raw - (int32_t)zero;
+    int32_t range = (centered >= 0) ? (int32_t)max - (int32_t)zero : (int32_t)zero - (int32_t)min;
+    if (range == 0) {
+        return 0.0;
+    }
+    double v = (double)centered / (double)range;
+    if (v > 1.0) v = 1.0;
+    if (v < -1.0) v = -1.0;
+    return v;
+}
+
+typedef struct {
+    int fd;
+    serial_parser_t parser;
+    const joypad_cali_t *cali;
+} sweep_port_t;
+
+// Wait up to timeout_ms for the next frame. Returns 1 with a sample, 0 on timeout, -1 on error.
+static int next_sample(sweep_port_t *port, int timeout_ms, cross_axis_hold_t *out)
+{
+    struct pollfd pfd = { .fd = port->fd, .events = POLLIN };
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0) {
+        perror("poll");
+        return -1;
+    }
+    if (ret == 0) {
+        return 0;
+    }
+    joypad_struct_t j;
+    ret = readSerialJoypad(port->fd, &port->parser, &j);
+    if (ret <= 0) {
+        return ret;
+    }
+    out->x = normalize(j.x, port->cali->x_min, port->cali->x_max, port->cali->x_zero);
+    out->y = normalize(j.y, port->cali->y_min, port->cali->y_max, port->cali->y_zero);
+    return 1;
+}
+
+// Average the position while the stick is held along `axis` (0 = X, 1 = Y). A nonzero
+// `sign` requires the hold to point that way along the axis (the opposite of its pair).
+static int sample_hold(sweep_port_t *port, int axis, int sign, cross_axis_hold_t *mean)
+{
+    int64_t deadline = clock_now_ns() + (int64_t)SWEEP_PHASE_TIMEOUT_MS * 1000000LL;
+    int64_t held_since = 0;
+    double sum_x = 0.0, sum_y = 0.0;
+    unsigned int count = 0;
+
+    for (;;) {
+        int64_t now = clock_now_ns();
+        if (now >= deadline) {
+            return -1;
+        }
+        cross_axis_hold_t s;
+        int ret = next_sample(port, 100, &s);
+        if (ret < 0) {
+            return -1;
+        }
+        if (ret == 0) {
+            continue;
+        }
+        double along = axis ? s.y : s.x;
+        double across = axis ? s.x : s.y;
+        bool held = abs_d(along) >= SWEEP_HOLD_THRESHOLD && abs_d(along) > abs_d(across) &&
+                    (sign == 0 || (along > 0.0) == (sign > 0));
+        if (!held) {
+            held_since = 0;
+            continue;
+        }
+        if (held_since == 0) {
+            held_since = now;
+            sum_x = sum_y = 0.0;
+            count = 0;
+        }
+        sum_x += s.x;
+        sum_y += s.y;
+        ++count;
+        if (now - held_since >= (int64_t)SWEEP_HOLD_MS * 1000000LL) {
+            mean->x = sum_x / count;
+            mean->y = sum_y / count;
+            return 0;
+        }
+    }
+}
+
+static int wait_center(sweep_port_t *port)
+{
+    int64_t deadline = clock_now_ns() + (int64_t)SWEEP_PHASE_TIMEOUT_MS * 1000000LL;
+    while (clock_now_ns() < deadline) {
+        cross_axis_hold_t s;
+        int ret = next_sample(port, 100, &s);
+        if (ret < 0) {
+            return -1;
+        }
+        if (ret > 0 && abs_d(s.x) < SWEEP_CENTER_THRESHOLD && abs_d(s.y) < SWEEP_CENTER_THRESHOLD) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int cross_axis_sweep_run(const char *serial_path, const joypad_cali_t *cali, const char *config_name)
+{
+    static const char *const names[4] = { "right", "left", "up", "down" };
+
+    sweep_port_t port = { .cali = cali };
+    port.fd = openSerialJoystick(serial_path);
+    if (port.fd < 0) {
+        return 1;
+    }
+    resetSerialParser(&port.parser);
+
+    cross_axis_hold_t holds[4];
+    for (int i = 0; i < 4; ++i) {
+        int axis = i / 2;
+        int sign = 0;
+        if (i % 2 == 1) {
+            // The second hold of each pair has to land on the other side of center.
+            double first = axis ? holds[i - 1].y : holds[i - 1].x;
+            sign = first > 0.0 ? -1 : 1;
+        }
+        fprintf(stderr, "Push the stick fully %s and hold it...\n", names[i]);
+        if (sample_hold(&port, axis, sign, &holds[i]) != 0) {
+            fprintf(stderr, "Cross-axis sweep: no steady %s hold within %d s\n", names[i],
+                    SWEEP_PHASE_TIMEOUT_MS / 1000);
+            closeSerialJoystick(port.fd);
+            return 1;
+        }
+        fprintf(stderr, "  %s: x=%+.3f y=%+.3f. Release the stick.\n", names[i], holds[i].x, holds[i].y);
+        if (wait_center(&port) != 0) {
+            fprintf(stderr, "Cross-axis sweep: stick did not return to center\n");
+            closeSerialJoystick(port.fd);
+            return 1;
+        }
+    }
+    closeSerialJoystick(port.fd);
+
+    double ax = (holds[0].x - holds[1].x) / 2.0;
+    double ay = (holds[0].y - holds[1].y) / 2.0;
+    double bx = (holds[2].x - holds[3].x) / 2.0;
+    double by = (holds[2].y - holds[3].y) / 2.0;
+    fprintf(stderr, "Coupling: X leaks %.1f%% into Y, Y leaks %.1f%% into X\n",
+            ax != 0.0 ? 100.0 * ay / ax : 0.0, by != 0.0 ? 100.0 * bx / by : 0.0);
+
+    joypad_cali_t result = *cali;
+    if (cross_axis_estimate(holds, &result) != 0) {
+        fprintf(stderr, "Cross-axis sweep: coupling too large to correct (more than %d%%)\n",
+                100 * CROSS_AXIS_MAX_COUPLING / CROSS_AXIS_ONE);
+        return 1;
+    }
+    printf("# Cross-axis correction for %s (Q14, %d = 1.0)\n", config_name, CROSS_AXIS_ONE);
+    printf("cross_xx=%d\ncross_xy=%d\ncross_yx=%d\ncross_yy=%d\n",
+           result.cross_xx, result.cross_xy, result.cross_yx, result.cross_yy);
+    return 0;
+}
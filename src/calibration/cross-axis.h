@@ -0,0 +1,81 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../common.h"
+
+#define CROSS_AXIS_SHIFT 14
+#define CROSS_AXIS_ONE (1 << CROSS_AXIS_SHIFT)      // 1.0 in the Q14 matrix coefficients.
+#define CROSS_AXIS_MAX_COUPLING (CROSS_AXIS_ONE / 2) // Largest accepted off-diagonal term.
+
+/**
+ * Mean normalized stick position (-1..1 per axis, before inversion) while held in one direction.
+ */
+typedef struct {
+    double x;
+    double y;
+} cross_axis_hold_t;
+
+/**
+ * Set the correction matrix of a calibration to identity.
+ *
+ * @param c Calibration to update.
+ */
+void cross_axis_identity(joypad_cali_t *c);
+
+/**
+ * @param c Calibration.
+ * @return true if the matrix is identity (the correction can be skipped).
+ */
+bool cross_axis_is_identity(const joypad_cali_t *c);
+
+/**
+ * A usable matrix keeps each axis mostly itself: diagonal terms between 0.5 and 2.0 and
+ * off-diagonal terms no larger than 0.5.
+ *
+ * @param c Calibration.
+ * @return true if the matrix is usable.
+ */
+bool cross_axis_valid(const joypad_cali_t *c);
+
+/**
+ * Estimate the matrix that maps the four held directions back onto the axes while keeping
+ * each axis' own gain: with a = (right - left) / 2 and b = (up - down) / 2, the result is
+ * diag(a.x, b.y) * [a b]^-1. Which way each pair points does not matter.
+ *
+ * @param holds Held positions in the order right, left, up, down.
+ * @param c     Calibration whose matrix is replaced on success.
+ * @return 0 on success, -1 if the holds do not span both axes or the result is not valid.
+ */
+int cross_axis_estimate(const cross_axis_hold_t holds[4], joypad_cali_t *c);
+
+/**
+ * Apply the correction to a centered, scaled sample pair (axis units, before inversion
+ * and deadzoning). Four multiply-adds in 64-bit so any int16 coefficient is safe.
+ *
+ * @param c Calibration.
+ * @param x X in/out.
+ * @param y Y in/out.
+ */
+static inline void cross_axis_apply(const joypad_cali_t *c, int32_t *x, int32_t *y)
+{
+    int64_t u = *x;
+    int64_t v = *y;
+    *x = (int32_t)((c->cross_xx * u + c->cross_xy * v + CROSS_AXIS_ONE / 2) >> CROSS_AXIS_SHIFT);
+    *y = (int32_t)((c->cross_yx * u + c->cross_yy * v + CROSS_AXIS_ONE / 2) >> CROSS_AXIS_SHIFT);
+}
+
+/**
+ * Guided sweep on one pad: prompts on stderr to hold the stick right, left, up and down,
+ * averages each hold, and prints the cross_* lines to add to the pad's config on stdout.
+ *
+ * @param serial_path Pad serial device.
+ * @param cali        Loaded calibration (its range and zero are used to normalize).
+ * @param config_name Config file the lines belong to (for the printed comment).
+ * @return 0 on success, 1 on open/read error, timeout or an unusable sweep.
+ */
+int cross_axis_sweep_run(const char *serial_path, const joypad_cali_t *cali, const char *config_name);
@@ -0,0 +1,153 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Daemon time source: real clocks/timerfd, or a virtual clock for trace replay.
+
+#include "clock.h"
+
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+static bool virtual_mode = false;
+static int64_t virtual_ns = 0;
+
+static void ns_to_timespec(int64_t ns, struct timespec *ts)
+{
+    ts->tv_sec = (time_t)(ns / 1000000000LL);
+    ts->tv_nsec = (long)(ns % 1000000000LL);
+}
+
+int64_t clock_timespec_to_ns(const struct timespec *ts)
+{
+    return (int64_t)ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+void clock_use_virtual(int64_t start_ns)
+{
+    virtual_mode = true;
+    virtual_ns = start_ns;
+}
+
+bool clock_is_virtual(void)
+{
+    return virtual_mode;
+}
+
+void clock_advance_to(int64_t ns)
+{
+    if (virtual_mode && ns > virtual_ns) {
+        virtual_ns = ns;
+    }
+}
+
+void clock_now(struct timespec *ts)
+{
+    if (virtual_mode) {
+        ns_to_timespec(virtual_ns, ts);
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, ts);
+}
+
+int64_t clock_now_ns(void)
+{
+    struct timespec ts;
+    clock_now(&ts);
+    return clock_timespec_to_ns(&ts);
+}
+
+int64_t clock_host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return clock_timespec_to_ns(&ts);
+}
+
+void clock_realtime(struct timeval *tv)
+{
+    if (virtual_mode) {
+        tv->tv_sec = (time_t)(virtual_ns / 1000000000LL);
+        tv->tv_usec = (suseconds_t)((virtual_ns % 1000000000LL) / 1000);
+        return;
+    }
+    gettimeofday(tv, NULL);
+}
+
+void clock_sleep_ms(unsigned int ms)
+{
+    if (virtual_mode) {
+        virtual_ns += (int64_t)ms * 1000000LL;
+        return;
+    }
+    usleep(ms * 1000u);
+}
+
+int clock_timer_init(clock_timer_t *t)
+{
+    memset(t, 0, sizeof *t);
+    t->fd = -1;
+    if (virtual_mode) {
+        return 0;
+    }
+    t->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    return t->fd >= 0 ? 0 : -1;
+}
+
+void clock_timer_arm(clock_timer_t *t, const struct timespec *deadline)
+{
+    t->armed = true;
+    t->deadline = *deadline;
+    if (t->fd < 0) {
+        return;
+    }
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof its);
+    its.it_value = *deadline;
+    // A zero it_value disarms; nudge deadlines that land exactly on 0.
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+        its.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(t->fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+void clock_timer_disarm(clock_timer_t *t)
+{
+    if (!t->armed) {
+        return;
+    }
+    t->armed = false;
+    if (t->fd >= 0) {
+        struct itimerspec its;
+        memset(&its, 0, sizeof its);
+        timerfd_settime(t->fd, TFD_TIMER_ABSTIME, &its, NULL);
+    }
+}
+
+bool clock_timer_consume(clock_timer_t *t)
+{
+    if (t->fd >= 0) {
+        uint64_t expirations;
+        while (read(t->fd, &expirations, sizeof expirations) > 0) {
+        }
+    }
+    return t->armed && clock_now_ns() >= clock_timespec_to_ns(&t->deadline);
+}
+
+bool clock_timer_deadline(const clock_timer_t *t, struct timespec *out)
+{
+    if (t->armed && out) {
+        *out = t->deadline;
+    }
+    return t->armed;
+}
+
+void clock_timer_close(clock_timer_t *t)
+{
+    if (t->fd >= 0) {
+        close(t->fd);
+    }
+    t->fd = -1;
+    t->armed = false;
+}
@@ -0,0 +1,130 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
+
+/**
+ * One-shot absolute timer on the daemon clock.
+ *
+ * Real time: backed by a timerfd the event loop can poll.
+ * Virtual time: no fd; the simulation driver reads the deadline and advances to it.
+ */
+typedef struct {
+    int fd;
+    bool armed;
+    struct timespec deadline;
+} clock_timer_t;
+
+/**
+ * Switch every subsystem to virtual time, starting at start_ns. Irreversible.
+ *
+ * @param start_ns Initial monotonic time in nanoseconds.
+ */
+void clock_use_virtual(int64_t start_ns);
+
+/**
+ * @return true once clock_use_virtual() has been called.
+ */
+bool clock_is_virtual(void);
+
+/**
+ * Move virtual time forward (never backwards). No-op in real time.
+ *
+ * @param ns Target monotonic time in nanoseconds.
+ */
+void clock_advance_to(int64_t ns);
+
+/**
+ * Monotonic time (CLOCK_MONOTONIC or virtual).
+ *
+ * @param ts Destination.
+ */
+void clock_now(struct timespec *ts);
+
+/**
+ * Monotonic time in nanoseconds.
+ *
+ * @return Current time.
+ */
+int64_t clock_now_ns(void);
+
+/**
+ * Nanoseconds in a timespec from clock_now() or a timer deadline.
+ *
+ * @param ts Time to convert.
+ * @return ts in nanoseconds.
+ */
+int64_t clock_timespec_to_ns(const struct timespec *ts);
+
+/**
+ * Host CLOCK_MONOTONIC in nanoseconds, ignoring virtual mode (for measuring the simulator itself).
+ *
+ * @return Current host time.
+ */
+int64_t clock_host_ns(void);
+
+/**
+ * Wall-clock time for input_event stamps (gettimeofday or virtual monotonic).
+ *
+ * @param tv Destination.
+ */
+void clock_realtime(struct timeval *tv);
+
+/**
+ * Sleep in real time, or advance virtual time instantly.
+ *
+ * @param ms Duration in milliseconds.
+ */
+void clock_sleep_ms(unsigned int ms);
+
+/**
+ * Create a disarmed timer.
+ *
+ * @param t Timer to initialize.
+ * @return 0 on success, -1 if the timerfd could not be created (real time only).
+ */
+int clock_timer_init(clock_timer_t *t);
+
+/**
+ * Arm at an absolute monotonic deadline, replacing any previous one.
+ *
+ * @param t        Timer to arm.
+ * @param deadline Absolute deadline.
+ */
+void clock_timer_arm(clock_timer_t *t, const struct timespec *deadline);
+
+/**
+ * Cancel a pending deadline.
+ *
+ * @param t Timer to disarm.
+ */
+void clock_timer_disarm(clock_timer_t *t);
+
+/**
+ * Drain the timerfd and report whether the deadline has passed.
+ *
+ * @param t Timer to check.
+ * @return true if armed and due.
+ */
+bool clock_timer_consume(clock_timer_t *t);
+
+/**
+ * Pending deadline, if any.
+ *
+ * @param t   Timer to query.
+ * @param out Destination for the deadline.
+ * @return true if the timer is armed.
+ */
+bool clock_timer_deadline(const clock_timer_t *t, struct timespec *out);
+
+/**
+ * Release the timer.
+ *
+ * @param t Timer to close.
+ */
+void clock_timer_close(clock_timer_t *t);
@@ -61,4 +61,8 @@ typedef struct {
     uint16_t x_zero;
     uint16_t y_zero;
     uint16_t deadzone;
+    int16_t cross_xx;   // Cross-axis correction matrix, Q14 (16384 = 1.0),
+    int16_t cross_xy;   // applied to the centered X/Y before deadzoning.
+    int16_t cross_yx;
+    int16_t cross_yy;
 } joypad_cali_t;
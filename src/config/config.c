@@ -13,6 +13,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "../calibration/cross-axis.h"
+
+static bool verbose = true;
+
 static char *trim(char *s)
 {
     if (!s) return s;
@@ -36,13 +40,43 @@ static void set_default_calibration(joypad_cali_t *c)
     c->x_zero = 2048;
     c->y_zero = 2048;
     c->deadzone = DEFAULT_DEADZONE;
+    cross_axis_identity(c);
+}
+
+static bool parse_cross_line(joypad_cali_t *cali, const char *key, const char *value)
+{
+    long val;
+    if (!config_parse_int(value, INT16_MIN, INT16_MAX, &val)) {
+        return false;
+    }
+
+    if (strcmp(key, "cross_xx") == 0) {
+        cali->cross_xx = (int16_t)val;
+        return true;
+    }
+    if (strcmp(key, "cross_xy") == 0) {
+        cali->cross_xy = (int16_t)val;
+        return true;
+    }
+    if (strcmp(key, "cross_yx") == 0) {
+        cali->cross_yx = (int16_t)val;
+        return true;
+    }
+    if (strcmp(key, "cross_yy") == 0) {
+        cali->cross_yy = (int16_t)val;
+        return true;
+    }
+    return false;
 }
 
 static bool parse_calibration_line(joypad_cali_t *cali, const char *key, const char *value)
 {
-    char *endptr = NULL;
-    unsigned long val = strtoul(value, &endptr, 10);
-    if (!value || *value == '\0' || (endptr && *endptr != '\0')) {
+    if (strncmp(key, "cross_", 6) == 0) {
+        return parse_cross_line(cali, key, value);
+    }
+
+    unsigned long val;
+    if (!config_parse_uint(value, UINT16_MAX, &val)) {
         return false;
     }
 
@@ -77,7 +111,7 @@ static bool parse_calibration_line(joypad_cali_t *cali, const char *key, const c
     return false;
 }
 
-static int load_calibration_from_file(const char *path, joypad_cali_t *cali)
+int config_parse_file(const char *path, config_kv_handler_t handler, void *ctx)
 {
     FILE *f = fopen(path, "r");
     if (!f) {
@@ -87,6 +121,14 @@ static int load_calibration_from_file(const char *path, joypad_cali_t *cali)
     char line[160];
     bool parsed = false;
     while (fgets(line, sizeof line, f)) {
+        size_t len = strlen(line);
+        if (len == sizeof line - 1 && line[len - 1] != '\n') {
+            // Overlong line: drop it whole rather than parsing its tail as a new line.
+            int c;
+            while ((c = fgetc(f)) != EOF && c != '\n') {
+            }
+            continue;
+        }
         char *trimmed = trim(line);
         if (*trimmed == '\0' || *trimmed == '#') {
             continue;
@@ -98,7 +140,7 @@ static int load_calibration_from_file(const char *path, joypad_cali_t *cali)
         *eq = '\0';
         const char *key = trim(trimmed);
         const char *value = trim(eq + 1);
-        if (parse_calibration_line(cali, key, value)) {
+        if (handler(ctx, key, value)) {
             parsed = true;
         }
     }
@@ -107,35 +149,131 @@ static int load_calibration_from_file(const char *path, joypad_cali_t *cali)
     return parsed ? 0 : -1;
 }
 
-int load_calibration_chain(const char *override_dir,
-                           const char *primary_path,
-                           const char *fallback_dir,
-                           const char *filename,
-                           joypad_cali_t *out)
+bool config_parse_uint(const char *value, unsigned long max, unsigned long *out)
 {
-    set_default_calibration(out);
+    char *endptr = NULL;
+    if (!value || *value == '\0') {
+        return false;
+    }
+    unsigned long val = strtoul(value, &endptr, 10);
+    if ((endptr && *endptr != '\0') || val > max) {
+        return false;
+    }
+    *out = val;
+    return true;
+}
+
+bool config_parse_int(const char *value, long min, long max, long *out)
+{
+    char *endptr = NULL;
+    if (!value || *value == '\0') {
+        return false;
+    }
+    errno = 0;
+    long val = strtol(value, &endptr, 10);
+    if ((endptr && *endptr != '\0') || errno == ERANGE || val < min || val > max) {
+        return false;
+    }
+    *out = val;
+    return true;
+}
+
+void config_set_verbose(bool enable)
+{
+    verbose = enable;
+}
 
+int config_load_chain(const char *override_dir,
+                      const char *primary_path,
+                      const char *fallback_dir,
+                      const char *filename,
+                      config_kv_handler_t handler,
+                      void *ctx)
+{
     if (override_dir && *override_dir) {
         char override_path[PATH_MAX];
         snprintf(override_path, sizeof override_path, "%s/%s", override_dir, filename);
-        if (load_calibration_from_file(override_path, out) == 0) {
-            fprintf(stderr, "Loaded calibration from %s\n", override_path);
+        if (config_parse_file(override_path, handler, ctx) == 0) {
+            if (verbose) {
+                fprintf(stderr, "Loaded %s from %s\n", filename, override_path);
+            }
             return 0;
         }
     }
 
-    if (load_calibration_from_file(primary_path, out) == 0) {
-        fprintf(stderr, "Loaded calibration from %s\n", primary_path);
+    if (primary_path && config_parse_file(primary_path, handler, ctx) == 0) {
+        if (verbose) {
+            fprintf(stderr, "Loaded %s from %s\n", filename, primary_path);
+        }
         return 0;
     }
 
+    if (!fallback_dir) {
+        return -1;
+    }
     char fallback_path[PATH_MAX];
     snprintf(fallback_path, sizeof fallback_path, "%s/%s", fallback_dir, filename);
-    if (load_calibration_from_file(fallback_path, out) == 0) {
-        fprintf(stderr, "Loaded calibration from %s\n", fallback_path);
+    if (config_parse_file(fallback_path, handler, ctx) == 0) {
+        if (verbose) {
+            fprintf(stderr, "Loaded %s from %s\n", filename, fallback_path);
+        }
+        return 0;
+    }
+
+    return -1;
+}
+
+static bool parse_calibration_kv(void *ctx, const char *key, const char *value)
+{
+    return parse_calibration_line((joypad_cali_t *)ctx, key, value);
+}
+
+// An axis whose zero does not sit between min and max would map backwards; fall back.
+static void sanitize_calibration(joypad_cali_t *c, const char *filename)
+{
+    joypad_cali_t defaults;
+    set_default_calibration(&defaults);
+
+    if (!(c->x_min <= c->x_zero && c->x_zero <= c->x_max)) {
+        if (verbose) {
+            fprintf(stderr, "%s: inconsistent x_min/x_zero/x_max, using defaults for X\n", filename);
+        }
+        c->x_min = defaults.x_min;
+        c->x_max = defaults.x_max;
+        c->x_zero = defaults.x_zero;
+    }
+    if (!(c->y_min <= c->y_zero && c->y_zero <= c->y_max)) {
+        if (verbose) {
+            fprintf(stderr, "%s: inconsistent y_min/y_zero/y_max, using defaults for Y\n", filename);
+        }
+        c->y_min = defaults.y_min;
+        c->y_max = defaults.y_max;
+        c->y_zero = defaults.y_zero;
+    }
+    if (!cross_axis_valid(c)) {
+        if (verbose) {
+            fprintf(stderr, "%s: cross_* matrix out of range, cross-axis correction disabled\n", filename);
+        }
+        cross_axis_identity(c);
+    }
+}
+
+int load_calibration_chain(const char *override_dir,
+                           const char *primary_path,
+                           const char *fallback_dir,
+                           const char *filename,
+                           joypad_cali_t *out)
+{
+    set_default_calibration(out);
+
+    if (config_load_chain(override_dir, primary_path, fallback_dir, filename,
+                          parse_calibration_kv, out) == 0) {
+        sanitize_calibration(out, filename);
         return 0;
     }
 
-    fprintf(stderr, "Using default calibration for %s (files missing)\n", filename);
+    if (verbose) {
+        fprintf(stderr, "Using default calibration for %s (files missing)\n", filename);
+    }
     return -1;
 }
@@ -3,16 +3,84 @@
 
 #pragma once
 
+#include <stdbool.h>
+
 #include "../common.h"
 
 #define DEFAULT_DEADZONE 1024
 
+/**
+ * Callback invoked for every key=value pair of an INI-style config file.
+ *
+ * @param ctx   Caller context passed through unchanged.
+ * @param key   Trimmed key.
+ * @param value Trimmed value.
+ * @return true if the key was recognized and applied.
+ */
+typedef bool (*config_kv_handler_t)(void *ctx, const char *key, const char *value);
+
+/**
+ * Parse one key=value file ('#' comments and blank lines are skipped).
+ *
+ * @param path    File to read.
+ * @param handler Callback for each pair.
+ * @param ctx     Passed to the handler.
+ * @return 0 if at least one pair was applied, -1 otherwise.
+ */
+int config_parse_file(const char *path, config_kv_handler_t handler, void *ctx);
+
+/**
+ * Parse a decimal unsigned value with an upper bound.
+ *
+ * @param value Text to parse.
+ * @param max   Largest accepted value.
+ * @param out   Destination on success.
+ * @return true if the whole string was a number <= max.
+ */
+bool config_parse_uint(const char *value, unsigned long max, unsigned long *out);
+
+/**
+ * Parse a signed decimal value within [min, max].
+ *
+ * @param value Text to parse.
+ * @param min   Smallest accepted value.
+ * @param max   Largest accepted value.
+ * @param out   Destination on success.
+ * @return true if the whole string was a number in range.
+ */
+bool config_parse_int(const char *value, long min, long max, long *out);
+
+/**
+ * Enable or silence the config loader's informational and fallback messages (on by default).
+ *
+ * @param enable false to load configs quietly (repeated replays).
+ */
+void config_set_verbose(bool enable);
+
+/**
+ * Parse the first readable file of the override -> primary -> fallback chain.
+ *
+ * @param override_dir Optional directory provided via CLI.
+ * @param primary_path Path checked second (NULL to skip).
+ * @param fallback_dir Directory checked last (NULL to skip).
+ * @param filename     Filename within override/fallback directories.
+ * @param handler      Callback for each pair.
+ * @param ctx          Passed to the handler.
+ * @return 0 if a file was applied, -1 if every source failed.
+ */
+int config_load_chain(const char *override_dir,
+                      const char *primary_path,
+                      const char *fallback_dir,
+                      const char *filename,
+                      config_kv_handler_t handler,
+                      void *ctx);
+
 /**
  * Load joystick calibration following the override -> primary -> fallback chain.
  *
  * @param override_dir Optional directory provided via CLI.
- * @param primary_path Path checked first (typically /mnt/UDISK/...).
- * @param fallback_dir Directory that contains the stock config files.
+ * @param primary_path Path checked first (typically /mnt/UDISK/..., NULL to skip).
+ * @param fallback_dir Directory that contains the stock config files (NULL to skip).
  * @param filename     Filename within override/fallback directories.
  * @param out          Destination struct to populate.
  * @return 0 on success, -1 if all sources failed (defaults already applied).
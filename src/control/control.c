@@ -0,0 +1,224 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Local datagram control socket: one small text request in, one text reply out.
+
+#include "control.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <grp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Group by name, or by number for groups /etc/group does not list.
+static int resolve_group(const char *group, gid_t *gid)
+{
+    struct group *gr = getgrnam(group);
+    if (gr) {
+        *gid = gr->gr_gid;
+        return 0;
+    }
+    char *end;
+    unsigned long num = strtoul(group, &end, 10);
+    if (*group == '\0' || *end != '\0') {
+        return -1;
+    }
+    *gid = (gid_t)num;
+    return 0;
+}
+
+int control_open(control_t *ctl, const char *path, unsigned int mode, const char *group)
+{
+    ctl->fd = -1;
+    ctl->path[0] = '\0';
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (!path || strlen(path) >= sizeof addr.sun_path) {
+        fprintf(stderr, "Control socket path too long\n");
+        return -1;
+    }
+    snprintf(addr.sun_path, sizeof addr.sun_path, "%s", path);
+
+    gid_t gid = (gid_t)-1;
+    if (group && resolve_group(group, &gid) != 0) {
+        fprintf(stderr, "Control socket group %s not found\n", group);
+        return -1;
+    }
+    const mode_t perms = (mode ? mode : CONTROL_DEFAULT_MODE) & 0777;
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("control socket");
+        return -1;
+    }
+
+    // Only replace a stale socket; never delete some other file that happens to be there.
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "Control socket path %s exists and is not a socket\n", path);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+    }
+    // The socket drives the motor: never wider than asked, not even before the chmod,
+    // and the group is set before its bits are.
+    mode_t old_mask = umask(~perms & 0777);
+    int ret = bind(fd, (struct sockaddr *)&addr, sizeof addr);
+    umask(old_mask);
+    if (ret == 0 && group) {
+        ret = chown(path, (uid_t)-1, gid);
+    }
+    if (ret < 0 || chmod(path, perms) < 0) {
+        fprintf(stderr, "Failed to bind control socket %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    ctl->fd = fd;
+    snprintf(ctl->path, sizeof ctl->path, "%s", path);
+    return 0;
+}
+
+void control_close(control_t *ctl)
+{
+    if (ctl->fd < 0) return;
+    close(ctl->fd);
+    unlink(ctl->path);
+    ctl->fd = -1;
+}
+
+static void send_reply(int fd, const struct sockaddr_un *to, socklen_t to_len,
+                       const char *reply, size_t len, int pass_fd)
+{
+    struct iovec iov = { .iov_base = (void *)reply, .iov_len = len };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {
+        .msg_name = (void *)to,
+        .msg_namelen = to_len,
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+    };
+    if (pass_fd >= 0) {
+        memset(&control, 0, sizeof control);
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof control.buf;
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &pass_fd, sizeof pass_fd);
+    }
+    sendmsg(fd, &msg, MSG_DONTWAIT);
+}
+
+void control_service(control_t *ctl, control_handler_t handler, void *ctx)
+{
+    if (ctl->fd < 0) return;
+
+    char request[CONTROL_MAX_DATAGRAM];
+    char reply[CONTROL_MAX_DATAGRAM];
+    while (true) {
+        struct sockaddr_un from;
+        socklen_t from_len = sizeof from;
+        ssize_t r = recvfrom(ctl->fd, request, sizeof request - 1, 0,
+                             (struct sockaddr *)&from, &from_len);
+        if (r < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("control recvfrom");
+            }
+            break;
+        }
+
+        while (r > 0 && isspace((unsigned char)request[r - 1])) {
+            --r;
+        }
+        request[r] = '\0';
+
+        int reply_fd = -1;
+        size_t n = handler(ctx, request, reply, sizeof reply, &reply_fd);
+        if (n > 0 && from_len > sizeof(sa_family_t)) {
+            send_reply(ctl->fd, &from, from_len, reply, n, reply_fd);
+        }
+        if (reply_fd >= 0) {
+            close(reply_fd);
+        }
+    }
+}
+
+int control_request(const char *path, const char *request, char *reply, size_t reply_len,
+                    int *reply_fd, int timeout_ms)
+{
+    if (reply_fd) {
+        *reply_fd = -1;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof addr.sun_path) {
+        return -1;
+    }
+    snprintf(addr.sun_path, sizeof addr.sun_path, "%s", path);
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    // Autobind an abstract address so the daemon has somewhere to reply to.
+    struct sockaddr_un self = { .sun_family = AF_UNIX };
+    if (bind(fd, (struct sockaddr *)&self, sizeof(sa_family_t)) < 0 ||
+        sendto(fd, request, strlen(request), 0, (struct sockaddr *)&addr, sizeof addr) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+        close(fd);
+        return -1;
+    }
+
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { .iov_base = reply, .iov_len = reply_len - 1 };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof control.buf,
+    };
+    ssize_t r = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    close(fd);
+    if (r < 0) {
+        return -1;
+    }
+    reply[r] = '\0';
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        int passed;
+        memcpy(&passed, CMSG_DATA(cmsg), sizeof passed);
+        if (reply_fd) {
+            *reply_fd = passed;
+        } else {
+            close(passed);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stddef.h>
+
+#define CONTROL_DEFAULT_PATH "/run/trimui_inputd.sock"
+#define CONTROL_DEFAULT_MODE 0600
+#define CONTROL_MAX_DATAGRAM 512
+
+/**
+ * Handle one request datagram.
+ *
+ * @param ctx       Caller context.
+ * @param request   NUL-terminated request with trailing whitespace removed.
+ * @param reply     Buffer for the reply text.
+ * @param reply_len Size of the reply buffer.
+ * @param reply_fd  Set to a descriptor to pass along with the reply (SCM_RIGHTS); starts at -1.
+ *                  Ownership passes to the socket layer, which closes it after the reply.
+ * @return Reply length; 0 sends nothing.
+ */
+typedef size_t (*control_handler_t)(void *ctx, const char *request, char *reply, size_t reply_len,
+                                    int *reply_fd);
+
+/**
+ * Local control endpoint (AF_UNIX datagram socket).
+ */
+typedef struct {
+    int fd;
+    char path[108];
+} control_t;
+
+/**
+ * Bind the control socket, replacing a stale socket file at the same path.
+ *
+ * @param ctl   Endpoint to initialize (fd is -1 on failure).
+ * @param path  Filesystem path to bind.
+ * @param mode  Permission bits for the socket file; 0 for CONTROL_DEFAULT_MODE.
+ * @param group Group name or number to own the socket file; NULL keeps the daemon's.
+ * @return 0 on success, -1 on error.
+ */
+int control_open(control_t *ctl, const char *path, unsigned int mode, const char *group);
+
+/**
+ * Close the socket and unlink its path.
+ *
+ * @param ctl Endpoint to close.
+ */
+void control_close(control_t *ctl);
+
+/**
+ * Drain pending datagrams, answering each sender that bound a reply address.
+ *
+ * @param ctl     Endpoint to service.
+ * @param handler Request callback.
+ * @param ctx     Passed to the handler.
+ */
+void control_service(control_t *ctl, control_handler_t handler, void *ctx);
+
+/**
+ * Client side: send one request from an autobound socket and wait for the reply.
+ *
+ * @param path       Control socket path.
+ * @param request    Request text.
+ * @param reply      Buffer for the NUL-terminated reply.
+ * @param reply_len  Size of the reply buffer.
+ * @param reply_fd   Receives a descriptor passed with the reply, or -1 (may be NULL).
+ * @param timeout_ms How long to wait for the reply.
+ * @return 0 on success, -1 on error or timeout.
+ */
+int control_request(const char *path, const char *request, char *reply, size_t reply_len,
+                    int *reply_fd, int timeout_ms);
@@ -7,6 +7,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <linux/input.h>
 #include <linux/uinput.h>
 #include <poll.h>
@@ -21,10 +22,21 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "../affinity/irq-affinity.h"
+#include "../calibration/cross-axis.h"
+#include "../clock/clock.h"
 #include "../config/config.h"
+#include "../control/control.h"
+#include "../filter/stick-filter.h"
 #include "../gpio/gpio.h"
+#include "../power/pm-qos.h"
+#include "../power/uclamp.h"
+#include "../ring/frame-ring.h"
 #include "../rumble/rumble.h"
+#include "../rumble/rumble-latency.h"
 #include "../serial/serial-joystick.h"
+#include "../sim/trace.h"
+#include "../stats/stage-profile.h"
 
 #define LEFT_SERIAL_PORT "/dev/ttyS4"
 #define RIGHT_SERIAL_PORT "/dev/ttyS3"
@@ -34,6 +46,19 @@
 #define CONFIG_FALLBACK_DIR "/userdata/system/config/trimui-input"
 #define LEFT_CONFIG_NAME "joypad.config"
 #define RIGHT_CONFIG_NAME "joypad_right.config"
+#define RUMBLE_CONFIG_PRIMARY "/mnt/UDISK/rumble.config"
+#define RUMBLE_CONFIG_NAME "rumble.config"
+#define HAPTICS_CONFIG_PRIMARY "/mnt/UDISK/haptics.config"
+#define HAPTICS_CONFIG_NAME "haptics.config"
+#define FILTER_CONFIG_PRIMARY "/mnt/UDISK/filter.config"
+#define FILTER_CONFIG_NAME "filter.config"
+
+#define STARTUP_SETTLE_MS 1000   // Sticks stay gated this long after the uinput device appears.
+#define SERIAL_RETRY_MIN_MS 100
+#define SERIAL_RETRY_MAX_MS 2000
+#define PAD_READ_BUDGET_DEFAULT 4  // read(2) calls per pad per loop round.
+#define PAD_READ_BYTES 32
+#define PAD_READ_FRAMES SERIAL_FRAMES_MAX(PAD_READ_BYTES)
 
 #define AXIS_MIN (-32768)
 #define AXIS_MAX (32767)
@@ -44,16 +69,34 @@ typedef enum {
     SIDE_RIGHT = 1
 } joystick_side_t;
 
+// Scheduling counters for one pad (see service_pads()).
+typedef struct {
+    uint64_t reads;             // read_pad() calls.
+    uint64_t frames;            // Frames decoded (a read can complete several).
+    uint64_t budget_hits;       // Rounds that ended with input still pending.
+    uint32_t streak;            // Consecutive budget-limited rounds so far.
+    uint32_t max_streak;
+    int max_backlog;            // Most bytes left in the tty queue when the budget ran out.
+    int64_t max_wait_ns;        // poll() return -> first read of this pad in a round.
+} pad_sched_stats_t;
+
 // State for one serial pad half (file descriptor, calibration, last values).
 typedef struct {
     const char *serial_path;
     const char *primary_cfg;
     const char *fallback_name;
     joypad_cali_t calibration;
+    serial_parser_t parser;
+    stick_filter_t filter;
     joybutton_t last_buttons;
     int16_t last_x;
     int16_t last_y;
     int fd;
+    int64_t retry_ns;       // Next reopen attempt while fd < 0 (0 = none scheduled).
+    unsigned int retry_ms;  // Current reopen backoff.
+    bool irq_steered;       // UART IRQ routed to irq_cpu.
+    irq_affinity_prev_t irq_prev;   // Its affinity before, restored at exit.
+    pad_sched_stats_t sched;
 } halfpad_t;
 
 // Aggregated controller composed of both halves plus the uinput + rumble handles.
@@ -61,12 +104,47 @@ typedef struct {
     halfpad_t left;
     halfpad_t right;
     int uinput_fd;
+    int sink_fd; // Raw input_event sink used instead of uinput (--event-sink).
+    event_ring_t *out_ring; // Supervised worker: reports go to the supervisor instead.
+    bool resync_due;        // A published batch lost events; send the full state again.
     rumble_state_t rumble;
+    rumble_pattern_lib_t patterns;
+    control_t control;
+    frame_ring_t ring;
+    int keeper_fd;              // Supervised worker: where new ring subscriptions are kept (-1 = none).
+    clock_timer_t housekeeping; // Startup settle and serial reopen deadlines.
+    int64_t settle_ns;          // Stick output is gated until this time.
+    bool settled;
+    unsigned int pad_budget;    // Reads per pad per round.
+    unsigned int rr_first;      // Side served first in the next round.
+    uint64_t rounds;
+    int64_t max_round_ns;       // Longest poll() return -> end of servicing.
+    int64_t max_ff_wait_ns;     // poll() return -> uinput FF fd serviced.
+    int irq_cpu;                // CPU the loop and pad IRQs are pinned to (-1 = not pinned).
+    pm_qos_t qos;               // CPU latency request held while input changes.
+    uclamp_boost_t boost;       // util_min boost of the loop while input changes.
+    int64_t report_sample_ns;   // Newest sample time in the pending report.
+    bool report_stamped;        // report_sample_ns is set.
+    trace_writer_t recorder;
+    FILE *event_log; // When set, events are rendered as text here instead of uinput.
+    uint64_t sink_writes; // Output writes issued (one write(2) per event/GPIO edge when live).
     int8_t hat_x;
     int8_t hat_y;
 } controller_t;
 
+// Slots of the main loop's poll set; unused sources carry fd -1.
+enum {
+    PFD_LEFT = 0,
+    PFD_RIGHT,
+    PFD_UINPUT,
+    PFD_RUMBLE,
+    PFD_CONTROL,
+    PFD_HOUSEKEEPING,
+    PFD_COUNT
+};
+
 static volatile sig_atomic_t keep_running = 1;
+static volatile sig_atomic_t dump_stats = 0;
 
 static void handle_signal(int sig)
 {
@@ -74,6 +152,12 @@ static void handle_signal(int sig)
     keep_running = 0;
 }
 
+static void handle_dump_signal(int sig)
+{
+    (void)sig;
+    dump_stats = 1;
+}
+
 static inline int16_t clamp_axis(int value)
 {
     if (value > AXIS_MAX) return AXIS_MAX;
@@ -86,12 +170,8 @@ static inline int fast_round(double value)
     return (int)((value >= 0.0) ? (value + 0.5) : (value - 0.5));
 }
 
-static int16_t map_adc_to_axis(uint16_t raw,
-                               uint16_t min,
-                               uint16_t max,
-                               uint16_t zero,
-                               uint16_t deadzone,
-                               bool invert)
+// Center and scale one ADC reading to axis units (not yet inverted or deadzoned).
+static int32_t scale_adc(uint16_t raw, uint16_t min, uint16_t max, uint16_t zero)
 {
     int32_t centered = (int32_t)raw - (int32_t)zero;
     int32_t range = (centered >= 0)
@@ -107,7 +187,11 @@ static int16_t map_adc_to_axis(uint16_t raw,
     if (normalized < -1.0) normalized = -1.0;
 
     double scaled = normalized * (normalized >= 0.0 ? AXIS_MAX : -AXIS_MIN);
-    int value = fast_round(scaled);
+    return fast_round(scaled);
+}
+
+static int16_t finish_axis(int32_t value, uint16_t deadzone, bool invert)
+{
     if (invert) {
         value = -value;
     }
@@ -121,14 +205,78 @@ static int16_t map_adc_to_axis(uint16_t raw,
     return clamp_axis(value);
 }
 
-static int emit_event(int fd, uint16_t type, uint16_t code, int32_t value)
+static void capture_state(const controller_t *ctl, event_ring_state_t *st)
+{
+    st->buttons[0] = ctl->left.last_buttons.b;
+    st->buttons[1] = ctl->right.last_buttons.b;
+    st->axes[0] = ctl->left.last_x;
+    st->axes[1] = ctl->left.last_y;
+    st->axes[2] = ctl->right.last_x;
+    st->axes[3] = ctl->right.last_y;
+    st->hat_x = ctl->hat_x;
+    st->hat_y = ctl->hat_y;
+}
+
+static void restore_state(controller_t *ctl, const event_ring_state_t *st)
+{
+    ctl->left.last_buttons.b = st->buttons[0];
+    ctl->right.last_buttons.b = st->buttons[1];
+    ctl->left.last_x = st->axes[0];
+    ctl->left.last_y = st->axes[1];
+    ctl->right.last_x = st->axes[2];
+    ctl->right.last_y = st->axes[3];
+    ctl->hat_x = st->hat_x;
+    ctl->hat_y = st->hat_y;
+}
+
+// Load the effects and gain the game gave an earlier worker; the kernel still holds them.
+static void restore_ff(controller_t *ctl, const event_ring_ff_t *ff)
+{
+    const uint32_t in_use = __atomic_load_n(&ff->in_use, __ATOMIC_ACQUIRE);
+    int restored = 0;
+    for (int id = 0; id < EVENT_RING_FF_EFFECTS; ++id) {
+        if (in_use & (1u << id)) {
+            struct ff_effect effect = ff->effects[id];
+            if (rumble_upload_effect(&ctl->rumble, &effect) == 0) {
+                ++restored;
+            }
+        }
+    }
+    if (__atomic_load_n(&ff->gain_set, __ATOMIC_ACQUIRE)) {
+        rumble_apply_gain(&ctl->rumble, ff->gain);
+    }
+    if (restored) {
+        fprintf(stderr, "Restored %d FF effect(s) from the previous worker\n", restored);
+    }
+}
+
+static int write_event(controller_t *ctl, uint16_t type, uint16_t code, int32_t value)
 {
     struct input_event ev;
     memset(&ev, 0, sizeof ev);
-    gettimeofday(&ev.time, NULL);
+    clock_realtime(&ev.time);
     ev.type = type;
     ev.code = code;
     ev.value = value;
+    ctl->sink_writes++;
+    if (ctl->event_log) {
+        fprintf(ctl->event_log, "%lld EV %u %u %d\n",
+                (long long)ev.time.tv_sec * 1000000LL + ev.time.tv_usec, type, code, value);
+        return 0;
+    }
+    if (ctl->out_ring) {
+        event_ring_append(ctl->out_ring, &ev);
+        if (type == EV_SYN && code == SYN_REPORT) {
+            event_ring_state_t state;
+            capture_state(ctl, &state);
+            ctl->resync_due |= event_ring_commit(ctl->out_ring, &state);
+        }
+        return 0;
+    }
+    int fd = (ctl->uinput_fd >= 0) ? ctl->uinput_fd : ctl->sink_fd;
+    if (fd < 0) {
+        return 0; // Null sink (simulation without output).
+    }
     if (write(fd, &ev, sizeof ev) < 0) {
         perror("write uinput");
         return -1;
@@ -136,9 +284,36 @@ static int emit_event(int fd, uint16_t type, uint16_t code, int32_t value)
     return 0;
 }
 
-static int sync_events(int fd)
+static int emit_event(controller_t *ctl, uint16_t type, uint16_t code, int32_t value)
+{
+    stage_profile_enter(PROFILE_STAGE_EMIT);
+    int res = write_event(ctl, type, code, value);
+    stage_profile_leave();
+    return res;
+}
+
+static int sync_events(controller_t *ctl)
 {
-    return emit_event(fd, EV_SYN, SYN_REPORT, 0);
+    return emit_event(ctl, EV_SYN, SYN_REPORT, 0);
+}
+
+// Close a report built from serial samples: MSC_TIMESTAMP carries when the newest frame
+// started on the wire (CLOCK_MONOTONIC microseconds, wrapping at 32 bits like hardware
+// timestamps) so consumers can see past our read/decode/emit latency, then SYN_REPORT.
+static int finish_report(controller_t *ctl)
+{
+    if (ctl->report_stamped) {
+        uint32_t usec = (uint32_t)(ctl->report_sample_ns / 1000);
+        emit_event(ctl, EV_MSC, MSC_TIMESTAMP, (int32_t)usec);
+        ctl->report_stamped = false;
+    }
+    return sync_events(ctl);
+}
+
+// A frame completes with its last byte; bytes read after it were still arriving.
+static int64_t sample_time_ns(int64_t read_ns, size_t bytes_read, size_t frame_end)
+{
+    return read_ns - (int64_t)(bytes_read - frame_end + SERIAL_FRAME_LEN) * SERIAL_BYTE_NS;
 }
 
 static int configure_abs_axis(int fd, uint16_t code, int min, int max, int flat)
@@ -175,12 +350,19 @@ static int create_uinput_device(controller_t *ctl)
     if (ioctl(fd, UI_SET_EVBIT, EV_KEY) == -1 ||
         ioctl(fd, UI_SET_EVBIT, EV_ABS) == -1 ||
         ioctl(fd, UI_SET_EVBIT, EV_SYN) == -1 ||
+        ioctl(fd, UI_SET_EVBIT, EV_MSC) == -1 ||
         ioctl(fd, UI_SET_EVBIT, EV_FF) == -1) {
         perror("ioctl UI_SET_EVBIT");
         close(fd);
         return -1;
     }
 
+    if (ioctl(fd, UI_SET_MSCBIT, MSC_TIMESTAMP) == -1) {
+        perror("ioctl UI_SET_MSCBIT");
+        close(fd);
+        return -1;
+    }
+
     if (ioctl(fd, UI_SET_FFBIT, FF_RUMBLE) == -1 ||
         ioctl(fd, UI_SET_FFBIT, FF_GAIN) == -1) {
         perror("ioctl UI_SET_FFBIT");
@@ -270,8 +452,6 @@ static int create_uinput_device(controller_t *ctl)
         close(fd);
         return -1;
     }
-
-    usleep(1000000); // allow extra time for sticks to settle before zeroing
     return fd;
 }
 
@@ -282,6 +462,43 @@ static void destroy_uinput_device(int fd)
     close(fd);
 }
 
+int controller_create_device(const controller_options_t *opts)
+{
+    // Only the deadzones (axis flats) are needed from the controller state.
+    controller_t ctl;
+    memset(&ctl, 0, sizeof ctl);
+    load_calibration_chain(opts->config_override_dir, LEFT_CONFIG_PRIMARY, CONFIG_FALLBACK_DIR,
+                           LEFT_CONFIG_NAME, &ctl.left.calibration);
+    load_calibration_chain(opts->config_override_dir, RIGHT_CONFIG_PRIMARY, CONFIG_FALLBACK_DIR,
+                           RIGHT_CONFIG_NAME, &ctl.right.calibration);
+    return create_uinput_device(&ctl);
+}
+
+void controller_destroy_device(int fd)
+{
+    destroy_uinput_device(fd);
+}
+
+int controller_calibrate_cross(const controller_options_t *opts, const char *side)
+{
+    bool left = strcmp(side, "left") == 0;
+    if (!left && strcmp(side, "right") != 0) {
+        fprintf(stderr, "Cross-axis sweep side must be left or right, got '%s'\n", side);
+        return 1;
+    }
+    const char *serial_path = left ? (opts->left_serial ? opts->left_serial : LEFT_SERIAL_PORT)
+                                   : (opts->right_serial ? opts->right_serial : RIGHT_SERIAL_PORT);
+    const char *config_name = left ? LEFT_CONFIG_NAME : RIGHT_CONFIG_NAME;
+
+    joypad_cali_t cali;
+    load_calibration_chain(opts->config_override_dir, left ? LEFT_CONFIG_PRIMARY : RIGHT_CONFIG_PRIMARY,
+                           CONFIG_FALLBACK_DIR, config_name, &cali);
+    // The pads need power; the daemon must not be running, or it would steal the frames.
+    gpio_board_init();
+    return cross_axis_sweep_run(serial_path, &cali, config_name);
+}
+
+// (Re)open a pad port; on failure schedule the next attempt with exponential backoff.
 static int reopen_serial(halfpad_t *pad)
 {
     if (pad->fd >= 0) {
@@ -289,16 +506,60 @@ static int reopen_serial(halfpad_t *pad)
         pad->fd = -1;
     }
 
+    resetSerialParser(&pad->parser);
     pad->fd = openSerialJoystick(pad->serial_path);
-    if (pad->fd < 0) {
-        fprintf(stderr, "Failed to open %s\n", pad->serial_path);
-    } else {
+    if (pad->fd >= 0) {
         fprintf(stdout, "Opened %s\n", pad->serial_path);
+        pad->retry_ns = 0;
+        pad->retry_ms = 0;
+        return pad->fd;
+    }
+
+    if (pad->retry_ms == 0) {
+        fprintf(stderr, "Failed to open %s, retrying in the background\n", pad->serial_path);
+        pad->retry_ms = SERIAL_RETRY_MIN_MS;
+    } else if (pad->retry_ms < SERIAL_RETRY_MAX_MS) {
+        pad->retry_ms = (pad->retry_ms * 2 > SERIAL_RETRY_MAX_MS) ? SERIAL_RETRY_MAX_MS : pad->retry_ms * 2;
+    }
+    pad->retry_ns = clock_now_ns() + (int64_t)pad->retry_ms * 1000000LL;
+    return -1;
+}
+
+// The kernel only lists a UART's IRQ while the port is open, so this runs after each open
+// until it succeeds; the affinity then sticks across later close/reopen cycles.
+static void steer_pad_irq(controller_t *ctl, halfpad_t *pad)
+{
+    if (ctl->irq_cpu < 0 || pad->fd < 0 || pad->irq_steered) {
+        return;
+    }
+    pad->irq_steered = irq_affinity_steer(pad->serial_path, ctl->irq_cpu, &pad->irq_prev, stderr) >= 0;
+    // A restarted worker finds the IRQ already moved, so only the first one saw the
+    // original list; the supervisor keeps it and restores it at exit.
+    irq_affinity_prev_t *kept = ctl->out_ring ? &ctl->out_ring->shm->irq_prev[pad == &ctl->left ? 0 : 1] : NULL;
+    if (kept && kept->irq < 0 && pad->irq_prev.irq >= 0) {
+        *kept = pad->irq_prev;
     }
-    return pad->fd;
 }
 
-static bool update_buttons(int ufd, joystick_side_t side, joybutton_t *last, joybutton_t current)
+static void arm_housekeeping(controller_t *ctl)
+{
+    int64_t next = 0;
+    const int64_t pending[] = { ctl->settled ? 0 : ctl->settle_ns, ctl->left.retry_ns, ctl->right.retry_ns,
+                                pm_qos_deadline(&ctl->qos), uclamp_boost_deadline(&ctl->boost) };
+    for (size_t i = 0; i < sizeof pending / sizeof pending[0]; ++i) {
+        if (pending[i] > 0 && (next == 0 || pending[i] < next)) {
+            next = pending[i];
+        }
+    }
+    if (next == 0) {
+        clock_timer_disarm(&ctl->housekeeping);
+        return;
+    }
+    struct timespec deadline = { .tv_sec = (time_t)(next / 1000000000LL), .tv_nsec = (long)(next % 1000000000LL) };
+    clock_timer_arm(&ctl->housekeeping, &deadline);
+}
+
+static bool update_buttons(controller_t *ctl, joystick_side_t side, joybutton_t *last, joybutton_t current)
 {
     typedef struct {
         uint8_t mask;
@@ -339,7 +600,7 @@ static bool update_buttons(int ufd, joystick_side_t side, joybutton_t *last, joy
         if (prev_state == curr_state) {
             continue;
         }
-        emit_event(ufd, EV_KEY, map[i].code, curr_state ? 1 : 0);
+        emit_event(ctl, EV_KEY, map[i].code, curr_state ? 1 : 0);
         dirty = true;
     }
 
@@ -365,12 +626,12 @@ static bool update_hat(controller_t *ctl, joybutton_t buttons)
 
     bool dirty = false;
     if (new_x != ctl->hat_x) {
-        emit_event(ctl->uinput_fd, EV_ABS, ABS_HAT0X, new_x);
+        emit_event(ctl, EV_ABS, ABS_HAT0X, new_x);
         ctl->hat_x = new_x;
         dirty = true;
     }
     if (new_y != ctl->hat_y) {
-        emit_event(ctl->uinput_fd, EV_ABS, ABS_HAT0Y, new_y);
+        emit_event(ctl, EV_ABS, ABS_HAT0Y, new_y);
         ctl->hat_y = new_y;
         dirty = true;
     }
@@ -378,53 +639,41 @@ static bool update_hat(controller_t *ctl, joybutton_t buttons)
     return dirty;
 }
 
-static bool update_axes(int ufd, joystick_side_t side, halfpad_t *pad, const joypad_struct_t *packet)
+static bool update_axes(controller_t *ctl, joystick_side_t side, halfpad_t *pad, const joypad_struct_t *packet)
 {
     bool dirty = false;
     int16_t x, y;
+    const joypad_cali_t *cali = &pad->calibration;
+    stage_profile_enter(PROFILE_STAGE_MAP);
+    int32_t sx = scale_adc(packet->x, cali->x_min, cali->x_max, cali->x_zero);
+    int32_t sy = scale_adc(packet->y, cali->y_min, cali->y_max, cali->y_zero);
+    if (!cross_axis_is_identity(cali)) {
+        // Undo the X/Y coupling before the deadzone, so a straight push does not leak
+        // past the other axis' deadzone.
+        cross_axis_apply(cali, &sx, &sy);
+    }
+    x = finish_axis(sx, cali->deadzone, true);
+    y = finish_axis(sy, cali->deadzone, true);
+    stage_profile_leave();
     if (side == SIDE_LEFT) {
-        x = map_adc_to_axis(packet->x,
-                            pad->calibration.x_min,
-                            pad->calibration.x_max,
-                            pad->calibration.x_zero,
-                            pad->calibration.deadzone,
-                            true);
-        y = map_adc_to_axis(packet->y,
-                            pad->calibration.y_min,
-                            pad->calibration.y_max,
-                            pad->calibration.y_zero,
-                            pad->calibration.deadzone,
-                            true);
         if (x != pad->last_x) {
-            emit_event(ufd, EV_ABS, ABS_X, x);
+            emit_event(ctl, EV_ABS, ABS_X, x);
             pad->last_x = x;
             dirty = true;
         }
         if (y != pad->last_y) {
-            emit_event(ufd, EV_ABS, ABS_Y, y);
+            emit_event(ctl, EV_ABS, ABS_Y, y);
             pad->last_y = y;
             dirty = true;
         }
     } else {
-        x = map_adc_to_axis(packet->x,
-                            pad->calibration.x_min,
-                            pad->calibration.x_max,
-                            pad->calibration.x_zero,
-                            pad->calibration.deadzone,
-                            true);
-        y = map_adc_to_axis(packet->y,
-                            pad->calibration.y_min,
-                            pad->calibration.y_max,
-                            pad->calibration.y_zero,
-                            pad->calibration.deadzone,
-                            true);
         if (x != pad->last_x) {
-            emit_event(ufd, EV_ABS, ABS_Z, x);
+            emit_event(ctl, EV_ABS, ABS_Z, x);
             pad->last_x = x;
             dirty = true;
         }
         if (y != pad->last_y) {
-            emit_event(ufd, EV_ABS, ABS_RZ, y);
+            emit_event(ctl, EV_ABS, ABS_RZ, y);
             pad->last_y = y;
             dirty = true;
         }
@@ -434,12 +683,12 @@ static bool update_axes(int ufd, joystick_side_t side, halfpad_t *pad, const joy
 
 static void prime_state(controller_t *ctl)
 {
-    emit_event(ctl->uinput_fd, EV_ABS, ABS_X, 0);
-    emit_event(ctl->uinput_fd, EV_ABS, ABS_Y, 0);
-    emit_event(ctl->uinput_fd, EV_ABS, ABS_Z, 0);
-    emit_event(ctl->uinput_fd, EV_ABS, ABS_RZ, 0);
-    emit_event(ctl->uinput_fd, EV_ABS, ABS_HAT0X, 0);
-    emit_event(ctl->uinput_fd, EV_ABS, ABS_HAT0Y, 0);
+    emit_event(ctl, EV_ABS, ABS_X, 0);
+    emit_event(ctl, EV_ABS, ABS_Y, 0);
+    emit_event(ctl, EV_ABS, ABS_Z, 0);
+    emit_event(ctl, EV_ABS, ABS_RZ, 0);
+    emit_event(ctl, EV_ABS, ABS_HAT0X, 0);
+    emit_event(ctl, EV_ABS, ABS_HAT0Y, 0);
     ctl->hat_x = 0;
     ctl->hat_y = 0;
 
@@ -449,9 +698,236 @@ static void prime_state(controller_t *ctl)
         BTN_SELECT, BTN_START, BTN_MODE
     };
     for (size_t i = 0; i < sizeof buttons / sizeof buttons[0]; ++i) {
-        emit_event(ctl->uinput_fd, EV_KEY, buttons[i], 0);
+        emit_event(ctl, EV_KEY, buttons[i], 0);
+    }
+    sync_events(ctl);
+}
+
+// Re-send every axis, the hat and every button at its current value after a batch lost
+// events. The input core drops the ones the device already has.
+static void resync_state(controller_t *ctl)
+{
+    ctl->resync_due = false;
+    emit_event(ctl, EV_ABS, ABS_X, ctl->left.last_x);
+    emit_event(ctl, EV_ABS, ABS_Y, ctl->left.last_y);
+    emit_event(ctl, EV_ABS, ABS_Z, ctl->right.last_x);
+    emit_event(ctl, EV_ABS, ABS_RZ, ctl->right.last_y);
+    emit_event(ctl, EV_ABS, ABS_HAT0X, ctl->hat_x);
+    emit_event(ctl, EV_ABS, ABS_HAT0Y, ctl->hat_y);
+
+    // Diffing against the complement makes every mapped button differ.
+    joybutton_t left = ctl->left.last_buttons;
+    joybutton_t right = ctl->right.last_buttons;
+    ctl->left.last_buttons.b = (uint8_t)~left.b;
+    ctl->right.last_buttons.b = (uint8_t)~right.b;
+    update_buttons(ctl, SIDE_LEFT, &ctl->left.last_buttons, left);
+    update_buttons(ctl, SIDE_RIGHT, &ctl->right.last_buttons, right);
+    sync_events(ctl);
+}
+
+// Stick/button/hat changes keep both the QoS request and the util_min boost up; FF
+// requests only keep the boost, since a rumble does not need a bounded wakeup latency.
+// Only a request/boost that just turned on needs the timer; later activity just pushes
+// the idle deadlines, which run_housekeeping() re-checks when the earlier one fires.
+static void note_activity(controller_t *ctl, int64_t now_ns, bool input)
+{
+    bool qos_taken = input && pm_qos_activity(&ctl->qos, now_ns);
+    bool boosted = uclamp_boost_activity(&ctl->boost, now_ns);
+    if (qos_taken || boosted) {
+        arm_housekeeping(ctl);
+    }
+}
+
+// Fire due startup/reopen deadlines and re-arm for the next one.
+static void run_housekeeping(controller_t *ctl)
+{
+    clock_timer_consume(&ctl->housekeeping);
+    int64_t now = clock_now_ns();
+    if (!ctl->settled && now >= ctl->settle_ns) {
+        ctl->settled = true;
+        prime_state(ctl);
+    }
+    halfpad_t *pads[] = { &ctl->left, &ctl->right };
+    for (size_t i = 0; i < sizeof pads / sizeof pads[0]; ++i) {
+        if (pads[i]->fd < 0 && pads[i]->retry_ns > 0 && now >= pads[i]->retry_ns) {
+            reopen_serial(pads[i]);
+            steer_pad_irq(ctl, pads[i]);
+        }
+    }
+    pm_qos_expire(&ctl->qos, now);
+    uclamp_boost_expire(&ctl->boost, now);
+    arm_housekeeping(ctl);
+}
+
+static void process_sample(controller_t *ctl, joystick_side_t side, const joypad_struct_t *sample,
+                           int64_t sample_ns)
+{
+    halfpad_t *pad = (side == SIDE_LEFT) ? &ctl->left : &ctl->right;
+    int64_t now_ns = clock_now_ns();
+    joypad_struct_t filtered = *sample;
+    stage_profile_frame();
+    stage_profile_enter(PROFILE_STAGE_DIFF);
+    stage_profile_enter(PROFILE_STAGE_MAP);
+    stick_filter_apply(&pad->filter, sample_ns, &filtered.x, &filtered.y);
+    stage_profile_leave();
+    bool axis_dirty = update_axes(ctl, side, pad, &filtered);
+    bool btn_dirty = update_buttons(ctl, side, &pad->last_buttons, sample->buttons);
+    bool hat_dirty = (side == SIDE_LEFT) ? update_hat(ctl, sample->buttons) : false;
+
+    if (ctl->ring.shm) {
+        stage_profile_enter(PROFILE_STAGE_EMIT);
+        frame_ring_slot_t frame = {
+            .t_ns = now_ns,
+            .side = (side == SIDE_LEFT) ? 0 : 1,
+            .buttons = sample->buttons.b,
+            .hat_x = (side == SIDE_LEFT) ? ctl->hat_x : 0,
+            .hat_y = (side == SIDE_LEFT) ? ctl->hat_y : 0,
+            .raw_x = sample->x,
+            .raw_y = sample->y,
+            .axis_x = pad->last_x,
+            .axis_y = pad->last_y,
+        };
+        frame_ring_publish(&ctl->ring, &frame);
+        stage_profile_leave();
+    }
+    stage_profile_leave();
+    bool dirty = axis_dirty || btn_dirty || hat_dirty;
+    if (dirty && (!ctl->report_stamped || sample_ns > ctl->report_sample_ns)) {
+        ctl->report_sample_ns = sample_ns;
+        ctl->report_stamped = true;
+    }
+    if (dirty) {
+        note_activity(ctl, now_ns, true);
+    }
+}
+
+// Before a later frame of the same read: close the report the earlier ones left open, so
+// each frame's changes carry their own MSC_TIMESTAMP and a tap never shows up as a press
+// and its release in one SYN_REPORT. The newest frame's report is closed by the caller.
+static void close_older_report(controller_t *ctl, size_t frame_index)
+{
+    if (frame_index > 0 && ctl->report_stamped) {
+        finish_report(ctl);
+    }
+}
+
+static void record(controller_t *ctl, const trace_record_t *rec)
+{
+    if (ctl->recorder.f) {
+        trace_write(&ctl->recorder, clock_now_ns(), rec);
     }
-    sync_events(ctl->uinput_fd);
+}
+
+// One read(2); every frame it completes lands in frames[] with its own wire timestamp.
+static int read_pad(controller_t *ctl, joystick_side_t side, serial_frame_t *frames,
+                    int64_t *sample_ns)
+{
+    halfpad_t *pad = (side == SIDE_LEFT) ? &ctl->left : &ctl->right;
+    uint8_t buf[PAD_READ_BYTES];
+
+    stage_profile_enter(PROFILE_STAGE_READ);
+    int r = readSerialBytes(pad->fd, buf, sizeof buf);
+    int64_t read_ns = clock_now_ns();
+    stage_profile_leave();
+    if (r <= 0) {
+        return r;
+    }
+    if (ctl->recorder.f) {
+        trace_record_t rec = { .kind = (side == SIDE_LEFT) ? TRACE_SERIAL_LEFT : TRACE_SERIAL_RIGHT };
+        memcpy(rec.data, buf, (size_t)r);
+        rec.len = (size_t)r;
+        record(ctl, &rec);
+    }
+    stage_profile_enter(PROFILE_STAGE_PARSE);
+    size_t count = parseSerialFrames(&pad->parser, buf, (size_t)r, frames, PAD_READ_FRAMES);
+    stage_profile_leave();
+    for (size_t i = 0; i < count; ++i) {
+        sample_ns[i] = sample_time_ns(read_ns, (size_t)r, frames[i].end);
+    }
+    return (int)count;
+}
+
+static void note_pad_wait(halfpad_t *pad, int64_t woke_ns)
+{
+    int64_t wait = clock_now_ns() - woke_ns;
+    if (wait > pad->sched.max_wait_ns) {
+        pad->sched.max_wait_ns = wait;
+    }
+}
+
+// Read both pads round-robin, at most pad_budget reads each, so a flooding line cannot
+// starve the other pad or the FF/control sources behind it. Input left over when a budget
+// runs out keeps the fd readable and is picked up by the next round.
+static bool service_pads(controller_t *ctl, const struct pollfd *pfds, int64_t woke_ns)
+{
+    halfpad_t *pads[2] = { &ctl->left, &ctl->right };
+    const short ready_mask = POLLIN | POLLERR | POLLHUP;
+    unsigned int budget[2];
+
+    budget[SIDE_LEFT] = (pfds[PFD_LEFT].revents & ready_mask) ? ctl->pad_budget : 0;
+    budget[SIDE_RIGHT] = (pfds[PFD_RIGHT].revents & ready_mask) ? ctl->pad_budget : 0;
+    const unsigned int first = ctl->rr_first;
+    ctl->rr_first ^= 1u;
+
+    while (budget[SIDE_LEFT] || budget[SIDE_RIGHT]) {
+        for (unsigned int k = 0; k < 2; ++k) {
+            joystick_side_t side = (joystick_side_t)((first + k) & 1u);
+            halfpad_t *pad = pads[side];
+            if (budget[side] == 0) {
+                continue;
+            }
+            if (budget[side] == ctl->pad_budget) {
+                note_pad_wait(pad, woke_ns);
+            }
+
+            serial_frame_t frames[PAD_READ_FRAMES];
+            int64_t sample_ns[PAD_READ_FRAMES];
+            int read_res = read_pad(ctl, side, frames, sample_ns);
+            pad->sched.reads++;
+            if (read_res < 0) {
+                fprintf(stderr, "%s serial read error, trying to reopen...\n",
+                        side == SIDE_LEFT ? "Left" : "Right");
+                reopen_serial(pad);
+                arm_housekeeping(ctl);
+                budget[side] = 0;
+                continue;
+            }
+            if (read_res == 0) {
+                // No frame: either the line is idle, or it only carried noise and may
+                // still be flooding, in which case the read counts against the budget.
+                int pending = 0;
+                if (ioctl(pad->fd, FIONREAD, &pending) != 0 || pending <= 0) {
+                    budget[side] = 0;
+                    pad->sched.streak = 0;
+                    continue;
+                }
+            }
+
+            pad->sched.frames += (uint64_t)read_res;
+            if (ctl->settled) {
+                // Every frame, not just the newest: the ring and the stick filter see them all.
+                for (int f = 0; f < read_res; ++f) {
+                    close_older_report(ctl, f);
+                    process_sample(ctl, side, &frames[f].pad, sample_ns[f]);
+                }
+            }
+            if (--budget[side] == 0) {
+                int pending = 0;
+                if (ioctl(pad->fd, FIONREAD, &pending) == 0 && pending > 0) {
+                    pad->sched.budget_hits++;
+                    if (++pad->sched.streak > pad->sched.max_streak) {
+                        pad->sched.max_streak = pad->sched.streak;
+                    }
+                    if (pending > pad->sched.max_backlog) {
+                        pad->sched.max_backlog = pending;
+                    }
+                } else {
+                    pad->sched.streak = 0;
+                }
+            }
+        }
+    }
+    return ctl->report_stamped;
 }
 
 static void process_ff_upload(controller_t *ctl)
@@ -466,6 +942,18 @@ static void process_ff_upload(controller_t *ctl)
     upload.retval = rumble_upload_effect(&ctl->rumble, &upload.effect);
     if (upload.retval != 0) {
         fprintf(stderr, "Failed to upload rumble effect\n");
+    } else if (ctl->out_ring) {
+        event_ring_ff_store(ctl->out_ring, &upload.effect);
+    }
+    if (upload.retval == 0 && ctl->recorder.f && upload.effect.type == FF_RUMBLE) {
+        trace_record_t rec = {
+            .kind = TRACE_FF_UPLOAD,
+            .id = upload.effect.id,
+            .length_ms = upload.effect.replay.length,
+            .strong = upload.effect.u.rumble.strong_magnitude,
+            .weak = upload.effect.u.rumble.weak_magnitude,
+        };
+        record(ctl, &rec);
     }
 
     if (ioctl(ctl->uinput_fd, UI_END_FF_UPLOAD, &upload) < 0) {
@@ -483,6 +971,10 @@ static void process_ff_erase(controller_t *ctl)
     }
 
     erase.retval = rumble_erase_effect(&ctl->rumble, erase.effect_id);
+    if (erase.retval == 0 && ctl->out_ring) {
+        event_ring_ff_erase(ctl->out_ring, (int)erase.effect_id);
+    }
+    record(ctl, &(trace_record_t){ .kind = TRACE_FF_ERASE, .id = (int)erase.effect_id });
     if (erase.retval != 0) {
         fprintf(stderr, "Failed to erase rumble effect %d\n", erase.effect_id);
     }
@@ -507,6 +999,8 @@ static void process_uinput_events(controller_t *ctl)
         if (r != sizeof ev) {
             break;
         }
+        // DISPATCH is measured from here, the moment the request left the uinput queue.
+        int64_t dequeued_ns = rumble_latency_enabled() ? clock_now_ns() : 0;
 
         if (ev.type == EV_UINPUT) {
             if (ev.code == UI_FF_UPLOAD) {
@@ -519,76 +1013,483 @@ static void process_uinput_events(controller_t *ctl)
 
         if (ev.type == EV_FF) {
             if (ev.code == FF_GAIN) {
+                record(ctl, &(trace_record_t){ .kind = TRACE_FF_GAIN, .value = ev.value });
                 rumble_apply_gain(&ctl->rumble, (uint16_t)ev.value);
+                if (ctl->out_ring) {
+                    event_ring_ff_gain(ctl->out_ring, (uint16_t)ev.value);
+                }
             } else {
+                record(ctl, &(trace_record_t){ .kind = TRACE_FF_PLAY, .id = ev.code, .value = ev.value });
+                rumble_latency_begin(&ev.time, dequeued_ns);
                 rumble_play_effect(&ctl->rumble, ev.code, ev.value);
+                rumble_latency_end();
             }
         }
     }
 }
 
-int run_controller(const char *config_override_dir)
+static void report_stats(controller_t *ctl, FILE *out)
 {
-    signal(SIGINT, handle_signal);
-    signal(SIGTERM, handle_signal);
+    char line[256];
+    if (rumble_latency_enabled()) {
+        rumble_latency_report(out);
+    }
+    stage_profile_report(out);
+    rumble_budget_status(&ctl->rumble, line, sizeof line);
+    fprintf(out, "Rumble %s\n", line);
+    if (ctl->rounds) {
+        fprintf(out, "Loop rounds=%" PRIu64 " budget=%u max_round=%" PRId64 "us max_ff_wait=%" PRId64 "us\n",
+                ctl->rounds, ctl->pad_budget, ctl->max_round_ns / 1000, ctl->max_ff_wait_ns / 1000);
+        const halfpad_t *pads[] = { &ctl->left, &ctl->right };
+        for (size_t i = 0; i < 2; ++i) {
+            const pad_sched_stats_t *st = &pads[i]->sched;
+            fprintf(out, "  %s reads=%" PRIu64 " frames=%" PRIu64 " budget_hits=%" PRIu64
+                    " max_streak=%" PRIu32 " max_backlog=%dB max_wait=%" PRId64 "us\n",
+                    i == 0 ? "left " : "right", st->reads, st->frames, st->budget_hits,
+                    st->max_streak, st->max_backlog, st->max_wait_ns / 1000);
+        }
+    }
+    if (ctl->qos.enabled || ctl->qos.acquires) {
+        pm_qos_format(&ctl->qos, clock_now_ns(), line, sizeof line);
+        fprintf(out, "PM QoS %s\n", line);
+    }
+    if (ctl->boost.enabled || ctl->boost.boosts) {
+        uclamp_boost_format(&ctl->boost, clock_now_ns(), line, sizeof line);
+        fprintf(out, "Boost %s\n", line);
+    }
+    if (ctl->left.filter.cfg.enabled) {
+        stick_filter_format(&ctl->left.filter, line, sizeof line);
+        fprintf(out, "Left stick %s\n", line);
+        stick_filter_format(&ctl->right.filter, line, sizeof line);
+        fprintf(out, "Right stick %s\n", line);
+    }
+}
 
-    controller_t ctl = {
+static size_t handle_control_request(void *ctx, const char *request, char *reply, size_t reply_len,
+                                     int *reply_fd)
+{
+    controller_t *ctl = ctx;
+    int n;
+
+    if (strcmp(request, "ping") == 0) {
+        n = snprintf(reply, reply_len, "pong\n");
+    } else if (strncmp(request, "haptic ", 7) == 0) {
+        const rumble_pattern_t *pattern = rumble_pattern_find(&ctl->patterns, request + 7);
+        if (!pattern) {
+            n = snprintf(reply, reply_len, "error unknown pattern '%s'\n", request + 7);
+        } else {
+            trace_record_t rec = { .kind = TRACE_HAPTIC };
+            snprintf(rec.name, sizeof rec.name, "%s", pattern->name);
+            record(ctl, &rec);
+            rumble_play_pattern(&ctl->rumble, pattern);
+            n = snprintf(reply, reply_len, "ok\n");
+        }
+    } else if (strcmp(request, "patterns") == 0) {
+        size_t len = 0;
+        for (uint8_t i = 0; i < ctl->patterns.count && len + RUMBLE_PATTERN_NAME_LEN + 2 < reply_len; ++i) {
+            len += (size_t)snprintf(reply + len, reply_len - len, "%s%s",
+                                    i ? " " : "", ctl->patterns.patterns[i].name);
+        }
+        reply[len++] = '\n';
+        return len;
+    } else if (strcmp(request, "ring") == 0) {
+        if (!ctl->ring.shm) {
+            n = snprintf(reply, reply_len, "error frame ring disabled\n");
+        } else {
+            n = snprintf(reply, reply_len, "%s %u\n", ctl->ring.name, FRAME_RING_SLOTS);
+        }
+    } else if (strcmp(request, "ring-subscribe") == 0) {
+        int slot = -1;
+        *reply_fd = frame_ring_subscribe(&ctl->ring, &slot);
+        if (*reply_fd >= 0 && ctl->keeper_fd >= 0) {
+            // The supervisor keeps a copy, so the subscription survives a worker restart.
+            frame_ring_send_subscription(&ctl->ring, slot, ctl->keeper_fd);
+        }
+        n = snprintf(reply, reply_len, *reply_fd >= 0 ? "ok\n" : "error frame ring disabled\n");
+    } else if (strcmp(request, "budget") == 0) {
+        size_t len = rumble_budget_status(&ctl->rumble, reply, reply_len - 1);
+        reply[len++] = '\n';
+        return len;
+    } else {
+        n = snprintf(reply, reply_len, "error unknown command '%s'\n", request);
+    }
+    return (n > 0 && (size_t)n < reply_len) ? (size_t)n : 0;
+}
+
+static void load_rumble_config(const controller_options_t *opts, rumble_config_t *cfg)
+{
+    rumble_config_defaults(cfg);
+    config_load_chain(opts->config_override_dir, opts->config_pinned ? NULL : RUMBLE_CONFIG_PRIMARY,
+                      opts->config_pinned ? NULL : CONFIG_FALLBACK_DIR, RUMBLE_CONFIG_NAME,
+                      rumble_config_parse, cfg);
+}
+
+int controller_brake_gpio(const controller_options_t *opts)
+{
+    rumble_config_t cfg;
+    config_set_verbose(false);
+    load_rumble_config(opts, &cfg);
+    config_set_verbose(true);
+    return cfg.shape.brake_gpio;
+}
+
+static void controller_setup(controller_t *ctl, const controller_options_t *opts)
+{
+    const char *config_override_dir = opts->config_override_dir;
+    // A pinned replay must not depend on whatever configs the host happens to have.
+    const char *fallback_dir = opts->config_pinned ? NULL : CONFIG_FALLBACK_DIR;
+    bool pinned = opts->config_pinned;
+
+    *ctl = (controller_t){
         .left = {
-            .serial_path = LEFT_SERIAL_PORT,
-            .primary_cfg = LEFT_CONFIG_PRIMARY,
+            .serial_path = opts->left_serial ? opts->left_serial : LEFT_SERIAL_PORT,
+            .primary_cfg = pinned ? NULL : LEFT_CONFIG_PRIMARY,
             .fallback_name = LEFT_CONFIG_NAME,
             .last_buttons = { .b = 0 },
             .last_x = 0,
             .last_y = 0,
             .fd = -1,
+            .irq_prev = { .irq = -1, .cpu = -1 },
         },
         .right = {
-            .serial_path = RIGHT_SERIAL_PORT,
-            .primary_cfg = RIGHT_CONFIG_PRIMARY,
+            .serial_path = opts->right_serial ? opts->right_serial : RIGHT_SERIAL_PORT,
+            .primary_cfg = pinned ? NULL : RIGHT_CONFIG_PRIMARY,
             .fallback_name = RIGHT_CONFIG_NAME,
             .last_buttons = { .b = 0 },
             .last_x = 0,
             .last_y = 0,
             .fd = -1,
+            .irq_prev = { .irq = -1, .cpu = -1 },
         },
         .uinput_fd = -1,
+        .sink_fd = -1,
+        .control = { .fd = -1 },
+        .keeper_fd = -1,
+        .housekeeping = { .fd = -1 },
         .hat_x = 0,
         .hat_y = 0
     };
-    rumble_state_init(&ctl.rumble);
+    frame_ring_init(&ctl->ring);
+    rumble_state_init(&ctl->rumble);
+    rumble_latency_enable(opts->rumble_latency);
+    stage_profile_enable(opts->profile_stages);
+
+    load_calibration_chain(config_override_dir, ctl->left.primary_cfg, fallback_dir,
+                           ctl->left.fallback_name, &ctl->left.calibration);
+    load_calibration_chain(config_override_dir, ctl->right.primary_cfg, fallback_dir,
+                           ctl->right.fallback_name, &ctl->right.calibration);
+
+    rumble_config_t rumble_cfg;
+    load_rumble_config(opts, &rumble_cfg);
+    rumble_configure(&ctl->rumble, &rumble_cfg);
+
+    stick_filter_cfg_t filter_cfg;
+    stick_filter_defaults(&filter_cfg);
+    config_load_chain(config_override_dir, pinned ? NULL : FILTER_CONFIG_PRIMARY, fallback_dir,
+                      FILTER_CONFIG_NAME, stick_filter_config_parse, &filter_cfg);
+    stick_filter_init(&ctl->left.filter, &filter_cfg);
+    stick_filter_init(&ctl->right.filter, &filter_cfg);
+    pm_qos_init(&ctl->qos, opts->pm_qos_path, opts->pm_qos_us, opts->pm_qos_idle_ms, opts->pm_qos);
+    uclamp_boost_init(&ctl->boost, opts->uclamp_min, opts->uclamp_idle_ms, opts->uclamp);
+
+    rumble_pattern_lib_init(&ctl->patterns);
+    config_load_chain(config_override_dir, pinned ? NULL : HAPTICS_CONFIG_PRIMARY, fallback_dir,
+                      HAPTICS_CONFIG_NAME, rumble_pattern_parse, &ctl->patterns);
+}
 
-    load_calibration_chain(config_override_dir, ctl.left.primary_cfg, CONFIG_FALLBACK_DIR,
-                           ctl.left.fallback_name, &ctl.left.calibration);
-    load_calibration_chain(config_override_dir, ctl.right.primary_cfg, CONFIG_FALLBACK_DIR,
-                           ctl.right.fallback_name, &ctl.right.calibration);
+static void sim_gpio_write(int gpio, bool value, void *user)
+{
+    controller_t *ctl = user;
+    ctl->sink_writes++;
+    if (!ctl->event_log) {
+        return;
+    }
+    fprintf(ctl->event_log, "%" PRId64 " GPIO %d %d\n", clock_now_ns() / 1000, gpio, value ? 1 : 0);
+}
 
-    gpio_board_init();
+// Fire every rumble deadline up to (and including) until_ns, in order.
+static void sim_run_timers(controller_t *ctl, int64_t until_ns)
+{
+    struct timespec deadline;
+    while (rumble_next_deadline(&ctl->rumble, &deadline)) {
+        int64_t due = clock_timespec_to_ns(&deadline);
+        if (due > until_ns) {
+            break;
+        }
+        clock_advance_to(due);
+        stage_profile_enter(PROFILE_STAGE_FF);
+        rumble_tick(&ctl->rumble);
+        stage_profile_leave();
+    }
+    clock_advance_to(until_ns);
+}
+
+static bool sim_apply(controller_t *ctl, const trace_record_t *rec, uint64_t *frames)
+{
+    switch (rec->kind) {
+    case TRACE_SERIAL_LEFT:
+    case TRACE_SERIAL_RIGHT: {
+        joystick_side_t side = (rec->kind == TRACE_SERIAL_LEFT) ? SIDE_LEFT : SIDE_RIGHT;
+        halfpad_t *pad = (side == SIDE_LEFT) ? &ctl->left : &ctl->right;
+        serial_frame_t parsed[SERIAL_FRAMES_MAX(TRACE_MAX_BYTES)];
+        stage_profile_enter(PROFILE_STAGE_PARSE);
+        size_t count = parseSerialFrames(&pad->parser, rec->data, rec->len, parsed,
+                                         sizeof parsed / sizeof parsed[0]);
+        stage_profile_leave();
+        for (size_t i = 0; i < count; ++i) {
+            ++*frames;
+            int64_t sample_ns = sample_time_ns(clock_now_ns(), rec->len, parsed[i].end);
+            close_older_report(ctl, i);
+            process_sample(ctl, side, &parsed[i].pad, sample_ns);
+        }
+        return ctl->report_stamped;
+    }
+    case TRACE_FF_UPLOAD: {
+        struct ff_effect effect;
+        memset(&effect, 0, sizeof effect);
+        effect.type = FF_RUMBLE;
+        effect.id = (int16_t)rec->id;
+        effect.replay.length = rec->length_ms;
+        effect.u.rumble.strong_magnitude = rec->strong;
+        effect.u.rumble.weak_magnitude = rec->weak;
+        rumble_upload_effect(&ctl->rumble, &effect);
+        return false;
+    }
+    case TRACE_FF_PLAY:
+        rumble_play_effect(&ctl->rumble, rec->id, rec->value);
+        return false;
+    case TRACE_FF_ERASE:
+        rumble_erase_effect(&ctl->rumble, rec->id);
+        return false;
+    case TRACE_FF_GAIN:
+        rumble_apply_gain(&ctl->rumble, (uint16_t)rec->value);
+        return false;
+    case TRACE_HAPTIC: {
+        const rumble_pattern_t *pattern = rumble_pattern_find(&ctl->patterns, rec->name);
+        if (pattern) {
+            rumble_play_pattern(&ctl->rumble, pattern);
+        }
+        return false;
+    }
+    case TRACE_END:
+    default:
+        return false;
+    }
+}
+
+int controller_simulate(const controller_options_t *opts, const char *trace_path,
+                        FILE *out, FILE *report, controller_sim_stats_t *stats)
+{
+    static const int64_t drain_limit_ns = 3600LL * 1000000000LL;
+    controller_t ctl;
+    trace_reader_t reader;
+
+    memset(stats, 0, sizeof *stats);
+    clock_use_virtual(0);
+    if (trace_open(&reader, trace_path) != 0) {
+        return -1;
+    }
+
+    // Before setup: rumble_configure() already drives the brake line, and a replay must
+    // never reach the board's sysfs GPIOs.
+    gpio_set_backend(sim_gpio_write, &ctl);
+    controller_setup(&ctl, opts);
+    ctl.qos.enabled = false; // Replays must not touch the host's QoS device or scheduler.
+    ctl.boost.enabled = false;
+    ctl.event_log = out;
+
+    int64_t wall_start = clock_host_ns();
+    prime_state(&ctl);
+
+    trace_record_t rec;
+    int res;
+    int64_t end_ns = -1;
+    while ((res = trace_next(&reader, &rec)) == 1) {
+        ++stats->records;
+        sim_run_timers(&ctl, rec.t_ns);
+        if (rec.kind == TRACE_END) {
+            end_ns = rec.t_ns;
+            break;
+        }
+        bool serial = rec.kind == TRACE_SERIAL_LEFT || rec.kind == TRACE_SERIAL_RIGHT;
+        if (!serial) {
+            stage_profile_enter(PROFILE_STAGE_FF);
+        }
+        bool sent_event = sim_apply(&ctl, &rec, &stats->frames);
+        if (!serial) {
+            stage_profile_leave();
+        }
+        if (sent_event) {
+            finish_report(&ctl);
+        }
+        if (ctl.resync_due) {
+            resync_state(&ctl);
+        }
+    }
+    trace_close(&reader);
 
-    if (reopen_serial(&ctl.left) < 0 || reopen_serial(&ctl.right) < 0) {
-        fprintf(stderr, "Unable to open serial devices\n");
+    // Let pending rumble/pattern deadlines play out (bounded, or up to END).
+    sim_run_timers(&ctl, end_ns >= 0 ? end_ns : clock_now_ns() + drain_limit_ns);
+    stats->wall_ns = clock_host_ns() - wall_start;
+    stats->virtual_ns = end_ns >= 0 ? end_ns : clock_now_ns();
+    stats->sink_writes = ctl.sink_writes;
+
+    if (report) {
+        report_stats(&ctl, report);
+    }
+    rumble_state_destroy(&ctl.rumble);
+    gpio_set_backend(NULL, NULL);
+    if (out) {
+        fflush(out);
+    }
+    return res < 0 ? -1 : 0;
+}
+
+// Replay a recorded trace through the full pipeline on a virtual clock.
+static int run_simulation(const controller_options_t *opts)
+{
+    FILE *out = stdout;
+    if (opts->simulate_output && strcmp(opts->simulate_output, "-") != 0) {
+        out = fopen(opts->simulate_output, "w");
+        if (!out) {
+            perror(opts->simulate_output);
+            return EXIT_FAILURE;
+        }
+    }
+
+    controller_sim_stats_t stats;
+    int res = controller_simulate(opts, opts->simulate_path, out, stderr, &stats);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    fprintf(stderr, "Simulated %" PRIu64 " records (%" PRIu64 " frames), %.3f s virtual in %.3f s wall\n",
+            stats.records, stats.frames, (double)stats.virtual_ns / 1e9, (double)stats.wall_ns / 1e9);
+    return res < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// The daemon loop, standalone (worker == NULL) or under a supervisor that owns the device.
+static int run_live(const controller_options_t *opts, const controller_worker_t *worker)
+{
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    signal(SIGUSR1, handle_dump_signal);
+
+    controller_t ctl;
+    if (!worker) {
+        gpio_board_init();
+    }
+    controller_setup(&ctl, opts);
+
+    if (opts->record_path &&
+        trace_writer_open(&ctl.recorder, opts->record_path, clock_now_ns()) != 0) {
         return EXIT_FAILURE;
     }
 
-    ctl.uinput_fd = create_uinput_device(&ctl);
-    if (ctl.uinput_fd < 0) {
+    // A missing port is retried from the event loop instead of failing startup.
+    reopen_serial(&ctl.left);
+    reopen_serial(&ctl.right);
+
+    const bool no_uinput = worker || opts->null_output || opts->event_sink;
+    if (worker) {
+        ctl.uinput_fd = worker->uinput_fd;
+        ctl.out_ring = worker->ring;
+        restore_ff(&ctl, &worker->ring->shm->ff);
+    } else if (opts->event_sink) {
+        ctl.sink_fd = open(opts->event_sink, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (ctl.sink_fd < 0) {
+            perror(opts->event_sink);
+            closeSerialJoystick(ctl.left.fd);
+            closeSerialJoystick(ctl.right.fd);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!no_uinput) {
+        ctl.uinput_fd = create_uinput_device(&ctl);
+    }
+    if (ctl.uinput_fd < 0 && !no_uinput) {
         closeSerialJoystick(ctl.left.fd);
         closeSerialJoystick(ctl.right.fd);
         return EXIT_FAILURE;
     }
 
-    prime_state(&ctl);
+    ctl.irq_cpu = opts->irq_affinity ? irq_affinity_pin_self(opts->irq_cpu) : -1;
+    if (ctl.irq_cpu >= 0) {
+        fprintf(stderr, "Main loop pinned to CPU%d\n", ctl.irq_cpu);
+        steer_pad_irq(&ctl, &ctl.left);
+        steer_pad_irq(&ctl, &ctl.right);
+        // What a UART wakeup costs now, and what it cost from where the IRQs used to land.
+        // A spread IRQ had no single source CPU, so it gets no comparison.
+        const int prev[2] = { ctl.left.irq_prev.cpu, ctl.right.irq_prev.cpu };
+        irq_affinity_report_wakeup(ctl.irq_cpu, ctl.irq_cpu, stderr);
+        for (int i = 0; i < 2; ++i) {
+            if (prev[i] >= 0 && prev[i] != ctl.irq_cpu && (i == 0 || prev[1] != prev[0])) {
+                irq_affinity_report_wakeup(prev[i], ctl.irq_cpu, stderr);
+            }
+        }
+    }
+
+    // The device and its FF requests are live at once; only stick output waits for the
+    // settle window (the OEM daemon zeroes the sticks a second after creating the device).
+    ctl.pad_budget = opts->pad_budget ? opts->pad_budget : PAD_READ_BUDGET_DEFAULT;
+    clock_timer_init(&ctl.housekeeping);
+    if (worker && worker->ring->shm->prime_valid) {
+        // A restart: the device still shows what the last worker sent, so diff from that.
+        restore_state(&ctl, &worker->ring->shm->prime);
+        ctl.settled = true;
+    } else if (worker) {
+        ctl.settled = false;
+        ctl.settle_ns = worker->ring->shm->device_created_ns + (int64_t)STARTUP_SETTLE_MS * 1000000LL;
+    } else {
+        ctl.settled = ctl.uinput_fd < 0;
+        if (ctl.settled) {
+            prime_state(&ctl);
+        } else {
+            ctl.settle_ns = clock_now_ns() + (int64_t)STARTUP_SETTLE_MS * 1000000LL;
+        }
+    }
+    arm_housekeeping(&ctl);
+
+    if (worker) {
+        // Owned by the supervisor: re-creating them would orphan subscribers and clients.
+        ctl.ring = *worker->frames;
+        ctl.control = *worker->control;
+        ctl.keeper_fd = worker->keeper_fd;
+    } else if (opts->frame_ring) {
+        frame_ring_create(&ctl.ring, opts->frame_ring);
+    }
 
-    struct pollfd pfds[3];
-    const int poll_timeout_ms = 1;
+    const char *control_path = opts->control_path ? opts->control_path : CONTROL_DEFAULT_PATH;
+    if (!worker && *control_path) {
+        control_open(&ctl.control, control_path, opts->control_mode, opts->control_group);
+    }
+    if (worker) {
+        event_ring_ready(worker->ring, (int)getpid());
+    }
+
+    struct pollfd pfds[PFD_COUNT];
+    const int rumble_fd = rumble_timer_fd(&ctl.rumble);
+    const int housekeeping_fd = ctl.housekeeping.fd;
+    // Every wakeup source is in the poll set, so block unless a timerfd is unavailable.
+    int poll_timeout_ms = opts->poll_timeout_ms;
+    if (poll_timeout_ms == 0) {
+        poll_timeout_ms = (rumble_fd >= 0 && housekeeping_fd >= 0) ? -1 : 1;
+    }
     while (keep_running) {
-        pfds[0].fd = ctl.left.fd;
-        pfds[0].events = POLLIN;
-        pfds[1].fd = ctl.right.fd;
-        pfds[1].events = POLLIN;
-        pfds[2].fd = ctl.uinput_fd;
-        pfds[2].events = POLLIN;
-
-        int ret = poll(pfds, 3, poll_timeout_ms);
+        pfds[PFD_LEFT].fd = ctl.left.fd;
+        pfds[PFD_RIGHT].fd = ctl.right.fd;
+        pfds[PFD_UINPUT].fd = ctl.uinput_fd;
+        pfds[PFD_RUMBLE].fd = rumble_fd;
+        pfds[PFD_CONTROL].fd = ctl.control.fd;
+        pfds[PFD_HOUSEKEEPING].fd = housekeeping_fd;
+        for (int i = 0; i < PFD_COUNT; ++i) {
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
+        }
+
+        // A batch kept back by a full event ring goes out once the supervisor drains it.
+        const bool kept = ctl.out_ring && ctl.out_ring->pending.count;
+        int ret = poll(pfds, PFD_COUNT, kept && poll_timeout_ms != 0 ? 1 : poll_timeout_ms);
         if (ret < 0) {
             if (errno == EINTR) {
                 continue;
@@ -596,57 +1497,90 @@ int run_controller(const char *config_override_dir)
             perror("poll");
             break;
         }
-
-        bool sent_event = false;
-        if (pfds[0].revents & POLLIN) {
-            joypad_struct_t sample;
-            int read_res;
-            do {
-                read_res = readSerialJoypad(ctl.left.fd, &sample);
-                if (read_res == 1) {
-                    bool axis_dirty = update_axes(ctl.uinput_fd, SIDE_LEFT, &ctl.left, &sample);
-                    bool btn_dirty = update_buttons(ctl.uinput_fd, SIDE_LEFT, &ctl.left.last_buttons, sample.buttons);
-                    bool hat_dirty = update_hat(&ctl, sample.buttons);
-                    sent_event |= (axis_dirty || btn_dirty || hat_dirty);
-                } else if (read_res < 0) {
-                    fprintf(stderr, "Left serial read error, trying to reopen...\n");
-                    reopen_serial(&ctl.left);
-                    break;
-                }
-            } while (read_res == 1);
-        }
-
-        if (pfds[1].revents & POLLIN) {
-            joypad_struct_t sample;
-            int read_res;
-            do {
-                read_res = readSerialJoypad(ctl.right.fd, &sample);
-                if (read_res == 1) {
-                    bool axis_dirty = update_axes(ctl.uinput_fd, SIDE_RIGHT, &ctl.right, &sample);
-                    bool btn_dirty = update_buttons(ctl.uinput_fd, SIDE_RIGHT, &ctl.right.last_buttons, sample.buttons);
-                    sent_event |= (axis_dirty || btn_dirty);
-                } else if (read_res < 0) {
-                    fprintf(stderr, "Right serial read error, trying to reopen...\n");
-                    reopen_serial(&ctl.right);
-                    break;
-                }
-            } while (read_res == 1);
+        if (kept) {
+            ctl.resync_due |= event_ring_flush(ctl.out_ring);
         }
 
-        if (pfds[2].revents & POLLIN) {
+        const int64_t woke_ns = clock_now_ns();
+        ctl.rounds++;
+        bool sent_event = service_pads(&ctl, pfds, woke_ns);
+
+        if (pfds[PFD_UINPUT].revents & POLLIN) {
+            int64_t wait = clock_now_ns() - woke_ns;
+            if (wait > ctl.max_ff_wait_ns) {
+                ctl.max_ff_wait_ns = wait;
+            }
+            stage_profile_enter(PROFILE_STAGE_FF);
             process_uinput_events(&ctl);
+            stage_profile_leave();
+            note_activity(&ctl, clock_now_ns(), false);
+        }
+
+        if (rumble_fd < 0 || (pfds[PFD_RUMBLE].revents & POLLIN)) {
+            stage_profile_enter(PROFILE_STAGE_FF);
+            rumble_tick(&ctl.rumble);
+            stage_profile_leave();
+        }
+
+        if (pfds[PFD_CONTROL].revents & POLLIN) {
+            control_service(&ctl.control, handle_control_request, &ctl);
         }
 
-        rumble_tick(&ctl.rumble);
+        if (housekeeping_fd < 0 || (pfds[PFD_HOUSEKEEPING].revents & POLLIN)) {
+            run_housekeeping(&ctl);
+        }
 
         if (sent_event) {
-            sync_events(ctl.uinput_fd);
+            finish_report(&ctl);
+        }
+        if (ctl.resync_due) {
+            resync_state(&ctl);
+        }
+
+        int64_t round_ns = clock_now_ns() - woke_ns;
+        if (round_ns > ctl.max_round_ns) {
+            ctl.max_round_ns = round_ns;
+        }
+
+        if (dump_stats) {
+            dump_stats = 0;
+            report_stats(&ctl, stderr);
         }
     }
 
-    destroy_uinput_device(ctl.uinput_fd);
+    report_stats(&ctl, stderr);
+    clock_timer_close(&ctl.housekeeping);
+    pm_qos_release(&ctl.qos, clock_now_ns());
+    uclamp_boost_release(&ctl.boost, clock_now_ns());
+    trace_writer_close(&ctl.recorder);
+
+    if (!worker) {
+        control_close(&ctl.control);
+        frame_ring_destroy(&ctl.ring);
+        destroy_uinput_device(ctl.uinput_fd);
+    }
+    if (ctl.sink_fd >= 0) {
+        close(ctl.sink_fd);
+    }
     closeSerialJoystick(ctl.left.fd);
     closeSerialJoystick(ctl.right.fd);
-    gpio_set_rumble(false);
+    if (!worker) {
+        irq_affinity_restore(&ctl.left.irq_prev, stderr);
+        irq_affinity_restore(&ctl.right.irq_prev, stderr);
+    }
+    rumble_state_destroy(&ctl.rumble);
     return EXIT_SUCCESS;
 }
+
+int run_controller(const controller_options_t *opts)
+{
+    if (opts->simulate_path) {
+        return run_simulation(opts);
+    }
+    return run_live(opts, NULL);
+}
+
+int controller_run_worker(const controller_options_t *opts, const controller_worker_t *worker)
+{
+    return run_live(opts, worker);
+}
@@ -3,12 +3,133 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
 #include "../common.h"
+#include "../control/control.h"
+#include "../ring/frame-ring.h"
+#include "../supervisor/event-ring.h"
+
+/**
+ * Runtime switches collected from the command line.
+ */
+typedef struct {
+    const char *config_override_dir; // Optional directory checked first for calibration files.
+    bool config_pinned;              // Read configs from config_override_dir only, never the device paths.
+    bool rumble_latency;             // Time the EV_FF -> GPIO path and report on SIGUSR1/exit.
+    bool profile_stages;             // Attribute CPU cost per pipeline stage and report on SIGUSR1/exit.
+    const char *control_path;        // Control socket path; NULL for the default, "" to disable.
+    unsigned int control_mode;       // Control socket permission bits; 0 for CONTROL_DEFAULT_MODE.
+    const char *control_group;       // Group allowed by control_mode's group bits; NULL keeps the daemon's.
+    const char *record_path;         // Record serial/FF input to this trace file.
+    const char *simulate_path;       // Replay this trace on a virtual clock instead of running live.
+    const char *simulate_output;     // Where replayed events/GPIO edges go (NULL or "-" for stdout).
+    const char *left_serial;         // Left pad serial device override (NULL for the built-in port).
+    const char *right_serial;        // Right pad serial device override.
+    bool null_output;                // Skip the uinput device and discard events (benchmarks).
+    const char *event_sink;          // Write raw input_events here instead of uinput (file, FIFO, /dev/fd/N).
+    int poll_timeout_ms;             // Main loop poll timeout: 0 = auto, -1 = block, >0 = milliseconds.
+    unsigned int pad_budget;         // Reads per pad per loop round (0 = default).
+    const char *frame_ring;          // Publish every frame to this shared-memory ring (NULL disables).
+    bool irq_affinity;               // Pin the loop to irq_cpu and route the pad UART IRQs there.
+    int irq_cpu;                     // Target CPU, or IRQ_AFFINITY_CURRENT for the startup CPU.
+    bool pm_qos;                     // Hold a CPU latency QoS request while the pads are active.
+    int pm_qos_us;                   // Latency bound written while held.
+    unsigned int pm_qos_idle_ms;     // Release after this long without input changes (0 = default).
+    const char *pm_qos_path;         // QoS device (NULL for /dev/cpu_dma_latency).
+    bool uclamp;                     // Boost the loop's util_min on activity.
+    unsigned int uclamp_min;         // Boost level out of 1024 (0 = default).
+    unsigned int uclamp_idle_ms;     // Halve the boost after this long without activity (0 = default).
+    bool supervise;                  // Split into a device-owning supervisor and a restartable worker.
+} controller_options_t;
 
 /**
  * Start the Trimui controller daemon until a termination signal is received.
  *
- * @param config_override_dir Optional directory checked first for calibration files.
+ * @param opts Runtime options (never NULL).
  * @return process exit code (0 on clean shutdown, non-zero on fatal error).
  */
-int run_controller(const char *config_override_dir);
+int run_controller(const controller_options_t *opts);
+
+/**
+ * What a supervised worker gets from its supervisor.
+ */
+typedef struct {
+    int uinput_fd;          // Device owned by the supervisor, read here for FF requests (-1 if none).
+    event_ring_t *ring;     // Reports go here instead of to the device.
+    frame_ring_t *frames;   // Frame ring, already created (shm NULL when disabled).
+    control_t *control;     // Control socket, already bound (fd -1 when disabled).
+    int keeper_fd;          // New ring subscriptions go back to the supervisor here.
+} controller_worker_t;
+
+/**
+ * Run the daemon loop as a supervised worker: no GPIO bring-up and no device of its own.
+ * Reports are published to the ring; if the supervisor has a state from a previous worker,
+ * the loop continues from it instead of re-priming the device. The frame ring and control
+ * socket are the supervisor's, so subscribers and clients outlive the worker.
+ *
+ * @param opts   Runtime options (never NULL).
+ * @param worker Supervisor resources.
+ * @return process exit code.
+ */
+int controller_run_worker(const controller_options_t *opts, const controller_worker_t *worker);
+
+/**
+ * Create the uinput device the way the daemon does (axis flats from the calibration files).
+ *
+ * @param opts Runtime options; only the config override directory is used.
+ * @return uinput fd, -1 on error.
+ */
+int controller_create_device(const controller_options_t *opts);
+
+/**
+ * Brake line the daemon's rumble.config names, read through the same config chain.
+ *
+ * @param opts Runtime options; only the config directories are used.
+ * @return GPIO number, -1 if the board has no brake line configured.
+ */
+int controller_brake_gpio(const controller_options_t *opts);
+
+/**
+ * Destroy a device from controller_create_device() and close its fd. Ignores fd < 0.
+ *
+ * @param fd uinput fd.
+ */
+void controller_destroy_device(int fd);
+
+/**
+ * Guided cross-axis sweep on one pad (see cross_axis_sweep_run()), using the daemon's port
+ * and calibration for that side. Run it with the daemon stopped.
+ *
+ * @param opts Runtime options (serial overrides and config directory).
+ * @param side "left" or "right".
+ * @return process exit code.
+ */
+int controller_calibrate_cross(const controller_options_t *opts, const char *side);
+
+/**
+ * Counters from one trace replay.
+ */
+typedef struct {
+    uint64_t records;     // Trace records consumed.
+    uint64_t frames;      // Serial frames that completed in the parser.
+    uint64_t sink_writes; // Event + GPIO writes the live daemon would have issued.
+    int64_t virtual_ns;   // Virtual time covered by the trace.
+    int64_t wall_ns;      // Host time spent replaying (excludes config loading).
+} controller_sim_stats_t;
+
+/**
+ * Replay a recorded trace through the input mapping and rumble scheduler on a virtual clock.
+ * Switches the process clock to virtual mode.
+ *
+ * @param opts Runtime options; only the config override directory is used.
+ * @param trace_path Trace to replay ("-" for stdin).
+ * @param out Receives the event/GPIO log; NULL discards output (null sink).
+ * @param report Receives the end-of-run stats (rumble budget etc.); NULL to skip.
+ * @param stats Filled with replay counters.
+ * @return 0 on success, -1 if the trace could not be opened or parsed.
+ */
+int controller_simulate(const controller_options_t *opts, const char *trace_path,
+                        FILE *out, FILE *report, controller_sim_stats_t *stats);
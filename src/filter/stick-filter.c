@@ -0,0 +1,160 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Alpha-beta stick tracker: smooths ADC noise and extrapolates over the input delay.
+
+#include "stick-filter.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../config/config.h"
+
+void stick_filter_defaults(stick_filter_cfg_t *cfg)
+{
+    cfg->enabled = false;
+    cfg->alpha_pct = STICK_FILTER_DEFAULT_ALPHA_PCT;
+    cfg->beta_pct = STICK_FILTER_DEFAULT_BETA_PCT;
+    cfg->lead_us = STICK_FILTER_DEFAULT_LEAD_US;
+    cfg->reset_ms = STICK_FILTER_DEFAULT_RESET_MS;
+}
+
+bool stick_filter_config_parse(void *ctx, const char *key, const char *value)
+{
+    stick_filter_cfg_t *cfg = ctx;
+    unsigned long val;
+
+    if (strcmp(key, "enable") == 0) {
+        if (!config_parse_uint(value, 1, &val)) return false;
+        cfg->enabled = val != 0;
+        return true;
+    }
+    if (strcmp(key, "alpha_pct") == 0 || strcmp(key, "beta_pct") == 0) {
+        // alpha = 0 would ignore every measurement; beta above 100 is past the stability limit
+        // for the alpha values that make sense here.
+        if (!config_parse_uint(value, 100, &val) || (key[0] == 'a' && val == 0)) return false;
+        if (key[0] == 'a') {
+            cfg->alpha_pct = (uint8_t)val;
+        } else {
+            cfg->beta_pct = (uint8_t)val;
+        }
+        return true;
+    }
+    if (strcmp(key, "lead_us") == 0) {
+        if (!config_parse_uint(value, 50000, &val)) return false;
+        cfg->lead_us = (uint32_t)val;
+        return true;
+    }
+    if (strcmp(key, "reset_ms") == 0) {
+        if (!config_parse_uint(value, 10000, &val) || val == 0) return false;
+        cfg->reset_ms = (uint32_t)val;
+        return true;
+    }
+    return false;
+}
+
+void stick_filter_init(stick_filter_t *f, const stick_filter_cfg_t *cfg)
+{
+    memset(f, 0, sizeof *f);
+    f->cfg = *cfg;
+}
+
+static inline double absd(double v)
+{
+    return v < 0.0 ? -v : v;
+}
+
+static uint16_t to_adc(double v)
+{
+    if (v <= 0.0) return 0;
+    if (v >= STICK_FILTER_ADC_MAX) return STICK_FILTER_ADC_MAX;
+    return (uint16_t)(v + 0.5);
+}
+
+static void prime_axis(stick_filter_axis_t *a, uint16_t z)
+{
+    a->pos = z;
+    a->vel = 0.0;
+    a->out = z;
+    a->raw = z;
+}
+
+// Score the previous output: it aimed at the position lead_s after the previous sample,
+// which is estimated by interpolating between the previous and the new measurement.
+static void score_axis(stick_filter_t *f, const stick_filter_axis_t *a, uint16_t z, double dt, double lead_s)
+{
+    double frac = (lead_s < dt) ? lead_s / dt : 1.0;
+    double target = a->raw + ((double)z - a->raw) * frac;
+    double err = absd(a->out - target);
+
+    f->predict_err += err;
+    f->hold_err += absd((double)a->raw - target);
+    if (err > f->predict_err_max) {
+        f->predict_err_max = err;
+    }
+    f->scored++;
+}
+
+static uint16_t update_axis(const stick_filter_cfg_t *cfg, stick_filter_axis_t *a, uint16_t z, double dt,
+                            double lead_s)
+{
+    const double alpha = cfg->alpha_pct / 100.0;
+    const double beta = cfg->beta_pct / 100.0;
+
+    double predicted = a->pos + a->vel * dt;
+    double residual = (double)z - predicted;
+    a->pos = predicted + alpha * residual;
+    // Several frames decoded from one read share a timestamp: correct position only.
+    if (dt > 0.0) {
+        a->vel += beta * residual / dt;
+    }
+    a->raw = z;
+    a->out = a->pos + a->vel * lead_s;
+    return to_adc(a->out);
+}
+
+void stick_filter_apply(stick_filter_t *f, int64_t t_ns, uint16_t *x, uint16_t *y)
+{
+    if (!f->cfg.enabled) {
+        return;
+    }
+
+    const double lead_s = f->cfg.lead_us / 1e6;
+    int64_t gap_ns = t_ns - f->last_ns;
+    if (!f->primed || gap_ns < 0 || gap_ns > (int64_t)f->cfg.reset_ms * 1000000LL) {
+        // Idle pads stop sending; a stale velocity would fling the first new sample.
+        prime_axis(&f->x, *x);
+        prime_axis(&f->y, *y);
+        f->primed = true;
+        f->last_ns = t_ns;
+        return;
+    }
+
+    double dt = (double)gap_ns / 1e9;
+    if (dt > 0.0) {
+        score_axis(f, &f->x, *x, dt, lead_s);
+        score_axis(f, &f->y, *y, dt, lead_s);
+    }
+    *x = update_axis(&f->cfg, &f->x, *x, dt, lead_s);
+    *y = update_axis(&f->cfg, &f->y, *y, dt, lead_s);
+    f->last_ns = t_ns;
+}
+
+size_t stick_filter_format(const stick_filter_t *f, char *buf, size_t len)
+{
+    double n = f->scored ? (double)f->scored : 1.0;
+    int n_written = snprintf(buf, len,
+                             "filter=%s alpha=%u%% beta=%u%% lead=%" PRIu32 "us samples=%" PRIu64
+                             " predict_err=%.1f hold_err=%.1f predict_max=%.0f",
+                             f->cfg.enabled ? "on" : "off",
+                             (unsigned int)f->cfg.alpha_pct,
+                             (unsigned int)f->cfg.beta_pct,
+                             f->cfg.lead_us,
+                             f->scored,
+                             f->predict_err / n,
+                             f->hold_err / n,
+                             f->predict_err_max);
+    if (n_written < 0) return 0;
+    return ((size_t)n_written < len) ? (size_t)n_written : len - 1;
+}
@@ -0,0 +1,101 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Defaults: close to critically damped gains and a lead that covers one 7-byte frame at
+ * 19200 baud (~3.6 ms on the wire) plus a little loop latency.
+ */
+#define STICK_FILTER_DEFAULT_ALPHA_PCT 50
+#define STICK_FILTER_DEFAULT_BETA_PCT 15
+#define STICK_FILTER_DEFAULT_LEAD_US 4000
+#define STICK_FILTER_DEFAULT_RESET_MS 100
+#define STICK_FILTER_ADC_MAX 4095
+
+/**
+ * Filter parameters (loaded from filter.config).
+ */
+typedef struct {
+    bool enabled;
+    uint8_t alpha_pct;  // Position gain: share of the residual applied to the estimate.
+    uint8_t beta_pct;   // Velocity gain: share of residual/dt applied to the velocity.
+    uint32_t lead_us;   // How far ahead of the last sample the output is extrapolated.
+    uint32_t reset_ms;  // A gap longer than this restarts the filter at the new sample.
+} stick_filter_cfg_t;
+
+/**
+ * Position/velocity estimate for one ADC axis, in ADC counts and counts per second.
+ */
+typedef struct {
+    double pos;
+    double vel;
+    double out;         // Last extrapolated output.
+    uint16_t raw;       // Last measurement.
+} stick_filter_axis_t;
+
+/**
+ * Alpha-beta tracker for one stick (two axes sharing the sample timestamps).
+ */
+typedef struct {
+    stick_filter_cfg_t cfg;
+    stick_filter_axis_t x;
+    stick_filter_axis_t y;
+    bool primed;
+    int64_t last_ns;
+    // Prediction error against the next measurement, summed over both axes.
+    uint64_t scored;        // Axis samples scored.
+    double predict_err;     // Sum of |output - measured position at the lead time|.
+    double hold_err;        // Same for the unfiltered previous sample (no filter, no lead).
+    double predict_err_max;
+} stick_filter_t;
+
+/**
+ * Reset a config to the defaults above (filter disabled).
+ *
+ * @param cfg Config to populate.
+ */
+void stick_filter_defaults(stick_filter_cfg_t *cfg);
+
+/**
+ * config_kv_handler_t for filter.config keys.
+ *
+ * @param ctx   stick_filter_cfg_t to update.
+ * @param key   Trimmed key.
+ * @param value Trimmed value.
+ * @return true if the key was recognized and applied.
+ */
+bool stick_filter_config_parse(void *ctx, const char *key, const char *value);
+
+/**
+ * Start an unprimed filter.
+ *
+ * @param f   Filter to initialize.
+ * @param cfg Parameters (copied).
+ */
+void stick_filter_init(stick_filter_t *f, const stick_filter_cfg_t *cfg);
+
+/**
+ * Feed one timestamped ADC sample and replace it with the filtered, extrapolated position.
+ * A no-op when the filter is disabled.
+ *
+ * @param f    Filter state.
+ * @param t_ns Time the sample was decoded.
+ * @param x    Raw X in, filtered X out (clamped to the 12-bit range).
+ * @param y    Raw Y in, filtered Y out.
+ */
+void stick_filter_apply(stick_filter_t *f, int64_t t_ns, uint16_t *x, uint16_t *y);
+
+/**
+ * Render the prediction error counters as a single "key=value ..." line.
+ *
+ * @param f   Filter to describe.
+ * @param buf Destination buffer.
+ * @param len Buffer size.
+ * @return Characters written (excluding the terminator).
+ */
+size_t stick_filter_format(const stick_filter_t *f, char *buf, size_t len);
@@ -0,0 +1,123 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Reconciler self-test: scrambles a mock GPIO tree and checks what the bring-up rewrites.
+
+#include "gpio-selftest.h"
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "gpio.h"
+
+typedef struct {
+    int gpio;
+    const char *direction;
+    int value;
+} mock_line_t;
+
+static int build_tree(const char *root, const mock_line_t *lines, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (gpio_mock_create_line(root, lines[i].gpio, lines[i].direction, lines[i].value) != 0) {
+            perror("mock gpio tree");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void remove_line(const char *root, int gpio)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof path, "%s/gpio%d/direction", root, gpio);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/gpio%d/value", root, gpio);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/gpio%d", root, gpio);
+    rmdir(path);
+}
+
+static unsigned int writes(const gpio_reconcile_report_t *r)
+{
+    return r->exports + r->direction_writes + r->value_writes;
+}
+
+static bool run_case(const char *name, unsigned int want_writes, unsigned int want_mismatches)
+{
+    gpio_reconcile_report_t report;
+    fprintf(stderr, "%s:\n", name);
+    int res = gpio_board_reconcile(&report, stderr);
+    fprintf(stderr, "  ");
+    gpio_reconcile_print(&report, stderr);
+    bool ok = writes(&report) == want_writes && report.mismatches == want_mismatches &&
+              (res == 0) == (want_mismatches == 0);
+    if (!ok) {
+        fprintf(stderr, "  expected %u writes and %u mismatches\n", want_writes, want_mismatches);
+    }
+    return ok;
+}
+
+int gpio_reconcile_selftest_run(const char *mock_root)
+{
+    static const mock_line_t settled[] = {
+        { GPIO_LEFT_ENABLE, "out", 1 },
+        { GPIO_RIGHT_ENABLE, "out", 1 },
+        { GPIO_RUMBLE, "out", 0 },
+        { GPIO_DIP_SWITCH, "in", 0 },
+        { GPIO_5V_ENABLE, "out", 1 },
+    };
+    // Four wrong lines: two levels, an output left as input, an input left as output.
+    static const mock_line_t scrambled[] = {
+        { GPIO_LEFT_ENABLE, "out", 0 },
+        { GPIO_RIGHT_ENABLE, "out", 1 },
+        { GPIO_RUMBLE, "out", 1 },
+        { GPIO_DIP_SWITCH, "out", 0 },
+        { GPIO_5V_ENABLE, "in", 0 },
+    };
+    char tmp_root[] = "/tmp/tsp-gpio-XXXXXX";
+
+    if (!mock_root) {
+        if (!mkdtemp(tmp_root)) {
+            perror("mkdtemp");
+            return 1;
+        }
+        mock_root = tmp_root;
+    }
+    gpio_set_sysfs_root(mock_root);
+    fprintf(stderr, "GPIO reconcile self-test against %s\n", mock_root);
+
+    int failures = 0;
+    if (build_tree(mock_root, settled, sizeof settled / sizeof settled[0]) != 0) {
+        gpio_set_sysfs_root(NULL);
+        if (mock_root == tmp_root) {
+            gpio_mock_remove_tree(tmp_root);
+        }
+        return 1;
+    }
+    failures += !run_case("already settled", 0, 0);
+
+    if (build_tree(mock_root, scrambled, sizeof scrambled / sizeof scrambled[0]) != 0) {
+        gpio_set_sysfs_root(NULL);
+        if (mock_root == tmp_root) {
+            gpio_mock_remove_tree(tmp_root);
+        }
+        return 1;
+    }
+    failures += !run_case("scrambled", 4, 0);
+    failures += !run_case("second pass", 0, 0);
+
+    // A mock export file does not create the line, so the export must not verify.
+    remove_line(mock_root, GPIO_RIGHT_ENABLE);
+    failures += !run_case("unexported line", 1, 1);
+
+    gpio_set_sysfs_root(NULL);
+    if (mock_root == tmp_root) {
+        gpio_mock_remove_tree(tmp_root);
+    }
+    fprintf(stderr, "GPIO reconcile self-test: %s (%d failing cases)\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
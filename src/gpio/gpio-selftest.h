@@ -0,0 +1,15 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+/**
+ * Exercise the bring-up reconciler against a mock sysfs GPIO tree: a tree already in the
+ * bring-up state must see no writes, a scrambled tree must be fixed with exactly one write
+ * per wrong line and then be idempotent, and a line that cannot be exported must be
+ * reported as a mismatch.
+ *
+ * @param mock_root Directory to build the mock tree in; NULL creates one under /tmp.
+ * @return 0 if every case behaved as expected, 1 otherwise.
+ */
+int gpio_reconcile_selftest_run(const char *mock_root);
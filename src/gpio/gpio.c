@@ -3,21 +3,68 @@
 
 // Sysfs GPIO helpers used to power up the pads and drive the rumble motor.
 
+#define _GNU_SOURCE
+
 #include "gpio.h"
 
 #include <errno.h>
 #include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
-#define GPIO_LEFT_ENABLE 110  // PD14
-#define GPIO_RIGHT_ENABLE 114 // PD18
-#define GPIO_RUMBLE 227       // PH3
-#define GPIO_DIP_SWITCH 243   // PH19
-#define GPIO_5V_ENABLE 107    // PD11
+#include "../clock/clock.h"
+#include "../stats/stage-profile.h"
+
+#define GPIO_SYSFS_ROOT "/sys/class/gpio"
+
+static const char *sysfs_root = GPIO_SYSFS_ROOT;
+static gpio_backend_t backend_cb = NULL;
+static void *backend_ctx = NULL;
+static bool rumble_state = false;
+
+/**
+ * Desired state of one bring-up line.
+ */
+typedef struct {
+    int gpio;
+    bool output;
+    int value;  // Level for outputs; ignored for inputs.
+} gpio_plan_t;
+
+// Stock inputd bring-up: pad rails, rumble idle, DIP switch input, 5 V enable.
+static const gpio_plan_t board_plan[] = {
+    { GPIO_LEFT_ENABLE, true, 1 },
+    { GPIO_RIGHT_ENABLE, true, 1 },
+    { GPIO_RUMBLE, true, 0 },
+    { GPIO_DIP_SWITCH, false, 0 },
+    { GPIO_5V_ENABLE, true, 1 },
+};
+
+/**
+ * What sysfs reports for one line.
+ */
+typedef struct {
+    bool exported;
+    int direction;  // 1 = out, 0 = in, -1 = unreadable.
+    int value;      // -1 = unreadable or not read (inputs).
+} gpio_line_state_t;
+
+void gpio_set_sysfs_root(const char *root)
+{
+    sysfs_root = (root && *root) ? root : GPIO_SYSFS_ROOT;
+}
+
+void gpio_set_backend(gpio_backend_t backend, void *ctx)
+{
+    backend_cb = backend;
+    backend_ctx = ctx;
+    rumble_state = false;
+}
 
 static int write_file_str(const char *path, const char *value)
 {
@@ -31,29 +78,205 @@ static int write_file_str(const char *path, const char *value)
     return (written == len) ? 0 : -1;
 }
 
-static void gpio_write_value(int gpio, const char *node, const char *value)
+static int read_file_str(const char *path, char *buf, size_t size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t r = read(fd, buf, size - 1);
+    close(fd);
+    if (r < 0) {
+        return -1;
+    }
+    buf[r] = '\0';
+    return 0;
+}
+
+static int gpio_write_value(int gpio, const char *node, const char *value)
 {
-    char path[128];
-    snprintf(path, sizeof path, "/sys/class/gpio/gpio%d/%s", gpio, node);
-    if (write_file_str(path, value) != 0) {
-        fprintf(stderr, "GPIO%d: failed to write %s (%s)\n", gpio, node, strerror(errno));
+    int res = 0;
+    stage_profile_enter(PROFILE_STAGE_GPIO);
+    if (backend_cb) {
+        if (strcmp(node, "value") == 0) {
+            backend_cb(gpio, value[0] == '1', backend_ctx);
+        }
+    } else {
+        char path[PATH_MAX];
+        snprintf(path, sizeof path, "%s/gpio%d/%s", sysfs_root, gpio, node);
+        res = write_file_str(path, value);
+        if (res != 0) {
+            fprintf(stderr, "GPIO%d: failed to write %s (%s)\n", gpio, node, strerror(errno));
+        }
     }
+    stage_profile_leave();
+    return res;
 }
 
-static void gpio_export(int gpio)
+static int gpio_export(int gpio)
 {
+    if (backend_cb) {
+        return 0;
+    }
+
     char buf[16];
+    char path[PATH_MAX];
     snprintf(buf, sizeof buf, "%d", gpio);
-    int fd = open("/sys/class/gpio/export", O_WRONLY);
+    snprintf(path, sizeof path, "%s/export", sysfs_root);
+    int fd = open(path, O_WRONLY);
     if (fd < 0) {
         perror("open gpio export");
-        return;
+        return -1;
     }
+    int res = 0;
     ssize_t len = (ssize_t)strlen(buf);
     if (write(fd, buf, len) < 0 && errno != EBUSY) {
         fprintf(stderr, "Failed to export GPIO%d: %s\n", gpio, strerror(errno));
+        res = -1;
     }
     close(fd);
+    return res;
+}
+
+// One read of direction (and value for outputs). A missing direction node means the
+// line is not exported. "high"/"low" only show up on mock trees, which keep whatever
+// was written; the kernel reports them as "out".
+static void read_line_state(int gpio, bool want_value, gpio_line_state_t *st, unsigned int *reads)
+{
+    char path[PATH_MAX];
+    char buf[16];
+
+    st->exported = true;
+    st->direction = -1;
+    st->value = -1;
+    snprintf(path, sizeof path, "%s/gpio%d/direction", sysfs_root, gpio);
+    ++*reads;
+    if (read_file_str(path, buf, sizeof buf) != 0) {
+        st->exported = errno != ENOENT;
+        return;
+    }
+    if (strncmp(buf, "in", 2) == 0) {
+        st->direction = 0;
+    } else if (strncmp(buf, "out", 3) == 0) {
+        st->direction = 1;
+    } else if (strncmp(buf, "high", 4) == 0 || strncmp(buf, "low", 3) == 0) {
+        st->direction = 1;
+        st->value = (buf[0] == 'h') ? 1 : 0;
+        return;
+    }
+    if (want_value && st->direction == 1) {
+        snprintf(path, sizeof path, "%s/gpio%d/value", sysfs_root, gpio);
+        ++*reads;
+        if (read_file_str(path, buf, sizeof buf) == 0) {
+            st->value = (buf[0] == '1') ? 1 : 0;
+        }
+    }
+}
+
+static bool line_matches(const gpio_plan_t *plan, const gpio_line_state_t *st)
+{
+    if (!st->exported) {
+        return false;
+    }
+    if (!plan->output) {
+        return st->direction == 0;
+    }
+    return st->direction == 1 && st->value == plan->value;
+}
+
+static const char *direction_name(int direction)
+{
+    return direction == 1 ? "out" : direction == 0 ? "in" : "?";
+}
+
+int gpio_board_reconcile(gpio_reconcile_report_t *report, FILE *log)
+{
+    const size_t count = sizeof board_plan / sizeof board_plan[0];
+    gpio_line_state_t state[sizeof board_plan / sizeof board_plan[0]];
+    bool touched[sizeof board_plan / sizeof board_plan[0]] = { false };
+    int64_t start = clock_host_ns();
+
+    memset(report, 0, sizeof *report);
+    report->lines = (unsigned int)count;
+
+    if (backend_cb) {
+        // No state to read back: just hand the output levels to the backend.
+        for (size_t i = 0; i < count; ++i) {
+            if (board_plan[i].output) {
+                gpio_write_value(board_plan[i].gpio, "value", board_plan[i].value ? "1" : "0");
+                report->value_writes++;
+            }
+        }
+        report->elapsed_ns = clock_host_ns() - start;
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        read_line_state(board_plan[i].gpio, board_plan[i].output, &state[i], &report->reads);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const gpio_plan_t *plan = &board_plan[i];
+        gpio_line_state_t *st = &state[i];
+        if (line_matches(plan, st)) {
+            continue;
+        }
+        touched[i] = true;
+
+        if (!st->exported) {
+            if (log) {
+                fprintf(log, "GPIO%d: export\n", plan->gpio);
+            }
+            report->exports++;
+            if (gpio_export(plan->gpio) != 0) {
+                continue;
+            }
+            read_line_state(plan->gpio, plan->output, st, &report->reads);
+            if (!st->exported) {
+                continue;
+            }
+        }
+
+        if (plan->output && st->direction != 1) {
+            // "high"/"low" switch direction and level in one write, so a rail that should
+            // be up is never driven low on the way to becoming an output.
+            if (log) {
+                fprintf(log, "GPIO%d: direction %s -> out (%s)\n", plan->gpio,
+                        direction_name(st->direction), plan->value ? "high" : "low");
+            }
+            report->direction_writes++;
+            gpio_write_value(plan->gpio, "direction", plan->value ? "high" : "low");
+        } else if (plan->output && st->value != plan->value) {
+            if (log) {
+                fprintf(log, "GPIO%d: value %d -> %d\n", plan->gpio, st->value, plan->value);
+            }
+            report->value_writes++;
+            gpio_write_value(plan->gpio, "value", plan->value ? "1" : "0");
+        } else if (!plan->output && st->direction != 0) {
+            if (log) {
+                fprintf(log, "GPIO%d: direction %s -> in\n", plan->gpio, direction_name(st->direction));
+            }
+            report->direction_writes++;
+            gpio_write_value(plan->gpio, "direction", "in");
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!touched[i]) {
+            continue;
+        }
+        read_line_state(board_plan[i].gpio, board_plan[i].output, &state[i], &report->reads);
+        if (!line_matches(&board_plan[i], &state[i])) {
+            report->mismatches++;
+            if (log) {
+                fprintf(log, "GPIO%d: still %s after reconcile\n", board_plan[i].gpio,
+                        state[i].exported ? direction_name(state[i].direction) : "unexported");
+            }
+        }
+    }
+
+    report->elapsed_ns = clock_host_ns() - start;
+    return report->mismatches ? -1 : 0;
 }
 
 static void init_gpio_output(int gpio, int value)
@@ -63,30 +286,104 @@ static void init_gpio_output(int gpio, int value)
     gpio_write_value(gpio, "value", value ? "1" : "0");
 }
 
-static void init_gpio_input(int gpio)
+void gpio_board_init(void)
 {
-    gpio_export(gpio);
-    gpio_write_value(gpio, "direction", "in");
+    gpio_reconcile_report_t report;
+    gpio_board_reconcile(&report, stderr);
+    gpio_reconcile_print(&report, stderr);
 }
 
-void gpio_board_init(void)
+void gpio_reconcile_print(const gpio_reconcile_report_t *report, FILE *out)
+{
+    fprintf(out, "GPIO bring-up: %u writes (%u export, %u direction, %u value), %u reads, "
+            "%u/%u lines ok, %.1f us\n",
+            report->exports + report->direction_writes + report->value_writes, report->exports,
+            report->direction_writes, report->value_writes, report->reads,
+            report->lines - report->mismatches, report->lines, report->elapsed_ns / 1000.0);
+}
+
+void gpio_setup_output(int gpio, int value)
 {
-    init_gpio_output(GPIO_LEFT_ENABLE, 1);
-    init_gpio_output(GPIO_RIGHT_ENABLE, 1);
-    init_gpio_output(GPIO_RUMBLE, 0);
-    init_gpio_input(GPIO_DIP_SWITCH);
+    init_gpio_output(gpio, value);
+}
 
-    gpio_export(GPIO_5V_ENABLE);
-    gpio_write_value(GPIO_5V_ENABLE, "direction", "out");
-    gpio_write_value(GPIO_5V_ENABLE, "value", "1");
+void gpio_set_line(int gpio, bool value)
+{
+    gpio_write_value(gpio, "value", value ? "1" : "0");
 }
 
 void gpio_set_rumble(bool enable)
 {
-    static bool current_state = false;
-    if (current_state == enable) {
+    if (rumble_state == enable) {
         return;
     }
-    current_state = enable;
+    rumble_state = enable;
     gpio_write_value(GPIO_RUMBLE, "value", enable ? "1" : "0");
 }
+
+static int write_new_file(const char *path, const char *value)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t len = (ssize_t)strlen(value);
+    ssize_t written = write(fd, value, len);
+    close(fd);
+    return (written == len) ? 0 : -1;
+}
+
+int gpio_mock_create_line(const char *root, int gpio, const char *direction, int value)
+{
+    char path[PATH_MAX];
+
+    if (mkdir(root, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    snprintf(path, sizeof path, "%s/export", root);
+    if (access(path, F_OK) != 0 && write_new_file(path, "") != 0) {
+        return -1;
+    }
+
+    snprintf(path, sizeof path, "%s/gpio%d", root, gpio);
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    snprintf(path, sizeof path, "%s/gpio%d/direction", root, gpio);
+    if (write_new_file(path, direction) != 0) {
+        return -1;
+    }
+    snprintf(path, sizeof path, "%s/gpio%d/value", root, gpio);
+    return write_new_file(path, value ? "1" : "0");
+}
+
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    (void)st;
+    (void)type;
+    (void)ftw;
+    if (remove(path) != 0) {
+        fprintf(stderr, "Failed to remove %s: %s\n", path, strerror(errno));
+    }
+    return 0;
+}
+
+int gpio_mock_remove_tree(const char *root)
+{
+    if (!root || !*root || access(root, F_OK) != 0) {
+        return 0;
+    }
+    // Depth first and without following links: only the mock tree itself goes.
+    return nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS) == 0 && access(root, F_OK) != 0 ? 0 : -1;
+}
+
+int gpio_read_value(int gpio)
+{
+    char path[PATH_MAX];
+    char buf[4];
+    snprintf(path, sizeof path, "%s/gpio%d/value", sysfs_root, gpio);
+    if (read_file_str(path, buf, sizeof buf) != 0 || buf[0] == '\0') {
+        return -1;
+    }
+    return buf[0] == '1' ? 1 : 0;
+}
@@ -4,14 +4,101 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define GPIO_LEFT_ENABLE 110  // PD14
+#define GPIO_RIGHT_ENABLE 114 // PD18
+#define GPIO_RUMBLE 227       // PH3
+#define GPIO_DIP_SWITCH 243   // PH19
+#define GPIO_5V_ENABLE 107    // PD11
 
 /**
- * Reproduce the stock inputd GPIO bring-up (power rails, DIP switch, rumble idle).
+ * In-process GPIO backend: receives every line write instead of sysfs.
+ *
+ * @param gpio  Line number.
+ * @param value Level written.
+ * @param ctx   Context given to gpio_set_backend().
+ */
+typedef void (*gpio_backend_t)(int gpio, bool value, void *ctx);
+
+/**
+ * Route value writes to a callback and skip all sysfs I/O (export/direction included).
+ *
+ * @param backend Callback, or NULL to restore sysfs.
+ * @param ctx     Passed to the callback.
+ * @return void
+ */
+void gpio_set_backend(gpio_backend_t backend, void *ctx);
+
+/**
+ * Point the sysfs helpers at a different GPIO class directory (e.g. a mock tree).
+ *
+ * @param root Directory laid out like /sys/class/gpio; NULL restores the default.
+ * @return void
+ */
+void gpio_set_sysfs_root(const char *root);
+
+/**
+ * Outcome of one gpio_board_reconcile() pass.
+ */
+typedef struct {
+    unsigned int lines;             // Lines in the bring-up plan.
+    unsigned int reads;             // Sysfs nodes read (initial state + verification).
+    unsigned int exports;           // Lines that had to be exported.
+    unsigned int direction_writes;
+    unsigned int value_writes;
+    unsigned int mismatches;        // Lines still off-plan after the writes.
+    int64_t elapsed_ns;
+} gpio_reconcile_report_t;
+
+/**
+ * Bring the board lines to the stock inputd state (power rails, DIP switch, rumble idle,
+ * 5 V enable), touching only what differs. All lines are read first, then the missing
+ * exports, directions and levels are written, then every changed line is read back.
+ * Lines that are already right see no writes, so rails that are up do not glitch.
+ *
+ * @param report Filled with what was read, written and verified.
+ * @param log    Receives one line per change or failed verification; NULL for silence.
+ * @return 0 if every line matches the plan afterwards, -1 otherwise.
+ */
+int gpio_board_reconcile(gpio_reconcile_report_t *report, FILE *log);
+
+/**
+ * Print a one-line summary of a reconcile pass.
+ *
+ * @param report Result of gpio_board_reconcile().
+ * @param out    Destination stream.
+ * @return void
+ */
+void gpio_reconcile_print(const gpio_reconcile_report_t *report, FILE *out);
+
+/**
+ * Reproduce the stock inputd GPIO bring-up with gpio_board_reconcile(), logging changes
+ * and the summary to stderr.
  *
  * @return void
  */
 void gpio_board_init(void);
 
+/**
+ * Export a line and configure it as an output with an initial value.
+ *
+ * @param gpio  Line number.
+ * @param value Initial level.
+ * @return void
+ */
+void gpio_setup_output(int gpio, int value);
+
+/**
+ * Write a line's value (no redundancy suppression).
+ *
+ * @param gpio  Line number.
+ * @param value Level to drive.
+ * @return void
+ */
+void gpio_set_line(int gpio, bool value);
+
 /**
  * Drive the rumble GPIO high/low, suppressing redundant writes.
  *
@@ -19,3 +106,30 @@ void gpio_board_init(void);
  * @return void
  */
 void gpio_set_rumble(bool enable);
+
+/**
+ * Read back a line's current value through the configured sysfs root.
+ *
+ * @param gpio Line number.
+ * @return 0 or 1, -1 if the value node cannot be read.
+ */
+int gpio_read_value(int gpio);
+
+/**
+ * Populate a mock sysfs tree with an exported line (export file, direction, value).
+ *
+ * @param root      Mock class directory (created if missing).
+ * @param gpio      Line number.
+ * @param direction "in" or "out".
+ * @param value     Initial value.
+ * @return 0 on success, -1 on filesystem error.
+ */
+int gpio_mock_create_line(const char *root, int gpio, const char *direction, int value);
+
+/**
+ * Delete a mock tree and everything under it (no-op if it does not exist).
+ *
+ * @param root Mock class directory.
+ * @return 0 if the tree is gone, -1 if something could not be removed.
+ */
+int gpio_mock_remove_tree(const char *root);
@@ -3,27 +3,328 @@
 
 // Entry point responsible for parsing CLI args and delegating to the controller runtime.
 
+#include <getopt.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "affinity/irq-affinity.h"
+#include "bench/energy-bench.h"
+#include "bench/load-bench.h"
+#include "bench/loopback-bench.h"
+#include "bench/parser-bench.h"
+#include "control/control.h"
 #include "controller/controller.h"
+#include "gpio/gpio-selftest.h"
+#include "gpio/gpio.h"
+#include "power/pm-qos.h"
+#include "ring/frame-ring.h"
+#include "ring/ring-tail.h"
+#include "rumble/rumble-loopback.h"
+#include "sim/check.h"
+#include "supervisor/supervisor.h"
+
+enum {
+    OPT_RUMBLE_LATENCY = 0x100,
+    OPT_RUMBLE_LOOPBACK,
+    OPT_CONTROL,
+    OPT_CONTROL_MODE,
+    OPT_CONTROL_GROUP,
+    OPT_RECORD,
+    OPT_SIMULATE,
+    OPT_SIMULATE_OUTPUT,
+    OPT_BENCH_LOAD,
+    OPT_CHECK,
+    OPT_CHECK_BLESS,
+    OPT_CHECK_THRESHOLD,
+    OPT_CHECK_TIMING,
+    OPT_FUZZ_PARSER,
+    OPT_BENCH_PARSER,
+    OPT_BENCH_ENERGY,
+    OPT_BENCH_POWER,
+    OPT_BENCH_CONFIG,
+    OPT_POLL_TIMEOUT,
+    OPT_LEFT_SERIAL,
+    OPT_RIGHT_SERIAL,
+    OPT_NULL_OUTPUT,
+    OPT_GPIO_ROOT,
+    OPT_FRAME_RING,
+    OPT_RING_TAIL,
+    OPT_PROFILE_STAGES,
+    OPT_BENCH_LOOPBACK,
+    OPT_EVENT_SINK,
+    OPT_PAD_BUDGET,
+    OPT_GPIO_RECONCILE,
+    OPT_IRQ_AFFINITY,
+    OPT_PROC_ROOT,
+    OPT_PM_QOS,
+    OPT_PM_QOS_IDLE,
+    OPT_PM_QOS_PATH,
+    OPT_UCLAMP,
+    OPT_UCLAMP_IDLE,
+    OPT_SUPERVISE,
+    OPT_CALIBRATE_CROSS,
+};
 
 static void print_usage(const char *prog)
 {
-    fprintf(stderr, "Usage: %s [config_dir]\n", prog);
+    fprintf(stderr,
+            "Usage: %s [options] [config_dir]\n"
+            "  --rumble-latency          time EV_FF -> GPIO stages (report on SIGUSR1/exit)\n"
+            "  --profile-stages          per-stage cycles/instructions/cache misses per frame (SIGUSR1/exit)\n"
+            "  --rumble-loopback[=DIR]   run the rumble timing self-test on a mock GPIO tree\n"
+            "  --control=PATH            control socket path (default " CONTROL_DEFAULT_PATH ", empty disables)\n"
+            "  --control-mode=OCTAL      control socket permissions (default 0600)\n"
+            "  --control-group=GROUP     group that owns the control socket, e.g. with --control-mode=0660\n"
+            "  --record=TRACE            record serial/FF input to a trace file\n"
+            "  --simulate=TRACE          replay a trace on a virtual clock (no hardware needed)\n"
+            "  --simulate-output=FILE    replayed events/GPIO edges (default stdout)\n"
+            "  --bench-load[=SPEC]       frame-to-event latency of a daemon child under CPU/mem/fsync hogs\n"
+            "                            SPEC: cpu=N,mem=N,io=N,frames=N,rate=HZ,mode=M[,mode=M],sink=FILE\n"
+            "  --check=DIR               replay DIR/*.trace, diff against goldens, gate writes/frame on DIR/baseline\n"
+            "  --check-bless             rewrite the goldens and baseline instead of comparing\n"
+            "  --check-threshold=PCT     allowed writes/frame regression over the baseline (default 25)\n"
+            "  --check-timing[=PCT]      also gate the normalised replay cost (default 100)\n"
+            "  --fuzz-parser[=N[,SEED]]  fuzz the frame parser and calibration loader\n"
+            "  --bench-parser            per-byte parser cost on clean and pathological streams\n"
+            "  --bench-loopback[=SPEC]   pty frame -> evdev/pipe event latency through a child daemon\n"
+            "                            SPEC: samples=N,gap=US,sink=auto|evdev|pipe,uclamp=off|on|both\n"
+            "  --bench-energy=TRACE      replay TRACE in real time per --bench-config, sampling battery power\n"
+            "  --bench-power=DIR         power_supply directory (default " ENERGY_POWER_SUPPLY_DEFAULT ")\n"
+            "  --bench-config=ARGS       daemon arguments for one energy configuration (repeatable)\n"
+            "  --poll-timeout=MS         main loop poll timeout (0 = auto/block, -1 = block)\n"
+            "  --pad-budget=N            serial reads per pad per loop round (default 4)\n"
+            "  --irq-affinity[=CPU]      pin the loop to CPU (default: the startup CPU) and route the pad UART IRQs there\n"
+            "  --proc-root=DIR           procfs root for IRQ lookups (default /proc)\n"
+            "  --pm-qos[=US]             hold a CPU latency bound (default 20 us) while the pads are active\n"
+            "  --pm-qos-idle=MS          release the bound after MS without input changes (default 5000)\n"
+            "  --pm-qos-path=PATH        QoS device (default " PM_QOS_DEFAULT_PATH ")\n"
+            "  --uclamp[=MIN]            raise the loop's util_min to MIN/1024 (default 512) while the pads are active\n"
+            "  --uclamp-idle=MS          halve the boost every MS without activity (default 1000)\n"
+            "  --supervise               keep the device in a supervisor and restart a crashed worker\n"
+            "  --calibrate-cross=SIDE    guided sweep of the left/right stick; prints cross_* config lines\n"
+            "  --left-serial=PATH        left pad serial device\n"
+            "  --right-serial=PATH       right pad serial device\n"
+            "  --null-output             do not create the uinput device; discard events\n"
+            "  --event-sink=PATH         write raw input_events to PATH instead of uinput\n"
+            "  --gpio-root=DIR           sysfs GPIO root (default /sys/class/gpio)\n"
+            "  --gpio-reconcile[=DIR]    run the GPIO bring-up reconciler self-test on a mock GPIO tree\n"
+            "  --frame-ring[=NAME]       publish every decoded frame to a shared-memory ring (default " FRAME_RING_DEFAULT_NAME ")\n"
+            "  --ring-tail[=NAME]        print frames from a running daemon's ring\n",
+            prog);
 }
 
 int main(int argc, char **argv)
 {
-    const char *override_dir = NULL;
+    static const struct option long_opts[] = {
+        { "rumble-latency", no_argument, NULL, OPT_RUMBLE_LATENCY },
+        { "profile-stages", no_argument, NULL, OPT_PROFILE_STAGES },
+        { "rumble-loopback", optional_argument, NULL, OPT_RUMBLE_LOOPBACK },
+        { "control", required_argument, NULL, OPT_CONTROL },
+        { "control-mode", required_argument, NULL, OPT_CONTROL_MODE },
+        { "control-group", required_argument, NULL, OPT_CONTROL_GROUP },
+        { "record", required_argument, NULL, OPT_RECORD },
+        { "simulate", required_argument, NULL, OPT_SIMULATE },
+        { "simulate-output", required_argument, NULL, OPT_SIMULATE_OUTPUT },
+        { "bench-load", optional_argument, NULL, OPT_BENCH_LOAD },
+        { "check", required_argument, NULL, OPT_CHECK },
+        { "check-bless", no_argument, NULL, OPT_CHECK_BLESS },
+        { "check-threshold", required_argument, NULL, OPT_CHECK_THRESHOLD },
+        { "check-timing", optional_argument, NULL, OPT_CHECK_TIMING },
+        { "fuzz-parser", optional_argument, NULL, OPT_FUZZ_PARSER },
+        { "bench-parser", no_argument, NULL, OPT_BENCH_PARSER },
+        { "bench-loopback", optional_argument, NULL, OPT_BENCH_LOOPBACK },
+        { "event-sink", required_argument, NULL, OPT_EVENT_SINK },
+        { "bench-energy", required_argument, NULL, OPT_BENCH_ENERGY },
+        { "bench-power", required_argument, NULL, OPT_BENCH_POWER },
+        { "bench-config", required_argument, NULL, OPT_BENCH_CONFIG },
+        { "poll-timeout", required_argument, NULL, OPT_POLL_TIMEOUT },
+        { "pad-budget", required_argument, NULL, OPT_PAD_BUDGET },
+        { "irq-affinity", optional_argument, NULL, OPT_IRQ_AFFINITY },
+        { "proc-root", required_argument, NULL, OPT_PROC_ROOT },
+        { "pm-qos", optional_argument, NULL, OPT_PM_QOS },
+        { "pm-qos-idle", required_argument, NULL, OPT_PM_QOS_IDLE },
+        { "pm-qos-path", required_argument, NULL, OPT_PM_QOS_PATH },
+        { "uclamp", optional_argument, NULL, OPT_UCLAMP },
+        { "uclamp-idle", required_argument, NULL, OPT_UCLAMP_IDLE },
+        { "supervise", no_argument, NULL, OPT_SUPERVISE },
+        { "calibrate-cross", required_argument, NULL, OPT_CALIBRATE_CROSS },
+        { "left-serial", required_argument, NULL, OPT_LEFT_SERIAL },
+        { "right-serial", required_argument, NULL, OPT_RIGHT_SERIAL },
+        { "null-output", no_argument, NULL, OPT_NULL_OUTPUT },
+        { "gpio-root", required_argument, NULL, OPT_GPIO_ROOT },
+        { "gpio-reconcile", optional_argument, NULL, OPT_GPIO_RECONCILE },
+        { "frame-ring", optional_argument, NULL, OPT_FRAME_RING },
+        { "ring-tail", optional_argument, NULL, OPT_RING_TAIL },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    controller_options_t opts = { 0 };
+    const char *check_dir = NULL;
+    bool check_bless = false;
+    unsigned int check_threshold = CHECK_DEFAULT_THRESHOLD_PCT;
+    unsigned int check_timing = 0;
+    const char *ring_tail = NULL;
+    const char *calibrate_cross = NULL;
+    const char *energy_trace = NULL;
+    const char *energy_power = ENERGY_POWER_SUPPLY_DEFAULT;
+    const char *energy_configs[ENERGY_MAX_CONFIGS];
+    size_t energy_config_count = 0;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case OPT_RUMBLE_LATENCY:
+            opts.rumble_latency = true;
+            break;
+        case OPT_PROFILE_STAGES:
+            opts.profile_stages = true;
+            break;
+        case OPT_CONTROL:
+            opts.control_path = optarg;
+            break;
+        case OPT_CONTROL_MODE:
+            opts.control_mode = (unsigned int)strtoul(optarg, NULL, 8);
+            break;
+        case OPT_CONTROL_GROUP:
+            opts.control_group = optarg;
+            break;
+        case OPT_RECORD:
+            opts.record_path = optarg;
+            break;
+        case OPT_SIMULATE:
+            opts.simulate_path = optarg;
+            break;
+        case OPT_SIMULATE_OUTPUT:
+            opts.simulate_output = optarg;
+            break;
+        case OPT_RUMBLE_LOOPBACK:
+            return rumble_loopback_run(optarg);
+        case OPT_BENCH_LOAD:
+            return load_bench_run(optarg);
+        case OPT_FUZZ_PARSER:
+            return parser_fuzz_run(optarg);
+        case OPT_BENCH_PARSER:
+            return parser_bench_run();
+        case OPT_BENCH_LOOPBACK:
+            return loopback_bench_run(optarg);
+        case OPT_EVENT_SINK:
+            opts.event_sink = optarg;
+            break;
+        case OPT_BENCH_ENERGY:
+            energy_trace = optarg;
+            break;
+        case OPT_BENCH_POWER:
+            energy_power = optarg;
+            break;
+        case OPT_BENCH_CONFIG:
+            if (energy_config_count == ENERGY_MAX_CONFIGS) {
+                fprintf(stderr, "At most %d --bench-config entries\n", ENERGY_MAX_CONFIGS);
+                return EXIT_FAILURE;
+            }
+            energy_configs[energy_config_count++] = optarg;
+            break;
+        case OPT_POLL_TIMEOUT:
+            opts.poll_timeout_ms = (int)strtol(optarg, NULL, 10);
+            break;
+        case OPT_PAD_BUDGET:
+            opts.pad_budget = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case OPT_IRQ_AFFINITY:
+            opts.irq_affinity = true;
+            opts.irq_cpu = optarg ? (int)strtol(optarg, NULL, 10) : IRQ_AFFINITY_CURRENT;
+            break;
+        case OPT_PROC_ROOT:
+            irq_affinity_set_proc_root(optarg);
+            break;
+        case OPT_PM_QOS:
+            opts.pm_qos = true;
+            opts.pm_qos_us = optarg ? (int)strtol(optarg, NULL, 10) : PM_QOS_DEFAULT_LATENCY_US;
+            break;
+        case OPT_PM_QOS_IDLE:
+            opts.pm_qos_idle_ms = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case OPT_PM_QOS_PATH:
+            opts.pm_qos_path = optarg;
+            break;
+        case OPT_UCLAMP:
+            opts.uclamp = true;
+            opts.uclamp_min = optarg ? (unsigned int)strtoul(optarg, NULL, 10) : 0;
+            break;
+        case OPT_UCLAMP_IDLE:
+            opts.uclamp_idle_ms = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case OPT_SUPERVISE:
+            opts.supervise = true;
+            break;
+        case OPT_CALIBRATE_CROSS:
+            calibrate_cross = optarg;
+            break;
+        case OPT_LEFT_SERIAL:
+            opts.left_serial = optarg;
+            break;
+        case OPT_RIGHT_SERIAL:
+            opts.right_serial = optarg;
+            break;
+        case OPT_NULL_OUTPUT:
+            opts.null_output = true;
+            break;
+        case OPT_GPIO_ROOT:
+            gpio_set_sysfs_root(optarg);
+            break;
+        case OPT_GPIO_RECONCILE:
+            return gpio_reconcile_selftest_run(optarg);
+        case OPT_FRAME_RING:
+            opts.frame_ring = optarg ? optarg : FRAME_RING_DEFAULT_NAME;
+            break;
+        case OPT_RING_TAIL:
+            ring_tail = optarg ? optarg : FRAME_RING_DEFAULT_NAME;
+            break;
+        case OPT_CHECK:
+            check_dir = optarg;
+            break;
+        case OPT_CHECK_BLESS:
+            check_bless = true;
+            break;
+        case OPT_CHECK_THRESHOLD:
+            check_threshold = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case OPT_CHECK_TIMING:
+            check_timing = optarg ? (unsigned int)strtoul(optarg, NULL, 10) : CHECK_DEFAULT_TIMING_PCT;
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return EXIT_SUCCESS;
+        default:
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (ring_tail) {
+        return frame_ring_tail_run(ring_tail, opts.control_path ? opts.control_path : CONTROL_DEFAULT_PATH);
+    }
+    if (energy_trace) {
+        return energy_bench_run(energy_trace, energy_power, energy_configs, energy_config_count);
+    }
+    if (check_dir) {
+        return check_run(check_dir, check_bless, check_threshold, check_timing);
+    }
 
-    if (argc > 2) {
+    if (argc - optind > 1) {
         print_usage(argv[0]);
         return EXIT_FAILURE;
     }
-    if (argc == 2) {
-        override_dir = argv[1];
+    if (argc - optind == 1) {
+        opts.config_override_dir = argv[optind];
     }
 
-    return run_controller(override_dir);
+    if (calibrate_cross) {
+        return controller_calibrate_cross(&opts, calibrate_cross);
+    }
+    if (opts.supervise && !opts.simulate_path) {
+        return supervisor_run(&opts);
+    }
+    return run_controller(&opts);
 }
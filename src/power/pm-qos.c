@@ -0,0 +1,82 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// CPU latency QoS request, held while the pads are active and dropped when they go idle.
+
+#include "pm-qos.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+void pm_qos_init(pm_qos_t *q, const char *path, int32_t latency_us, unsigned int idle_ms, bool enabled)
+{
+    memset(q, 0, sizeof *q);
+    q->path = path ? path : PM_QOS_DEFAULT_PATH;
+    q->latency_us = latency_us;
+    q->idle_ms = idle_ms ? idle_ms : PM_QOS_DEFAULT_IDLE_MS;
+    q->enabled = enabled;
+    q->fd = -1;
+}
+
+bool pm_qos_activity(pm_qos_t *q, int64_t now_ns)
+{
+    if (!q->enabled) {
+        return false;
+    }
+    q->last_active_ns = now_ns;
+    if (q->fd >= 0) {
+        return false;
+    }
+
+    int fd = open(q->path, O_WRONLY | O_CLOEXEC);
+    // The device takes the bound as a binary s32; it holds until the fd is closed.
+    if (fd < 0 || write(fd, &q->latency_us, sizeof q->latency_us) != (ssize_t)sizeof q->latency_us) {
+        fprintf(stderr, "PM QoS: %s: %s, disabling\n", q->path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        q->enabled = false;
+        return false;
+    }
+    q->fd = fd;
+    q->held_since_ns = now_ns;
+    q->acquires++;
+    return true;
+}
+
+int64_t pm_qos_deadline(const pm_qos_t *q)
+{
+    if (q->fd < 0) {
+        return 0;
+    }
+    return q->last_active_ns + (int64_t)q->idle_ms * 1000000LL;
+}
+
+void pm_qos_release(pm_qos_t *q, int64_t now_ns)
+{
+    if (q->fd < 0) {
+        return;
+    }
+    close(q->fd);
+    q->fd = -1;
+    q->held_ns += now_ns - q->held_since_ns;
+}
+
+void pm_qos_expire(pm_qos_t *q, int64_t now_ns)
+{
+    if (q->fd >= 0 && now_ns >= pm_qos_deadline(q)) {
+        pm_qos_release(q, now_ns);
+    }
+}
+
+void pm_qos_format(const pm_qos_t *q, int64_t now_ns, char *buf, size_t len)
+{
+    int64_t held = q->held_ns + (q->fd >= 0 ? now_ns - q->held_since_ns : 0);
+    snprintf(buf, len, "%s latency=%" PRId32 "us idle=%ums acquires=%" PRIu64 " held=%" PRId64 "ms path=%s",
+             !q->enabled ? "off" : q->fd >= 0 ? "held" : "released", q->latency_us, q->idle_ms,
+             q->acquires, held / 1000000, q->path);
+}
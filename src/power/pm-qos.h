@@ -0,0 +1,82 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PM_QOS_DEFAULT_PATH "/dev/cpu_dma_latency"
+#define PM_QOS_DEFAULT_LATENCY_US 20
+#define PM_QOS_DEFAULT_IDLE_MS 5000
+
+/**
+ * A CPU latency QoS request that is held only while the pads are in use. The kernel keeps
+ * the request for as long as the device stays open, so releasing it is a close().
+ */
+typedef struct {
+    const char *path;
+    int32_t latency_us;
+    unsigned int idle_ms;       // Release after this long without input changes.
+    bool enabled;               // Cleared for good if the device cannot be opened.
+    int fd;                     // Open while the request is held.
+    int64_t last_active_ns;
+    int64_t held_since_ns;
+    int64_t held_ns;            // Total time held by past (released) requests.
+    uint64_t acquires;
+} pm_qos_t;
+
+/**
+ * Set up a request in the released state.
+ *
+ * @param q          Request state.
+ * @param path       QoS device; NULL for PM_QOS_DEFAULT_PATH.
+ * @param latency_us Latency bound written while held.
+ * @param idle_ms    Idle period before release; 0 for PM_QOS_DEFAULT_IDLE_MS.
+ * @param enabled    false makes every other call a no-op.
+ */
+void pm_qos_init(pm_qos_t *q, const char *path, int32_t latency_us, unsigned int idle_ms, bool enabled);
+
+/**
+ * Note input activity; takes the request if it is not held.
+ *
+ * @param q      Request state.
+ * @param now_ns Current CLOCK_MONOTONIC time.
+ * @return true if the request was just taken (the caller should schedule pm_qos_deadline()).
+ */
+bool pm_qos_activity(pm_qos_t *q, int64_t now_ns);
+
+/**
+ * When the request falls idle if no further activity arrives.
+ *
+ * @param q Request state.
+ * @return Deadline in CLOCK_MONOTONIC ns, 0 when nothing is held.
+ */
+int64_t pm_qos_deadline(const pm_qos_t *q);
+
+/**
+ * Release the request if the idle period has passed since the last activity.
+ *
+ * @param q      Request state.
+ * @param now_ns Current CLOCK_MONOTONIC time.
+ */
+void pm_qos_expire(pm_qos_t *q, int64_t now_ns);
+
+/**
+ * Release the request unconditionally (shutdown).
+ *
+ * @param q      Request state.
+ * @param now_ns Current CLOCK_MONOTONIC time.
+ */
+void pm_qos_release(pm_qos_t *q, int64_t now_ns);
+
+/**
+ * One-line status: state, bound, idle period, acquisitions and total time held.
+ *
+ * @param q      Request state.
+ * @param now_ns Current time, to include an ongoing hold.
+ * @param buf    Destination buffer.
+ * @param len    Buffer size.
+ */
+void pm_qos_format(const pm_qos_t *q, int64_t now_ns, char *buf, size_t len);
@@ -0,0 +1,136 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Utilization-clamp boost for the input loop during bursts of activity.
+
+#define _GNU_SOURCE
+
+#include "uclamp.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SCHED_FLAG_KEEP_POLICY
+#define SCHED_FLAG_KEEP_POLICY 0x08
+#endif
+#ifndef SCHED_FLAG_KEEP_PARAMS
+#define SCHED_FLAG_KEEP_PARAMS 0x10
+#endif
+#ifndef SCHED_FLAG_UTIL_CLAMP_MIN
+#define SCHED_FLAG_UTIL_CLAMP_MIN 0x20
+#endif
+
+// struct sched_attr, SCHED_ATTR_SIZE_VER1 layout (glibc has no wrapper or definition).
+typedef struct {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+    uint32_t sched_util_min;
+    uint32_t sched_util_max;
+} uclamp_attr_t;
+
+// Only util_min changes; policy, nice/priority and util_max are kept as they are.
+static int set_util_min(unsigned int util_min)
+{
+    uclamp_attr_t attr;
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.sched_flags = SCHED_FLAG_KEEP_POLICY | SCHED_FLAG_KEEP_PARAMS | SCHED_FLAG_UTIL_CLAMP_MIN;
+    attr.sched_util_min = util_min;
+    return (int)syscall(SYS_sched_setattr, 0, &attr, 0);
+}
+
+bool uclamp_supported(void)
+{
+    return set_util_min(0) == 0;
+}
+
+void uclamp_boost_init(uclamp_boost_t *b, unsigned int util_min, unsigned int idle_ms, bool enabled)
+{
+    memset(b, 0, sizeof *b);
+    b->util_min = util_min ? util_min : UCLAMP_DEFAULT_UTIL_MIN;
+    if (b->util_min > UCLAMP_SCALE) {
+        b->util_min = UCLAMP_SCALE;
+    }
+    b->idle_ms = idle_ms ? idle_ms : UCLAMP_DEFAULT_IDLE_MS;
+    b->enabled = enabled;
+}
+
+static bool apply_level(uclamp_boost_t *b, unsigned int level, int64_t now_ns)
+{
+    if (set_util_min(level) != 0) {
+        fprintf(stderr, "uclamp: sched_setattr(util_min=%u): %s, disabling\n", level, strerror(errno));
+        if (b->level) {
+            b->boosted_ns += now_ns - b->boosted_since_ns;
+        }
+        b->level = 0;
+        b->enabled = false;
+        return false;
+    }
+    if (!b->level && level) {
+        b->boosted_since_ns = now_ns;
+    } else if (b->level && !level) {
+        b->boosted_ns += now_ns - b->boosted_since_ns;
+    }
+    b->level = level;
+    return true;
+}
+
+bool uclamp_boost_activity(uclamp_boost_t *b, int64_t now_ns)
+{
+    if (!b->enabled) {
+        return false;
+    }
+    b->last_change_ns = now_ns;
+    if (b->level == b->util_min) {
+        return false;
+    }
+    bool was_off = b->level == 0;
+    if (!apply_level(b, b->util_min, now_ns)) {
+        return false;
+    }
+    b->boosts++;
+    return was_off;
+}
+
+int64_t uclamp_boost_deadline(const uclamp_boost_t *b)
+{
+    if (b->level == 0) {
+        return 0;
+    }
+    return b->last_change_ns + (int64_t)b->idle_ms * 1000000LL;
+}
+
+void uclamp_boost_expire(uclamp_boost_t *b, int64_t now_ns)
+{
+    if (b->level == 0 || now_ns < uclamp_boost_deadline(b)) {
+        return;
+    }
+    unsigned int next = b->level / 2;
+    apply_level(b, next < UCLAMP_FLOOR ? 0 : next, now_ns);
+    b->last_change_ns = now_ns;
+}
+
+void uclamp_boost_release(uclamp_boost_t *b, int64_t now_ns)
+{
+    if (b->level) {
+        apply_level(b, 0, now_ns);
+    }
+}
+
+void uclamp_boost_format(const uclamp_boost_t *b, int64_t now_ns, char *buf, size_t len)
+{
+    int64_t boosted = b->boosted_ns + (b->level ? now_ns - b->boosted_since_ns : 0);
+    snprintf(buf, len, "%s level=%u/%u decay=%ums boosts=%" PRIu64 " boosted=%" PRId64 "ms",
+             !b->enabled ? "off" : b->level ? "boosted" : "idle", b->level, b->util_min, b->idle_ms,
+             b->boosts, boosted / 1000000);
+}
@@ -0,0 +1,91 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define UCLAMP_SCALE 1024               // Kernel utilization scale (SCHED_CAPACITY_SCALE).
+#define UCLAMP_DEFAULT_UTIL_MIN 512
+#define UCLAMP_DEFAULT_IDLE_MS 1000
+#define UCLAMP_FLOOR 64                 // Decay below this drops the clamp entirely.
+
+/**
+ * util_min (uclamp) boost of the calling thread: raised to util_min on input activity,
+ * halved every idle_ms without activity, and cleared once it falls under UCLAMP_FLOOR.
+ * schedutil then picks a frequency for the loop's short bursts that its own tiny
+ * utilization would never ask for.
+ */
+typedef struct {
+    unsigned int util_min;      // Boost level on activity (0..UCLAMP_SCALE).
+    unsigned int idle_ms;       // Decay step period.
+    bool enabled;               // Cleared for good if the kernel rejects the clamp.
+    unsigned int level;         // Current util_min (0 = not boosted).
+    int64_t last_change_ns;     // Last activity or decay step.
+    int64_t boosted_since_ns;
+    int64_t boosted_ns;         // Total time boosted by past episodes.
+    uint64_t boosts;            // Raises to the full level.
+} uclamp_boost_t;
+
+/**
+ * Check whether the kernel accepts utilization clamps (CONFIG_UCLAMP_TASK) by clearing
+ * the calling thread's util_min.
+ *
+ * @return true if sched_setattr() with SCHED_FLAG_UTIL_CLAMP_MIN works.
+ */
+bool uclamp_supported(void);
+
+/**
+ * Set up an unboosted state.
+ *
+ * @param b        Boost state.
+ * @param util_min Level applied on activity; 0 for UCLAMP_DEFAULT_UTIL_MIN.
+ * @param idle_ms  Decay period; 0 for UCLAMP_DEFAULT_IDLE_MS.
+ * @param enabled  false makes every other call a no-op.
+ */
+void uclamp_boost_init(uclamp_boost_t *b, unsigned int util_min, unsigned int idle_ms, bool enabled);
+
+/**
+ * Note activity on the calling thread; raises the clamp to the full level if it is lower.
+ *
+ * @param b      Boost state.
+ * @param now_ns Current CLOCK_MONOTONIC time.
+ * @return true if the boost just went from off to on (the caller should schedule the deadline).
+ */
+bool uclamp_boost_activity(uclamp_boost_t *b, int64_t now_ns);
+
+/**
+ * When the next decay step is due if no further activity arrives.
+ *
+ * @param b Boost state.
+ * @return Deadline in CLOCK_MONOTONIC ns, 0 when not boosted.
+ */
+int64_t uclamp_boost_deadline(const uclamp_boost_t *b);
+
+/**
+ * Apply a decay step if one is due.
+ *
+ * @param b      Boost state.
+ * @param now_ns Current CLOCK_MONOTONIC time.
+ */
+void uclamp_boost_expire(uclamp_boost_t *b, int64_t now_ns);
+
+/**
+ * Clear the clamp unconditionally (shutdown).
+ *
+ * @param b      Boost state.
+ * @param now_ns Current CLOCK_MONOTONIC time.
+ */
+void uclamp_boost_release(uclamp_boost_t *b, int64_t now_ns);
+
+/**
+ * One-line status: current and full level, decay period, boosts and total time boosted.
+ *
+ * @param b      Boost state.
+ * @param now_ns Current time, to include an ongoing boost.
+ * @param buf    Destination buffer.
+ * @param len    Buffer size.
+ */
+void uclamp_boost_format(const uclamp_boost_t *b, int64_t now_ns, char *buf, size_t len);
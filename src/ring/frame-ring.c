@@ -0,0 +1,307 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Single-producer / multi-consumer shared-memory ring of decoded pad frames.
+
+#include "frame-ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t ring_bytes(void)
+{
+    return sizeof(frame_ring_shared_t) + (size_t)FRAME_RING_SLOTS * sizeof(frame_ring_slot_t);
+}
+
+void frame_ring_init(frame_ring_t *ring)
+{
+    memset(ring, 0, sizeof *ring);
+    for (int i = 0; i < FRAME_RING_MAX_SUBSCRIBERS; ++i) {
+        ring->subscribers[i] = -1;
+    }
+}
+
+int frame_ring_create(frame_ring_t *ring, const char *name)
+{
+    frame_ring_init(ring);
+    if (!name || name[0] != '/' || strlen(name) >= sizeof ring->name) {
+        fprintf(stderr, "Frame ring name must start with '/' and be shorter than %zu\n", sizeof ring->name);
+        return -1;
+    }
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create frame ring %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    size_t len = ring_bytes();
+    if (ftruncate(fd, (off_t)len) != 0) {
+        perror("frame ring ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("frame ring mmap");
+        shm_unlink(name);
+        return -1;
+    }
+
+    frame_ring_shared_t *shm = map;
+    shm->version = FRAME_RING_VERSION;
+    shm->slot_count = FRAME_RING_SLOTS;
+    shm->slot_size = sizeof(frame_ring_slot_t);
+    __atomic_store_n(&shm->head, 0, __ATOMIC_RELAXED);
+    // Readers check the magic last, so it only appears once the layout fields are valid.
+    __atomic_store_n(&shm->magic, FRAME_RING_MAGIC, __ATOMIC_RELEASE);
+
+    ring->shm = shm;
+    ring->map_len = len;
+    snprintf(ring->name, sizeof ring->name, "%s", name);
+    return 0;
+}
+
+void frame_ring_destroy(frame_ring_t *ring)
+{
+    for (int i = 0; i < FRAME_RING_MAX_SUBSCRIBERS; ++i) {
+        if (ring->subscribers[i] >= 0) {
+            close(ring->subscribers[i]);
+            ring->subscribers[i] = -1;
+        }
+    }
+    if (!ring->shm) {
+        return;
+    }
+    munmap(ring->shm, ring->map_len);
+    shm_unlink(ring->name);
+    ring->shm = NULL;
+}
+
+void frame_ring_publish(frame_ring_t *ring, const frame_ring_slot_t *frame)
+{
+    frame_ring_shared_t *shm = ring->shm;
+    if (!shm) {
+        return;
+    }
+
+    uint64_t seq = __atomic_load_n(&shm->head, __ATOMIC_RELAXED) + 1;
+    frame_ring_slot_t *slot = &shm->slots[(seq - 1) & (FRAME_RING_SLOTS - 1)];
+
+    // Per-slot seqlock: invalidate, fill, then publish the new sequence number.
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->t_ns = frame->t_ns;
+    slot->side = frame->side;
+    slot->buttons = frame->buttons;
+    slot->hat_x = frame->hat_x;
+    slot->hat_y = frame->hat_y;
+    slot->raw_x = frame->raw_x;
+    slot->raw_y = frame->raw_y;
+    slot->axis_x = frame->axis_x;
+    slot->axis_y = frame->axis_y;
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&shm->head, seq, __ATOMIC_RELEASE);
+
+    // A full socket already reads as ready; EPIPE means the reader is gone.
+    const uint8_t poke = 1;
+    for (int i = 0; i < FRAME_RING_MAX_SUBSCRIBERS; ++i) {
+        if (ring->subscribers[i] >= 0 &&
+            send(ring->subscribers[i], &poke, sizeof poke, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 &&
+            errno != EAGAIN && errno != EWOULDBLOCK) {
+            close(ring->subscribers[i]);
+            ring->subscribers[i] = -1;
+        }
+    }
+}
+
+int frame_ring_subscribe(frame_ring_t *ring, int *slot_out)
+{
+    if (!ring->shm) {
+        return -1;
+    }
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) != 0) {
+        perror("socketpair");
+        return -1;
+    }
+    // The daemon only writes and the reader only reads.
+    shutdown(sv[0], SHUT_RD);
+    shutdown(sv[1], SHUT_WR);
+
+    int slot = -1;
+    for (int i = 0; i < FRAME_RING_MAX_SUBSCRIBERS; ++i) {
+        if (ring->subscribers[i] < 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        // Departed readers are retired on the next publish; these are all live, so the
+        // oldest one gives way and sees EOF.
+        slot = (int)(ring->next_recycle++ % FRAME_RING_MAX_SUBSCRIBERS);
+        close(ring->subscribers[slot]);
+    }
+    ring->subscribers[slot] = sv[0];
+    if (slot_out) {
+        *slot_out = slot;
+    }
+    return sv[1];
+}
+
+int frame_ring_send_subscription(const frame_ring_t *ring, int slot, int sock)
+{
+    if (slot < 0 || slot >= FRAME_RING_MAX_SUBSCRIBERS || ring->subscribers[slot] < 0) {
+        return -1;
+    }
+    int32_t index = slot;
+    struct iovec iov = { .iov_base = &index, .iov_len = sizeof index };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof control);
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof control.buf,
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &ring->subscribers[slot], sizeof(int));
+    if (sendmsg(sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        perror("frame ring hand-over");
+        return -1;
+    }
+    return 0;
+}
+
+int frame_ring_recv_subscription(frame_ring_t *ring, int sock)
+{
+    int32_t index = -1;
+    struct iovec iov = { .iov_base = &index, .iov_len = sizeof index };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof control);
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof control.buf,
+    };
+    ssize_t r = recvmsg(sock, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (r < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    int fd = -1;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof fd);
+    }
+    if (fd < 0) {
+        return -1;
+    }
+    if (r != (ssize_t)sizeof index || index < 0 || index >= FRAME_RING_MAX_SUBSCRIBERS) {
+        close(fd);
+        return -1;
+    }
+    if (ring->subscribers[index] >= 0) {
+        close(ring->subscribers[index]);
+    }
+    ring->subscribers[index] = fd;
+    return 1;
+}
+
+int frame_ring_attach(frame_ring_reader_t *r, const char *name)
+{
+    memset(r, 0, sizeof *r);
+    int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open frame ring %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(frame_ring_shared_t)) {
+        fprintf(stderr, "Frame ring %s is truncated\n", name);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("frame ring mmap");
+        return -1;
+    }
+
+    const frame_ring_shared_t *shm = map;
+    if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != FRAME_RING_MAGIC ||
+        shm->version != FRAME_RING_VERSION || shm->slot_size != sizeof(frame_ring_slot_t) ||
+        shm->slot_count == 0 || (shm->slot_count & (shm->slot_count - 1)) != 0 ||
+        sizeof(frame_ring_shared_t) + (size_t)shm->slot_count * shm->slot_size > (size_t)st.st_size) {
+        fprintf(stderr, "Frame ring %s has an unexpected layout\n", name);
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+
+    r->shm = shm;
+    r->map_len = (size_t)st.st_size;
+    r->cursor = __atomic_load_n(&shm->head, __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+bool frame_ring_read(frame_ring_reader_t *r, frame_ring_slot_t *out)
+{
+    const frame_ring_shared_t *shm = r->shm;
+    const uint64_t slots = shm->slot_count;
+
+    for (;;) {
+        uint64_t head = __atomic_load_n(&shm->head, __ATOMIC_ACQUIRE);
+        if (r->cursor >= head) {
+            return false;
+        }
+        if (head - r->cursor > slots) {
+            r->lost += head - r->cursor - slots;
+            r->cursor = head - slots;
+        }
+
+        uint64_t want = r->cursor + 1;
+        const frame_ring_slot_t *slot = &shm->slots[(want - 1) & (slots - 1)];
+        uint64_t before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        memcpy(out, slot, sizeof *out);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint64_t after = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+        if (before == want && after == want) {
+            out->seq = want;
+            r->cursor = want;
+            return true;
+        }
+        // A zero means the producer is rewriting this slot right now (we are about to be
+        // lapped); come back on the next wakeup instead of spinning on it.
+        if (before == 0 || after == 0) {
+            return false;
+        }
+        // Already overwritten by a newer frame: resync from the new head.
+    }
+}
+
+void frame_ring_detach(frame_ring_reader_t *r)
+{
+    if (r->shm) {
+        munmap((void *)r->shm, r->map_len);
+        r->shm = NULL;
+    }
+}
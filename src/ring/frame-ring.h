@@ -0,0 +1,155 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FRAME_RING_DEFAULT_NAME "/trimui_inputd.frames"
+#define FRAME_RING_SLOTS 1024u          // Power of two.
+#define FRAME_RING_MAGIC 0x46505354u     // "TSPF"
+#define FRAME_RING_VERSION 1u
+#define FRAME_RING_MAX_SUBSCRIBERS 8
+
+/**
+ * One decoded and mapped pad frame.
+ */
+typedef struct {
+    uint64_t seq;       // 1-based sequence number; 0 while the slot is being rewritten.
+    int64_t t_ns;       // CLOCK_MONOTONIC time the frame was decoded.
+    uint8_t side;       // 0 = left pad, 1 = right pad.
+    uint8_t buttons;    // Raw button bitfield.
+    int8_t hat_x;       // D-pad hat after mapping (left pad only).
+    int8_t hat_y;
+    uint16_t raw_x;     // ADC values as received.
+    uint16_t raw_y;
+    int16_t axis_x;     // Calibrated axis values as sent to uinput.
+    int16_t axis_y;
+} frame_ring_slot_t;
+
+/**
+ * Shared-memory layout: a header followed by FRAME_RING_SLOTS slots.
+ * head counts published frames; frame n lives in slot (n - 1) % slot_count.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint64_t head;
+    uint8_t pad[40];    // Keep the slots off the header's cache line.
+    frame_ring_slot_t slots[];
+} frame_ring_shared_t;
+
+/**
+ * Producer side, owned by the daemon.
+ */
+typedef struct {
+    frame_ring_shared_t *shm;
+    size_t map_len;
+    char name[64];
+    int subscribers[FRAME_RING_MAX_SUBSCRIBERS];   // Socket ends poked on every publish (-1 = free)
+    unsigned int next_recycle;
+} frame_ring_t;
+
+/**
+ * Consumer side; each reader keeps its own cursor.
+ */
+typedef struct {
+    const frame_ring_shared_t *shm;
+    size_t map_len;
+    uint64_t cursor;    // Sequence number of the last frame read.
+    uint64_t lost;      // Frames overwritten before this reader got to them.
+} frame_ring_reader_t;
+
+/**
+ * Put a producer in the closed state (no shared memory, no subscribers).
+ *
+ * @param ring Producer state.
+ */
+void frame_ring_init(frame_ring_t *ring);
+
+/**
+ * Create (or replace) the shared-memory ring.
+ *
+ * @param ring Producer state to initialize (shm is NULL on failure).
+ * @param name shm_open() name, e.g. FRAME_RING_DEFAULT_NAME.
+ * @return 0 on success, -1 on error.
+ */
+int frame_ring_create(frame_ring_t *ring, const char *name);
+
+/**
+ * Unmap and unlink the ring and close subscriber sockets. Safe on a ring that never opened.
+ *
+ * @param ring Producer state.
+ */
+void frame_ring_destroy(frame_ring_t *ring);
+
+/**
+ * Append one frame and wake subscribers; a subscriber whose reader closed its end is
+ * retired. No-op when the ring is not open.
+ *
+ * @param ring  Producer state.
+ * @param frame Frame to copy in (its seq field is ignored).
+ */
+void frame_ring_publish(frame_ring_t *ring, const frame_ring_slot_t *frame);
+
+/**
+ * Register a blocking reader. Closing the returned socket ends the subscription; when all
+ * slots are held by live readers the oldest subscription is recycled.
+ *
+ * @param ring Producer state.
+ * @param slot Receives the subscriber slot used; may be NULL.
+ * @return Non-blocking socket to hand to the reader: it turns readable on every publish and
+ *         reports EOF once the subscription is dropped. -1 on error.
+ */
+int frame_ring_subscribe(frame_ring_t *ring, int *slot);
+
+/**
+ * Pass the producer end of a subscription to the process that keeps subscriptions across
+ * worker restarts (SCM_RIGHTS over a SOCK_SEQPACKET socket).
+ *
+ * @param ring Producer state.
+ * @param slot Slot returned by frame_ring_subscribe().
+ * @param sock Socket to the keeper.
+ * @return 0 on success, -1 on error.
+ */
+int frame_ring_send_subscription(const frame_ring_t *ring, int slot, int sock);
+
+/**
+ * Take one subscription sent with frame_ring_send_subscription() and install it in its
+ * slot, replacing (and closing) what was there. Does not block.
+ *
+ * @param ring Producer state of the keeper.
+ * @param sock Socket from the worker.
+ * @return 1 if a subscription was installed, 0 if none was pending, -1 on error.
+ */
+int frame_ring_recv_subscription(frame_ring_t *ring, int sock);
+
+/**
+ * Map an existing ring read-only; the cursor starts at the current head.
+ *
+ * @param r    Reader to initialize.
+ * @param name shm_open() name.
+ * @return 0 on success, -1 on error or layout mismatch.
+ */
+int frame_ring_attach(frame_ring_reader_t *r, const char *name);
+
+/**
+ * Fetch the next frame after the reader's cursor. If the producer lapped the reader, the
+ * cursor jumps to the oldest frame still in the ring and the gap is added to r->lost.
+ *
+ * @param r   Reader.
+ * @param out Destination frame.
+ * @return true if a frame was copied, false if the reader is caught up.
+ */
+bool frame_ring_read(frame_ring_reader_t *r, frame_ring_slot_t *out);
+
+/**
+ * Unmap a reader.
+ *
+ * @param r Reader.
+ */
+void frame_ring_detach(frame_ring_reader_t *r);
@@ -0,0 +1,83 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Reference consumer for the frame ring: socket-driven tail of every published frame.
+
+#include "ring-tail.h"
+
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../control/control.h"
+#include "frame-ring.h"
+
+#define TAIL_FALLBACK_POLL_MS 1
+#define TAIL_WAKE_TIMEOUT_MS 100
+
+static volatile sig_atomic_t tail_running = 1;
+
+static void handle_tail_signal(int sig)
+{
+    (void)sig;
+    tail_running = 0;
+}
+
+int frame_ring_tail_run(const char *name, const char *control_path)
+{
+    frame_ring_reader_t reader;
+    if (frame_ring_attach(&reader, name) != 0) {
+        return 1;
+    }
+
+    int efd = -1;
+    if (control_path && *control_path) {
+        char reply[64];
+        if (control_request(control_path, "ring-subscribe", reply, sizeof reply, &efd, 500) != 0 || efd < 0) {
+            fprintf(stderr, "No subscription from %s, polling every %d ms\n", control_path, TAIL_FALLBACK_POLL_MS);
+        }
+    }
+
+    signal(SIGINT, handle_tail_signal);
+    signal(SIGTERM, handle_tail_signal);
+
+    uint64_t frames = 0;
+    uint64_t reported_lost = 0;
+    frame_ring_slot_t f;
+    while (tail_running) {
+        struct pollfd pfd = { .fd = efd, .events = POLLIN };
+        if (poll(&pfd, efd >= 0 ? 1 : 0, efd >= 0 ? TAIL_WAKE_TIMEOUT_MS : TAIL_FALLBACK_POLL_MS) > 0) {
+            // One byte per frame; the ring is the source of truth, so just drain them.
+            uint8_t pokes[256];
+            if (read(efd, pokes, sizeof pokes) == 0) {
+                fprintf(stderr, "Subscription dropped, polling every %d ms\n", TAIL_FALLBACK_POLL_MS);
+                close(efd);
+                efd = -1;
+            }
+        }
+
+        while (frame_ring_read(&reader, &f)) {
+            ++frames;
+            if (reader.lost != reported_lost) {
+                printf("# lost %" PRIu64 " frames\n", reader.lost - reported_lost);
+                reported_lost = reader.lost;
+            }
+            printf("%" PRIu64 " %" PRId64 " %c buttons=%02x raw=%u,%u axis=%d,%d hat=%d,%d\n",
+                   f.seq, f.t_ns / 1000, f.side ? 'R' : 'L', f.buttons, f.raw_x, f.raw_y,
+                   f.axis_x, f.axis_y, f.hat_x, f.hat_y);
+        }
+        fflush(stdout);
+    }
+
+    fprintf(stderr, "Frame ring tail: %" PRIu64 " frames, %" PRIu64 " lost\n", frames, reader.lost);
+    if (efd >= 0) {
+        close(efd);
+    }
+    frame_ring_detach(&reader);
+    return 0;
+}
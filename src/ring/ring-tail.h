@@ -0,0 +1,15 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+/**
+ * Reference frame-ring consumer: print every frame the daemon publishes until SIGINT.
+ * Blocks on a subscription socket obtained over the control socket, or polls every millisecond
+ * when the socket is unavailable.
+ *
+ * @param name         shm name of the ring.
+ * @param control_path Control socket used for "ring-subscribe" (NULL or "" to poll).
+ * @return 0 on clean exit, 1 if the ring could not be attached.
+ */
+int frame_ring_tail_run(const char *name, const char *control_path);
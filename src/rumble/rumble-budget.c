@@ -0,0 +1,107 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Rolling on-time budget that throttles the rumble motor to save battery and heat.
+
+#include "rumble-budget.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+void rumble_budget_defaults(rumble_budget_cfg_t *cfg)
+{
+    cfg->window_ms = RUMBLE_BUDGET_DEFAULT_WINDOW_MS;
+    cfg->on_ms = RUMBLE_BUDGET_DEFAULT_ON_MS;
+    cfg->min_duty = RUMBLE_BUDGET_DEFAULT_MIN_DUTY;
+    cfg->max_pulse_ms = 0;
+}
+
+void rumble_budget_init(rumble_budget_t *b, const rumble_budget_cfg_t *cfg, int64_t now_ns)
+{
+    memset(b, 0, sizeof *b);
+    b->cfg = *cfg;
+    b->last_ns = now_ns;
+}
+
+static bool budget_enabled(const rumble_budget_t *b)
+{
+    return b->cfg.on_ms > 0 && b->cfg.window_ms > b->cfg.on_ms;
+}
+
+static int64_t capacity_ns(const rumble_budget_t *b)
+{
+    return (int64_t)b->cfg.on_ms * 1000000LL;
+}
+
+void rumble_budget_update(rumble_budget_t *b, int64_t now_ns, bool motor_on)
+{
+    int64_t dt = now_ns - b->last_ns;
+    if (dt > 0) {
+        if (b->motor_on) {
+            b->total_on_ns += (uint64_t)dt;
+            b->level_ns += dt;
+        }
+        if (budget_enabled(b)) {
+            b->level_ns -= dt * (int64_t)b->cfg.on_ms / (int64_t)b->cfg.window_ms;
+            if (b->level_ns < 0) b->level_ns = 0;
+            if (b->level_ns > capacity_ns(b)) b->level_ns = capacity_ns(b);
+        } else {
+            b->level_ns = 0;
+        }
+        b->last_ns = now_ns;
+    }
+    b->motor_on = motor_on;
+}
+
+uint8_t rumble_budget_scale(const rumble_budget_t *b)
+{
+    if (!budget_enabled(b)) {
+        return 100;
+    }
+    int64_t cap = capacity_ns(b);
+    int64_t soft = cap * RUMBLE_BUDGET_SOFT_PERCENT / 100;
+    if (b->level_ns < soft) {
+        return 100;
+    }
+    if (b->level_ns >= cap) {
+        return 0;
+    }
+    int64_t span = 100 - b->cfg.min_duty;
+    return (uint8_t)(100 - span * (b->level_ns - soft) / (cap - soft));
+}
+
+int64_t rumble_budget_next_change_ns(const rumble_budget_t *b)
+{
+    if (!budget_enabled(b)) {
+        return -1;
+    }
+    int64_t cap = capacity_ns(b);
+    int64_t soft = cap * RUMBLE_BUDGET_SOFT_PERCENT / 100;
+    int64_t target = (b->level_ns < soft) ? soft : cap;
+    if (b->level_ns >= cap) {
+        return -1;
+    }
+    // Net fill rate while on: 1 - on/window.
+    int64_t net_num = (int64_t)b->cfg.window_ms - (int64_t)b->cfg.on_ms;
+    return (target - b->level_ns) * (int64_t)b->cfg.window_ms / net_num + 1;
+}
+
+size_t rumble_budget_format(const rumble_budget_t *b, char *buf, size_t len)
+{
+    int n = snprintf(buf, len,
+                     "budget=%s level=%" PRId64 "ms capacity=%" PRIu32 "ms window=%" PRIu32
+                     "ms scale=%u%% on_total=%" PRIu64 "ms throttled=%" PRIu32
+                     " capped=%" PRIu32 " cutoffs=%" PRIu32,
+                     budget_enabled(b) ? "on" : "off",
+                     (int64_t)(b->level_ns / 1000000),
+                     b->cfg.on_ms,
+                     b->cfg.window_ms,
+                     (unsigned int)rumble_budget_scale(b),
+                     (uint64_t)(b->total_on_ns / 1000000u),
+                     b->throttled_plays,
+                     b->capped_plays,
+                     b->cutoffs);
+    if (n < 0) return 0;
+    return ((size_t)n < len) ? (size_t)n : len - 1;
+}
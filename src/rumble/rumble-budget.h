@@ -0,0 +1,98 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Default budget: 30 s of full-power on-time per rolling 60 s window.
+ */
+#define RUMBLE_BUDGET_DEFAULT_WINDOW_MS 60000
+#define RUMBLE_BUDGET_DEFAULT_ON_MS 30000
+#define RUMBLE_BUDGET_DEFAULT_MIN_DUTY 20
+
+/**
+ * Throttling starts once the bucket is this full (percent of capacity).
+ */
+#define RUMBLE_BUDGET_SOFT_PERCENT 75
+
+/**
+ * Limiter parameters (loaded from rumble.config).
+ */
+typedef struct {
+    uint32_t window_ms;    // Rolling window the on-time budget refers to.
+    uint32_t on_ms;        // Allowed full-power on-time per window; 0 disables the limiter.
+    uint8_t min_duty;      // Duty floor (percent) just before the bucket is full.
+    uint32_t max_pulse_ms; // Cap on a single effect's duration; 0 for no cap.
+} rumble_budget_cfg_t;
+
+/**
+ * Leaky-bucket integral of motor on-time.
+ *
+ * The bucket fills at 1 ns/ns while the motor is on and drains at
+ * on_ms/window_ms, so sustained use settles at the configured average.
+ * Capacity is on_ms: a cold motor may run that long before any throttling.
+ */
+typedef struct {
+    rumble_budget_cfg_t cfg;
+    int64_t level_ns;
+    int64_t last_ns;
+    bool motor_on;
+    uint64_t total_on_ns;
+    uint32_t throttled_plays;
+    uint32_t capped_plays;
+    uint32_t cutoffs;
+} rumble_budget_t;
+
+/**
+ * Reset a config to the defaults above.
+ *
+ * @param cfg Config to populate.
+ */
+void rumble_budget_defaults(rumble_budget_cfg_t *cfg);
+
+/**
+ * Start an empty bucket.
+ *
+ * @param b      Bucket to initialize.
+ * @param cfg    Limiter parameters.
+ * @param now_ns Current monotonic time.
+ */
+void rumble_budget_init(rumble_budget_t *b, const rumble_budget_cfg_t *cfg, int64_t now_ns);
+
+/**
+ * Integrate up to now with the previous motor state, then record the new one.
+ *
+ * @param b        Bucket to update.
+ * @param now_ns   Current monotonic time.
+ * @param motor_on Motor state from now on.
+ */
+void rumble_budget_update(rumble_budget_t *b, int64_t now_ns, bool motor_on);
+
+/**
+ * @param b Bucket to query.
+ * @return Duty scale in percent: 100 below the soft threshold, ramping down to
+ *         min_duty, and 0 once the bucket is full.
+ */
+uint8_t rumble_budget_scale(const rumble_budget_t *b);
+
+/**
+ * Time until the scale changes if the motor stays on (soft threshold or full).
+ *
+ * @param b Bucket to query (as of its last update).
+ * @return Nanoseconds, or -1 if the limiter is disabled or the bucket cannot fill.
+ */
+int64_t rumble_budget_next_change_ns(const rumble_budget_t *b);
+
+/**
+ * Render the bucket state as a single "key=value ..." line.
+ *
+ * @param b   Bucket to describe.
+ * @param buf Destination buffer.
+ * @param len Buffer size.
+ * @return Characters written (excluding the terminator).
+ */
+size_t rumble_budget_format(const rumble_budget_t *b, char *buf, size_t len);
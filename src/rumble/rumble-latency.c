@@ -0,0 +1,95 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Per-stage timing of rumble requests from the EV_FF event to the GPIO edge.
+
+#include "rumble-latency.h"
+
+#include <stdint.h>
+
+#include "../clock/clock.h"
+#include "../stats/histogram.h"
+
+static const char *const stage_names[RUMBLE_STAGE_COUNT] = {
+    "queue", "dispatch", "decide", "gpio", "total", "stop-late"
+};
+
+static struct {
+    bool enabled;
+    bool open;
+    uint64_t queue_ns;
+    uint64_t start_ns;
+    uint64_t last_ns;
+    histogram_t stages[RUMBLE_STAGE_COUNT];
+} lat;
+
+void rumble_latency_enable(bool enable)
+{
+    lat.enabled = enable;
+    lat.open = false;
+    for (int i = 0; i < RUMBLE_STAGE_COUNT; ++i) {
+        histogram_reset(&lat.stages[i]);
+    }
+}
+
+bool rumble_latency_enabled(void)
+{
+    return lat.enabled;
+}
+
+void rumble_latency_begin(const struct timeval *event_time, int64_t dequeued_ns)
+{
+    if (!lat.enabled) return;
+
+    uint64_t now = (uint64_t)clock_now_ns();
+    lat.start_ns = (dequeued_ns > 0 && (uint64_t)dequeued_ns <= now) ? (uint64_t)dequeued_ns : now;
+    lat.last_ns = lat.start_ns;
+    lat.queue_ns = 0;
+
+    // uinput stamps events with CLOCK_REALTIME; compare against the same clock.
+    if (event_time && (event_time->tv_sec || event_time->tv_usec)) {
+        struct timeval rt;
+        clock_realtime(&rt);
+        // Wind the realtime clock back to the dequeue so QUEUE and DISPATCH do not overlap.
+        int64_t now_ns = (int64_t)rt.tv_sec * 1000000000ll + (int64_t)rt.tv_usec * 1000ll -
+                         (int64_t)(now - lat.start_ns);
+        int64_t ev_ns = (int64_t)event_time->tv_sec * 1000000000ll +
+                        (int64_t)event_time->tv_usec * 1000ll;
+        if (now_ns > ev_ns) {
+            lat.queue_ns = (uint64_t)(now_ns - ev_ns);
+        }
+        histogram_add(&lat.stages[RUMBLE_STAGE_QUEUE], lat.queue_ns);
+    }
+    lat.open = true;
+}
+
+void rumble_latency_mark(rumble_stage_t stage)
+{
+    if (!lat.enabled || !lat.open || stage >= RUMBLE_STAGE_COUNT) return;
+
+    uint64_t now = (uint64_t)clock_now_ns();
+    histogram_add(&lat.stages[stage], now - lat.last_ns);
+    lat.last_ns = now;
+}
+
+void rumble_latency_end(void)
+{
+    if (!lat.enabled || !lat.open) return;
+
+    histogram_add(&lat.stages[RUMBLE_STAGE_TOTAL], lat.queue_ns + ((uint64_t)clock_now_ns() - lat.start_ns));
+    lat.open = false;
+}
+
+void rumble_latency_stop_sample(long long late_ns)
+{
+    if (!lat.enabled) return;
+    histogram_add(&lat.stages[RUMBLE_STAGE_STOP], late_ns > 0 ? (uint64_t)late_ns : 0);
+}
+
+void rumble_latency_report(FILE *out)
+{
+    fprintf(out, "Rumble latency:\n");
+    for (int i = 0; i < RUMBLE_STAGE_COUNT; ++i) {
+        histogram_print(&lat.stages[i], stage_names[i], out);
+    }
+}
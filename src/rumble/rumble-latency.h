@@ -0,0 +1,75 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+/**
+ * Stages of the EV_FF -> GPIO path, in the order they are crossed.
+ *
+ * QUEUE:    kernel stamp of the EV_FF event -> read() in process_uinput_events() returning.
+ * DISPATCH: read() returning -> entry of rumble_play_effect() (decode, trace record).
+ * DECIDE:   effect lookup/gain/stop-time math -> call into gpio_set_rumble().
+ * GPIO:     gpio_set_rumble() including the sysfs open/write/close.
+ * TOTAL:    kernel stamp -> GPIO write returned.
+ * STOP:     lateness of the motor-off edge relative to stop_time.
+ */
+typedef enum {
+    RUMBLE_STAGE_QUEUE = 0,
+    RUMBLE_STAGE_DISPATCH,
+    RUMBLE_STAGE_DECIDE,
+    RUMBLE_STAGE_GPIO,
+    RUMBLE_STAGE_TOTAL,
+    RUMBLE_STAGE_STOP,
+    RUMBLE_STAGE_COUNT
+} rumble_stage_t;
+
+/**
+ * Turn instrumentation on or off (off by default; marks are no-ops when off).
+ *
+ * @param enable true to start collecting samples.
+ */
+void rumble_latency_enable(bool enable);
+
+/**
+ * @return true when instrumentation is collecting samples.
+ */
+bool rumble_latency_enabled(void);
+
+/**
+ * Open a measurement for an EV_FF play event read from uinput.
+ *
+ * @param event_time  Timestamp the kernel attached to the event (CLOCK_REALTIME), or NULL.
+ * @param dequeued_ns clock_now_ns() taken when read() returned the event; 0 for "now".
+ */
+void rumble_latency_begin(const struct timeval *event_time, int64_t dequeued_ns);
+
+/**
+ * Close the stage that ends now; ignored if no measurement is open.
+ *
+ * @param stage DISPATCH, DECIDE or GPIO.
+ */
+void rumble_latency_mark(rumble_stage_t stage);
+
+/**
+ * Finish the open measurement and record the TOTAL stage.
+ */
+void rumble_latency_end(void);
+
+/**
+ * Record how late the motor was switched off.
+ *
+ * @param late_ns Nanoseconds between stop_time and the GPIO write returning.
+ */
+void rumble_latency_stop_sample(long long late_ns);
+
+/**
+ * Dump one histogram row per stage.
+ *
+ * @param out Destination stream.
+ */
+void rumble_latency_report(FILE *out);
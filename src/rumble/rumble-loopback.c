@@ -0,0 +1,152 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Loopback self-test: drives the rumble path into a mock GPIO tree and times the edges.
+
+#include "rumble-loopback.h"
+
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../clock/clock.h"
+#include "../gpio/gpio.h"
+#include "../stats/histogram.h"
+#include "rumble.h"
+#include "rumble-latency.h"
+
+#define LOOPBACK_TRIALS 5
+#define LOOPBACK_TOLERANCE_NS (2 * 1000000LL)
+#define LOOPBACK_TIMEOUT_MS 2000
+
+static void wait_rumble_timer(rumble_state_t *state)
+{
+    int fd = rumble_timer_fd(state);
+    if (fd < 0) {
+        poll(NULL, 0, 1);
+        return;
+    }
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    poll(&pfd, 1, 100);
+}
+
+static bool run_trial(rumble_state_t *state, int effect_id, unsigned int length_ms,
+                      histogram_t *start_hist, histogram_t *stop_hist)
+{
+    unsigned int expected_ms = length_ms;
+    if (expected_ms < state->shape.min_pulse_ms) {
+        expected_ms = state->shape.min_pulse_ms;
+    }
+
+    int64_t t_play = clock_now_ns();
+    rumble_latency_begin(NULL, 0);
+    rumble_play_effect(state, effect_id, 1);
+    rumble_latency_end();
+
+    int64_t t_rise = -1;
+    int64_t t_fall = -1;
+    int64_t deadline = t_play + (int64_t)LOOPBACK_TIMEOUT_MS * 1000000LL;
+    while (t_fall < 0 && clock_now_ns() < deadline) {
+        int value = gpio_read_value(GPIO_RUMBLE);
+        int64_t now = clock_now_ns();
+        if (value == 1 && t_rise < 0) {
+            t_rise = now;
+        } else if (value == 0 && t_rise >= 0) {
+            t_fall = now;
+            break;
+        }
+        wait_rumble_timer(state);
+        rumble_tick(state);
+    }
+
+    if (t_rise < 0 || t_fall < 0) {
+        fprintf(stderr, "  %4u ms: no %s edge observed\n", length_ms, t_rise < 0 ? "rising" : "falling");
+        return false;
+    }
+
+    int64_t start_delay = t_rise - t_play;
+    int64_t stop_error = (t_fall - t_rise) - (int64_t)expected_ms * 1000000LL;
+    histogram_add(start_hist, (uint64_t)start_delay);
+    histogram_add(stop_hist, (uint64_t)(stop_error < 0 ? -stop_error : stop_error));
+
+    bool ok = start_delay <= LOOPBACK_TOLERANCE_NS &&
+              stop_error <= LOOPBACK_TOLERANCE_NS &&
+              stop_error >= -LOOPBACK_TOLERANCE_NS;
+    if (!ok) {
+        fprintf(stderr, "  %4u ms: start %+.3f ms, on-time error %+.3f ms\n",
+                length_ms, start_delay / 1e6, stop_error / 1e6);
+    }
+    return ok;
+}
+
+int rumble_loopback_run(const char *mock_root)
+{
+    static const unsigned int lengths_ms[] = { 5, 10, 20, 40, 80, 160, 320 };
+    char tmp_root[] = "/tmp/tsp-gpio-XXXXXX";
+
+    if (!mock_root) {
+        if (!mkdtemp(tmp_root)) {
+            perror("mkdtemp");
+            return 1;
+        }
+        mock_root = tmp_root;
+    }
+    if (gpio_mock_create_line(mock_root, GPIO_RUMBLE, "out", 0) != 0) {
+        perror("mock gpio tree");
+        if (mock_root == tmp_root) {
+            gpio_mock_remove_tree(tmp_root);
+        }
+        return 1;
+    }
+    gpio_set_sysfs_root(mock_root);
+    fprintf(stderr, "Rumble loopback against %s\n", mock_root);
+
+    // On/off drive only: PWM or braking would add edges the loopback does not model.
+    rumble_state_t state;
+    rumble_state_init(&state);
+    state.shape.pwm_period_ms = 0;
+    state.shape.brake_gpio = -1;
+    rumble_latency_enable(true);
+
+    histogram_t start_hist;
+    histogram_t stop_hist;
+    histogram_reset(&start_hist);
+    histogram_reset(&stop_hist);
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof lengths_ms / sizeof lengths_ms[0]; ++i) {
+        struct ff_effect effect;
+        memset(&effect, 0, sizeof effect);
+        effect.type = FF_RUMBLE;
+        effect.id = -1;
+        effect.replay.length = (uint16_t)lengths_ms[i];
+        effect.u.rumble.strong_magnitude = 0xFFFF;
+        if (rumble_upload_effect(&state, &effect) != 0) {
+            fprintf(stderr, "  upload failed for %u ms\n", lengths_ms[i]);
+            ++failures;
+            continue;
+        }
+        for (int t = 0; t < LOOPBACK_TRIALS; ++t) {
+            if (!run_trial(&state, effect.id, lengths_ms[i], &start_hist, &stop_hist)) {
+                ++failures;
+            }
+        }
+        rumble_erase_effect(&state, effect.id);
+    }
+
+    histogram_print(&start_hist, "start-delay", stderr);
+    histogram_print(&stop_hist, "on-error", stderr);
+    rumble_latency_report(stderr);
+    rumble_state_destroy(&state);
+    gpio_set_sysfs_root(NULL);
+    if (mock_root == tmp_root) {
+        gpio_mock_remove_tree(tmp_root);
+    }
+
+    fprintf(stderr, "Rumble loopback: %s (%d failing trials)\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
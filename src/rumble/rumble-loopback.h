@@ -0,0 +1,13 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+/**
+ * Play a sweep of FF_RUMBLE effects against a mock sysfs GPIO tree and check that
+ * the motor line rises on play and falls replay.length (or the minimum pulse width) later.
+ *
+ * @param mock_root Directory to build the mock tree in; NULL creates one under /tmp.
+ * @return 0 if every edge landed within tolerance, 1 otherwise.
+ */
+int rumble_loopback_run(const char *mock_root);
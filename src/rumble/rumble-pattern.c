@@ -0,0 +1,118 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Named haptic patterns compiled once from haptics.config for cheap UI feedback.
+
+#include "rumble-pattern.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct {
+    const char *name;
+    const char *def;
+} builtin_patterns[] = {
+    { "click", "30" },
+    { "double", "30,60,30" },
+    { "notify", "80@60,60,80@60" },
+    { "error", "150" },
+};
+
+static bool compile_pattern(const char *def, rumble_pattern_t *out)
+{
+    const char *p = def;
+    uint8_t count = 0;
+
+    while (*p) {
+        if (count >= RUMBLE_PATTERN_MAX_STEPS) {
+            return false;
+        }
+
+        char *end = NULL;
+        unsigned long ms = strtoul(p, &end, 10);
+        if (end == p || ms == 0 || ms > 10000) {
+            return false;
+        }
+        bool on = (count % 2) == 0;
+        unsigned long duty = on ? 100 : 0;
+        p = end;
+
+        if (*p == '@') {
+            if (!on) {
+                return false;
+            }
+            ++p;
+            duty = strtoul(p, &end, 10);
+            if (end == p || duty == 0 || duty > 100) {
+                return false;
+            }
+            p = end;
+        }
+
+        out->steps[count].ms = (uint16_t)ms;
+        out->steps[count].duty = (uint8_t)duty;
+        ++count;
+
+        if (*p == ',') {
+            ++p;
+            if (*p == '\0') {
+                return false;
+            }
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+
+    out->step_count = count;
+    return count > 0;
+}
+
+void rumble_pattern_lib_init(rumble_pattern_lib_t *lib)
+{
+    memset(lib, 0, sizeof *lib);
+    for (size_t i = 0; i < sizeof builtin_patterns / sizeof builtin_patterns[0]; ++i) {
+        rumble_pattern_define(lib, builtin_patterns[i].name, builtin_patterns[i].def);
+    }
+}
+
+bool rumble_pattern_define(rumble_pattern_lib_t *lib, const char *name, const char *def)
+{
+    if (!name || !*name || strlen(name) >= RUMBLE_PATTERN_NAME_LEN || !def) {
+        return false;
+    }
+
+    rumble_pattern_t compiled;
+    memset(&compiled, 0, sizeof compiled);
+    if (!compile_pattern(def, &compiled)) {
+        fprintf(stderr, "Invalid haptic pattern '%s=%s'\n", name, def);
+        return false;
+    }
+    snprintf(compiled.name, sizeof compiled.name, "%s", name);
+
+    rumble_pattern_t *slot = (rumble_pattern_t *)rumble_pattern_find(lib, name);
+    if (!slot) {
+        if (lib->count >= RUMBLE_PATTERN_MAX) {
+            fprintf(stderr, "Haptic pattern table full, dropping '%s'\n", name);
+            return false;
+        }
+        slot = &lib->patterns[lib->count++];
+    }
+    *slot = compiled;
+    return true;
+}
+
+bool rumble_pattern_parse(void *ctx, const char *key, const char *value)
+{
+    return rumble_pattern_define((rumble_pattern_lib_t *)ctx, key, value);
+}
+
+const rumble_pattern_t *rumble_pattern_find(const rumble_pattern_lib_t *lib, const char *name)
+{
+    for (uint8_t i = 0; i < lib->count; ++i) {
+        if (strcmp(lib->patterns[i].name, name) == 0) {
+            return &lib->patterns[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,76 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RUMBLE_PATTERN_MAX 16
+#define RUMBLE_PATTERN_MAX_STEPS 16
+#define RUMBLE_PATTERN_NAME_LEN 24
+
+/**
+ * One step of a haptic pattern: hold the motor at duty for ms.
+ */
+typedef struct {
+    uint16_t ms;
+    uint8_t duty; // 0 = off, 100 = full power.
+} rumble_pattern_step_t;
+
+/**
+ * Precompiled haptic pattern.
+ */
+typedef struct {
+    char name[RUMBLE_PATTERN_NAME_LEN];
+    uint8_t step_count;
+    rumble_pattern_step_t steps[RUMBLE_PATTERN_MAX_STEPS];
+} rumble_pattern_t;
+
+/**
+ * Named pattern library (haptics.config plus built-in defaults).
+ */
+typedef struct {
+    rumble_pattern_t patterns[RUMBLE_PATTERN_MAX];
+    uint8_t count;
+} rumble_pattern_lib_t;
+
+/**
+ * Reset the library to the built-in patterns (click, double, notify, error).
+ *
+ * @param lib Library to initialize.
+ */
+void rumble_pattern_lib_init(rumble_pattern_lib_t *lib);
+
+/**
+ * Compile a pattern definition into a library entry, replacing any entry with the
+ * same name.
+ *
+ * Definitions alternate on/off durations in milliseconds, starting with "on";
+ * an on step may carry a duty cycle: "notify=80@60,60,80@60".
+ *
+ * @param lib  Library to update.
+ * @param name Pattern name.
+ * @param def  Pattern definition.
+ * @return true if the definition was valid and stored.
+ */
+bool rumble_pattern_define(rumble_pattern_lib_t *lib, const char *name, const char *def);
+
+/**
+ * config_kv_handler_t wrapper around rumble_pattern_define() for haptics.config.
+ *
+ * @param ctx   rumble_pattern_lib_t to update.
+ * @param key   Pattern name.
+ * @param value Pattern definition.
+ * @return true if the pattern was stored.
+ */
+bool rumble_pattern_parse(void *ctx, const char *key, const char *value);
+
+/**
+ * Look a pattern up by name.
+ *
+ * @param lib  Library to search.
+ * @param name Pattern name.
+ * @return Pattern, or NULL if unknown.
+ */
+const rumble_pattern_t *rumble_pattern_find(const rumble_pattern_lib_t *lib, const char *name);
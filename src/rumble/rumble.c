@@ -10,23 +10,29 @@
 #include <string.h>
 #include <time.h>
 
+#include "../clock/clock.h"
+#include "../config/config.h"
 #include "../gpio/gpio.h"
+#include "rumble-latency.h"
 
-static void timespec_now(struct timespec *ts)
-{
-    clock_gettime(CLOCK_MONOTONIC, ts);
-}
+#define BRAKE_DEFAULT_PERIOD_MS 10
+#define BUDGET_PWM_PERIOD_MS 20         // Software PWM period when the board drives on/off.
 
-static void timespec_add_ms(struct timespec *ts, unsigned int ms)
+static void timespec_add_ns(struct timespec *ts, long long ns)
 {
-    ts->tv_sec += ms / 1000;
-    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    ts->tv_sec += (time_t)(ns / 1000000000LL);
+    ts->tv_nsec += (long)(ns % 1000000000LL);
     if (ts->tv_nsec >= 1000000000L) {
         ts->tv_sec += 1;
         ts->tv_nsec -= 1000000000L;
     }
 }
 
+static void timespec_add_ms(struct timespec *ts, unsigned int ms)
+{
+    timespec_add_ns(ts, (long long)ms * 1000000LL);
+}
+
 static bool timespec_after(const struct timespec *a, const struct timespec *b)
 {
     if (a->tv_sec > b->tv_sec) return true;
@@ -34,10 +40,441 @@ static bool timespec_after(const struct timespec *a, const struct timespec *b)
     return a->tv_nsec >= b->tv_nsec;
 }
 
+static long long timespec_diff_ns(const struct timespec *a, const struct timespec *b)
+{
+    return (long long)(a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+void rumble_config_defaults(rumble_config_t *cfg)
+{
+    rumble_shape_t *shape = &cfg->shape;
+    memset(cfg, 0, sizeof *cfg);
+    shape->kick_ms = RUMBLE_DEFAULT_KICK_MS;
+    shape->min_pulse_ms = RUMBLE_DEFAULT_MIN_PULSE_MS;
+    shape->brake_duty = 100;
+    shape->brake_gpio = -1;
+    rumble_budget_defaults(&cfg->budget);
+}
+
+static bool parse_budget_key(rumble_budget_cfg_t *budget, const char *key, const char *value)
+{
+    unsigned long val;
+
+    if (strcmp(key, "budget_min_duty") == 0) {
+        if (!config_parse_uint(value, 100, &val)) return false;
+        budget->min_duty = (uint8_t)val;
+        return true;
+    }
+    if (!config_parse_uint(value, 24UL * 3600UL * 1000UL, &val)) {
+        return false;
+    }
+    if (strcmp(key, "budget_window_ms") == 0) {
+        budget->window_ms = (uint32_t)val;
+        return true;
+    }
+    if (strcmp(key, "budget_on_ms") == 0) {
+        budget->on_ms = (uint32_t)val;
+        return true;
+    }
+    if (strcmp(key, "budget_max_pulse_ms") == 0) {
+        budget->max_pulse_ms = (uint32_t)val;
+        return true;
+    }
+    return false;
+}
+
+bool rumble_config_parse(void *ctx, const char *key, const char *value)
+{
+    rumble_config_t *cfg = ctx;
+    rumble_shape_t *shape = &cfg->shape;
+    unsigned long val;
+
+    if (strncmp(key, "budget_", 7) == 0) {
+        return parse_budget_key(&cfg->budget, key, value);
+    }
+
+    if (strcmp(key, "brake_gpio") == 0) {
+        if (strcmp(value, "-1") == 0 || strcmp(value, "none") == 0) {
+            shape->brake_gpio = -1;
+            return true;
+        }
+        if (!config_parse_uint(value, 1023, &val)) return false;
+        shape->brake_gpio = (int)val;
+        return true;
+    }
+    if (strcmp(key, "brake_duty") == 0) {
+        if (!config_parse_uint(value, 100, &val)) return false;
+        shape->brake_duty = (uint8_t)val;
+        return true;
+    }
+
+    if (!config_parse_uint(value, 10000, &val)) {
+        return false;
+    }
+    if (strcmp(key, "kick_ms") == 0) {
+        shape->kick_ms = (uint16_t)val;
+        return true;
+    }
+    if (strcmp(key, "min_pulse_ms") == 0) {
+        shape->min_pulse_ms = (uint16_t)val;
+        return true;
+    }
+    if (strcmp(key, "pwm_period_ms") == 0) {
+        shape->pwm_period_ms = (uint16_t)val;
+        return true;
+    }
+    if (strcmp(key, "brake_ms") == 0) {
+        shape->brake_ms = (uint16_t)val;
+        return true;
+    }
+    return false;
+}
+
+static void set_motor(struct rumble_state *state, bool on)
+{
+    if (state->motor_on != on) {
+        rumble_budget_update(&state->budget, clock_now_ns(), on);
+    }
+    state->motor_on = on;
+    gpio_set_rumble(on);
+}
+
+static void set_brake(struct rumble_state *state, bool on)
+{
+    if (state->shape.brake_gpio < 0 || state->brake_on == on) {
+        return;
+    }
+    state->brake_on = on;
+    gpio_set_line(state->shape.brake_gpio, on);
+}
+
+static bool brake_enabled(const struct rumble_state *state)
+{
+    return state->shape.brake_gpio >= 0 && state->shape.brake_ms > 0 && state->shape.brake_duty > 0;
+}
+
+static bool driving(const struct rumble_state *state)
+{
+    return state->phase == RUMBLE_PHASE_KICK || state->phase == RUMBLE_PHASE_SUSTAIN;
+}
+
+// Game effect and haptic pattern are mixed by taking the stronger of the two.
+static uint8_t base_duty(const struct rumble_state *state)
+{
+    uint8_t duty = state->rumble_active ? state->duty : 0;
+    if (state->pattern) {
+        uint8_t pattern_duty = state->pattern->steps[state->pattern_step].duty;
+        if (pattern_duty > duty) {
+            duty = pattern_duty;
+        }
+    }
+    return duty;
+}
+
+// Duty after the budget limiter has scaled the mixed magnitude.
+static uint8_t drive_duty(const struct rumble_state *state)
+{
+    uint8_t scale = rumble_budget_scale(&state->budget);
+    uint8_t base = base_duty(state);
+    if (scale == 0 || base == 0) {
+        return 0;
+    }
+    unsigned int duty = (unsigned int)base * scale / 100;
+    return (uint8_t)(duty ? duty : 1);
+}
+
+// True while a haptic pattern step, not the game effect, sets the magnitude.
+static bool pattern_drives(const struct rumble_state *state)
+{
+    if (!state->pattern) {
+        return false;
+    }
+    uint8_t game = state->rumble_active ? state->duty : 0;
+    return state->pattern->steps[state->pattern_step].duty > game;
+}
+
+// Throttling and pattern step duties need a duty cycle even on boards configured for
+// on/off drive; game effects alone keep the plain on/off behaviour there.
+static unsigned int pwm_period(const struct rumble_state *state)
+{
+    if (state->shape.pwm_period_ms) {
+        return state->shape.pwm_period_ms;
+    }
+    return (rumble_budget_scale(&state->budget) < 100 || pattern_drives(state)) ? BUDGET_PWM_PERIOD_MS : 0;
+}
+
+static bool sustain_pwm(const struct rumble_state *state)
+{
+    return pwm_period(state) > 0 && drive_duty(state) < 100;
+}
+
+static long long pwm_slice_ns(unsigned int period_ms, unsigned int duty, bool on)
+{
+    long long period_ns = (long long)period_ms * 1000000LL;
+    long long on_ns = period_ns * duty / 100;
+    return on ? on_ns : period_ns - on_ns;
+}
+
+static void deadline_min(struct timespec *deadline, bool *armed, const struct timespec *candidate)
+{
+    if (!*armed || timespec_after(deadline, candidate)) {
+        *deadline = *candidate;
+        *armed = true;
+    }
+}
+
+static void rearm_timer(struct rumble_state *state)
+{
+    struct timespec deadline;
+    bool armed = false;
+
+    if (state->rumble_active) {
+        deadline_min(&deadline, &armed, &state->stop_time);
+    }
+    if (state->pattern) {
+        deadline_min(&deadline, &armed, &state->pattern_step_end);
+    }
+    if (state->budget_paused) {
+        deadline_min(&deadline, &armed, &state->budget_resume);
+    }
+
+    switch (state->phase) {
+    case RUMBLE_PHASE_KICK:
+        deadline_min(&deadline, &armed, &state->phase_end);
+        break;
+    case RUMBLE_PHASE_SUSTAIN:
+        if (state->pwm_running) {
+            deadline_min(&deadline, &armed, &state->next_toggle);
+        }
+        if (state->motor_on) {
+            int64_t change_ns = rumble_budget_next_change_ns(&state->budget);
+            if (change_ns >= 0) {
+                struct timespec budget_at = {
+                    .tv_sec = (time_t)(state->budget.last_ns / 1000000000LL),
+                    .tv_nsec = (long)(state->budget.last_ns % 1000000000LL)
+                };
+                timespec_add_ns(&budget_at, change_ns);
+                deadline_min(&deadline, &armed, &budget_at);
+            }
+        }
+        break;
+    case RUMBLE_PHASE_BRAKE:
+        deadline_min(&deadline, &armed, &state->phase_end);
+        if (state->shape.brake_duty < 100) {
+            deadline_min(&deadline, &armed, &state->next_toggle);
+        }
+        break;
+    case RUMBLE_PHASE_IDLE:
+    default:
+        break;
+    }
+
+    if (armed) {
+        clock_timer_arm(&state->timer, &deadline);
+    } else {
+        clock_timer_disarm(&state->timer);
+    }
+}
+
+static void enter_brake(struct rumble_state *state, const struct timespec *now)
+{
+    if (!brake_enabled(state)) {
+        state->phase = RUMBLE_PHASE_IDLE;
+        return;
+    }
+    state->phase = RUMBLE_PHASE_BRAKE;
+    state->phase_end = *now;
+    timespec_add_ms(&state->phase_end, state->shape.brake_ms);
+    set_brake(state, true);
+    if (state->shape.brake_duty < 100) {
+        unsigned int period = state->shape.pwm_period_ms ? state->shape.pwm_period_ms : BRAKE_DEFAULT_PERIOD_MS;
+        state->next_toggle = *now;
+        timespec_add_ns(&state->next_toggle, pwm_slice_ns(period, state->shape.brake_duty, true));
+    }
+}
+
+static void enter_sustain(struct rumble_state *state, const struct timespec *at)
+{
+    state->phase = RUMBLE_PHASE_SUSTAIN;
+    state->pwm_running = sustain_pwm(state);
+    set_motor(state, true);
+    if (state->pwm_running) {
+        state->next_toggle = *at;
+        timespec_add_ns(&state->next_toggle, pwm_slice_ns(pwm_period(state), drive_duty(state), true));
+    }
+}
+
+static void start_drive(struct rumble_state *state, const struct timespec *now)
+{
+    set_brake(state, false);
+    state->start_time = *now;
+    if (state->shape.kick_ms > 0 && sustain_pwm(state) && rumble_budget_scale(&state->budget) == 100) {
+        state->phase = RUMBLE_PHASE_KICK;
+        state->phase_end = *now;
+        timespec_add_ms(&state->phase_end, state->shape.kick_ms);
+        state->pwm_running = false;
+        set_motor(state, true);
+    } else {
+        enter_sustain(state, now);
+    }
+}
+
+static void motor_off(struct rumble_state *state, const struct timespec *now)
+{
+    set_motor(state, false);
+    state->pwm_running = false;
+    enter_brake(state, now);
+}
+
+// Retire a finished game effect and advance the haptic pattern.
+static void update_sources(struct rumble_state *state, const struct timespec *now)
+{
+    if (state->rumble_active && timespec_after(now, &state->stop_time)) {
+        state->rumble_active = false;
+    }
+    while (state->pattern && timespec_after(now, &state->pattern_step_end)) {
+        if (++state->pattern_step >= state->pattern->step_count) {
+            state->pattern = NULL;
+            break;
+        }
+        timespec_add_ms(&state->pattern_step_end, state->pattern->steps[state->pattern_step].ms);
+    }
+}
+
+// Reconcile the drive phase with the mixed, budget-scaled duty.
+static void apply_drive(struct rumble_state *state, const struct timespec *now)
+{
+    uint8_t duty = drive_duty(state);
+
+    if (duty == 0) {
+        bool wanted = base_duty(state) > 0;
+        if (driving(state)) {
+            if (wanted) {
+                state->budget.cutoffs++;
+            }
+            motor_off(state, now);
+        }
+        // Over budget but still requested: re-check once the bucket has drained a bit.
+        state->budget_paused = wanted;
+        if (wanted) {
+            state->budget_resume = *now;
+            timespec_add_ms(&state->budget_resume, BUDGET_PWM_PERIOD_MS);
+        }
+        return;
+    }
+
+    state->budget_paused = false;
+    if (!driving(state)) {
+        start_drive(state, now);
+    } else if (state->phase == RUMBLE_PHASE_SUSTAIN && sustain_pwm(state) != state->pwm_running) {
+        // Magnitude changed or the budget crossed its soft threshold mid-effect.
+        enter_sustain(state, now);
+    }
+}
+
+static void advance_phases(struct rumble_state *state, const struct timespec *now)
+{
+    for (;;) {
+        switch (state->phase) {
+        case RUMBLE_PHASE_KICK:
+            if (!timespec_after(now, &state->phase_end)) {
+                return;
+            }
+            enter_sustain(state, &state->phase_end);
+            break;
+
+        case RUMBLE_PHASE_SUSTAIN:
+            if (!state->pwm_running || !timespec_after(now, &state->next_toggle)) {
+                return;
+            }
+            set_motor(state, !state->motor_on);
+            timespec_add_ns(&state->next_toggle,
+                            pwm_slice_ns(pwm_period(state), drive_duty(state), state->motor_on));
+            break;
+
+        case RUMBLE_PHASE_BRAKE:
+            if (timespec_after(now, &state->phase_end)) {
+                set_brake(state, false);
+                state->phase = RUMBLE_PHASE_IDLE;
+                return;
+            }
+            if (state->shape.brake_duty >= 100 || !timespec_after(now, &state->next_toggle)) {
+                return;
+            }
+            set_brake(state, !state->brake_on);
+            timespec_add_ns(&state->next_toggle,
+                            pwm_slice_ns(state->shape.pwm_period_ms ? state->shape.pwm_period_ms
+                                                                    : BRAKE_DEFAULT_PERIOD_MS,
+                                         state->shape.brake_duty, state->brake_on));
+            break;
+
+        case RUMBLE_PHASE_IDLE:
+        default:
+            return;
+        }
+    }
+}
+
+static void service(struct rumble_state *state, const struct timespec *now)
+{
+    bool game_was_active = state->rumble_active;
+
+    update_sources(state, now);
+    rumble_budget_update(&state->budget, clock_timespec_to_ns(now), state->motor_on);
+    apply_drive(state, now);
+    advance_phases(state, now);
+
+    if (game_was_active && !state->rumble_active && !state->motor_on && rumble_latency_enabled()) {
+        struct timespec done;
+        clock_now(&done);
+        rumble_latency_stop_sample(timespec_diff_ns(&done, &state->stop_time));
+    }
+    rearm_timer(state);
+}
+
 void rumble_state_init(rumble_state_t *state)
 {
+    rumble_config_t cfg;
+    rumble_config_defaults(&cfg);
+
     memset(state, 0, sizeof *state);
     state->gain = 0xFFFF;
+    state->shape = cfg.shape;
+    rumble_budget_init(&state->budget, &cfg.budget, clock_now_ns());
+    clock_timer_init(&state->timer);
+}
+
+void rumble_state_destroy(rumble_state_t *state)
+{
+    if (!state) return;
+    set_motor(state, false);
+    set_brake(state, false);
+    state->rumble_active = false;
+    state->pattern = NULL;
+    state->phase = RUMBLE_PHASE_IDLE;
+    clock_timer_close(&state->timer);
+}
+
+void rumble_configure(rumble_state_t *state, const rumble_config_t *cfg)
+{
+    if (!state || !cfg) return;
+    set_brake(state, false);
+    state->shape = cfg->shape;
+    rumble_budget_init(&state->budget, &cfg->budget, clock_now_ns());
+    if (state->shape.brake_gpio >= 0) {
+        gpio_setup_output(state->shape.brake_gpio, 0);
+        state->brake_on = false;
+    }
+}
+
+int rumble_timer_fd(const rumble_state_t *state)
+{
+    return state ? state->timer.fd : -1;
+}
+
+bool rumble_next_deadline(const rumble_state_t *state, struct timespec *deadline)
+{
+    return state && clock_timer_deadline(&state->timer, deadline);
 }
 
 static int allocate_slot(struct rumble_state *state)
@@ -83,6 +520,22 @@ int rumble_upload_effect(rumble_state_t *state, struct ff_effect *effect)
     return 0;
 }
 
+static void rumble_stop(struct rumble_state *state)
+{
+    if (!state->rumble_active) {
+        return;
+    }
+
+    // Honor the minimum pulse width: a stop that lands early only pulls stop_time in.
+    struct timespec now;
+    clock_now(&now);
+    struct timespec earliest = state->start_time;
+    timespec_add_ms(&earliest, state->shape.min_pulse_ms);
+    state->stop_time = timespec_after(&now, &earliest) ? now : earliest;
+
+    service(state, &now);
+}
+
 int rumble_erase_effect(rumble_state_t *state, int effect_id)
 {
     if (!state) {
@@ -95,24 +548,15 @@ int rumble_erase_effect(rumble_state_t *state, int effect_id)
     }
     state->slots[effect_id].in_use = false;
     if (state->rumble_active && state->slots[effect_id].effect.id == effect_id) {
-        gpio_set_rumble(false);
-        state->rumble_active = false;
+        rumble_stop(state);
     }
     return 0;
 }
 
-static void rumble_stop(struct rumble_state *state)
-{
-    if (!state->rumble_active) {
-        return;
-    }
-    state->rumble_active = false;
-    gpio_set_rumble(false);
-}
-
 void rumble_play_effect(rumble_state_t *state, int effect_id, int repeat)
 {
     if (!state) return;
+    rumble_latency_mark(RUMBLE_STAGE_DISPATCH);
     if (effect_id < 0 || effect_id >= RUMBLE_MAX_EFFECTS) {
         return;
     }
@@ -128,19 +572,50 @@ void rumble_play_effect(rumble_state_t *state, int effect_id, int repeat)
 
     mag = (uint32_t)mag * state->gain / 0xFFFF;
     if (mag == 0 || repeat == 0) {
+        rumble_latency_mark(RUMBLE_STAGE_DECIDE);
         rumble_stop(state);
+        rumble_latency_mark(RUMBLE_STAGE_GPIO);
         return;
     }
 
     unsigned int reps = (repeat > 0) ? (unsigned int)repeat : 1;
     unsigned int duration_ms = effect->replay.length * reps;
+    if (state->budget.cfg.max_pulse_ms && duration_ms > state->budget.cfg.max_pulse_ms) {
+        duration_ms = state->budget.cfg.max_pulse_ms;
+        state->budget.capped_plays++;
+    }
+    if (duration_ms < state->shape.min_pulse_ms) {
+        duration_ms = state->shape.min_pulse_ms;
+    }
+
     struct timespec now;
-    timespec_now(&now);
+    clock_now(&now);
     state->stop_time = now;
     timespec_add_ms(&state->stop_time, duration_ms);
-
-    gpio_set_rumble(true);
+    state->duty = (uint8_t)(((uint32_t)mag * 100 + 0xFFFE) / 0xFFFF);
     state->rumble_active = true;
+
+    rumble_budget_update(&state->budget, clock_timespec_to_ns(&now), state->motor_on);
+    if (rumble_budget_scale(&state->budget) < 100) {
+        state->budget.throttled_plays++;
+    }
+
+    rumble_latency_mark(RUMBLE_STAGE_DECIDE);
+    service(state, &now);
+    rumble_latency_mark(RUMBLE_STAGE_GPIO);
+}
+
+void rumble_play_pattern(rumble_state_t *state, const rumble_pattern_t *pattern)
+{
+    if (!state || !pattern || pattern->step_count == 0) return;
+
+    struct timespec now;
+    clock_now(&now);
+    state->pattern = pattern;
+    state->pattern_step = 0;
+    state->pattern_step_end = now;
+    timespec_add_ms(&state->pattern_step_end, pattern->steps[0].ms);
+    service(state, &now);
 }
 
 void rumble_apply_gain(rumble_state_t *state, uint16_t gain)
@@ -157,12 +632,20 @@ void rumble_apply_gain(rumble_state_t *state, uint16_t gain)
 
 void rumble_tick(rumble_state_t *state)
 {
-    if (!state || !state->rumble_active) {
+    if (!state) return;
+
+    clock_timer_consume(&state->timer);
+    if (state->phase == RUMBLE_PHASE_IDLE && !state->rumble_active && !state->pattern) {
         return;
     }
+
     struct timespec now;
-    timespec_now(&now);
-    if (timespec_after(&now, &state->stop_time)) {
-        rumble_stop(state);
-    }
+    clock_now(&now);
+    service(state, &now);
+}
+
+size_t rumble_budget_status(rumble_state_t *state, char *buf, size_t len)
+{
+    rumble_budget_update(&state->budget, clock_now_ns(), state->motor_on);
+    return rumble_budget_format(&state->budget, buf, len);
 }
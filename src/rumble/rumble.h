@@ -9,13 +9,53 @@
 
 #include <time.h>
 
+#include "../clock/clock.h"
+#include "rumble-budget.h"
+#include "rumble-pattern.h"
+
 #define RUMBLE_MAX_EFFECTS 8
 
+/**
+ * Default drive shaping for the Smart Pro ERM motor.
+ */
+#define RUMBLE_DEFAULT_KICK_MS 20
+#define RUMBLE_DEFAULT_MIN_PULSE_MS 30
+
 typedef struct {
     struct ff_effect effect;
     bool in_use;
 } rumble_slot_t;
 
+/**
+ * Per-board motor drive shaping parameters (loaded from rumble.config).
+ */
+typedef struct {
+    uint16_t kick_ms;       // Full-power onset before duty-cycled sustain (needs pwm_period_ms > 0).
+    uint16_t min_pulse_ms;  // Shortest on-time, even if the game stops earlier.
+    uint16_t pwm_period_ms; // Software PWM period for magnitude; 0 drives on/off.
+    uint16_t brake_ms;      // Braking window after the motor turns off.
+    uint8_t brake_duty;     // Brake line duty cycle in percent.
+    int brake_gpio;         // Line that shorts/brakes the motor; -1 if the board has none.
+} rumble_shape_t;
+
+/**
+ * Everything rumble.config can set.
+ */
+typedef struct {
+    rumble_shape_t shape;
+    rumble_budget_cfg_t budget;
+} rumble_config_t;
+
+/**
+ * Drive stage the motor is currently in.
+ */
+typedef enum {
+    RUMBLE_PHASE_IDLE = 0,
+    RUMBLE_PHASE_KICK,
+    RUMBLE_PHASE_SUSTAIN,
+    RUMBLE_PHASE_BRAKE
+} rumble_phase_t;
+
 /**
  * Tracks uploaded rumble effects and the currently playing one.
  */
@@ -24,15 +64,87 @@ typedef struct rumble_state {
     bool rumble_active;
     struct timespec stop_time;
     uint16_t gain;
+
+    rumble_shape_t shape;
+    rumble_phase_t phase;
+    uint8_t duty;                // Sustain duty cycle in percent.
+    bool motor_on;
+    bool brake_on;
+    struct timespec start_time;  // Motor-on edge of the current pulse.
+    struct timespec phase_end;   // End of the kick or brake window.
+    struct timespec next_toggle; // Next PWM edge (sustain or brake).
+    bool pwm_running;            // Sustain is toggling the motor line.
+    clock_timer_t timer;         // Armed at the next shaping deadline.
+
+    const rumble_pattern_t *pattern;  // Haptic pattern mixed with the game effect.
+    uint8_t pattern_step;
+    struct timespec pattern_step_end;
+
+    rumble_budget_t budget;
+    bool budget_paused;               // Requested but held off by the budget.
+    struct timespec budget_resume;
 } rumble_state_t;
 
 /**
- * Initialize a rumble_state instance with no uploaded effects and max gain.
+ * Initialize a rumble_state instance with no uploaded effects, max gain, the
+ * default drive shape and a rumble timer.
  *
  * @param state Rumble container to initialize.
  */
 void rumble_state_init(rumble_state_t *state);
 
+/**
+ * Stop the motor and release the rumble timer.
+ *
+ * @param state Rumble container to tear down.
+ */
+void rumble_state_destroy(rumble_state_t *state);
+
+/**
+ * Reset a config to the Smart Pro defaults.
+ *
+ * @param cfg Config to populate.
+ */
+void rumble_config_defaults(rumble_config_t *cfg);
+
+/**
+ * config_kv_handler_t for rumble.config keys: kick_ms, min_pulse_ms,
+ * pwm_period_ms, brake_ms, brake_duty, brake_gpio, budget_window_ms,
+ * budget_on_ms, budget_min_duty and budget_max_pulse_ms.
+ *
+ * @param ctx   rumble_config_t to update.
+ * @param key   Config key.
+ * @param value Config value.
+ * @return true if the key was recognized and valid.
+ */
+bool rumble_config_parse(void *ctx, const char *key, const char *value);
+
+/**
+ * Install drive shaping and budget parameters, configuring the brake line if set.
+ * Resets the budget bucket.
+ *
+ * @param state Rumble container to mutate.
+ * @param cfg   New parameters.
+ */
+void rumble_configure(rumble_state_t *state, const rumble_config_t *cfg);
+
+/**
+ * File descriptor that becomes readable when rumble_tick() must run.
+ *
+ * @param state Rumble container to query.
+ * @return timerfd, or -1 if unavailable (call rumble_tick() every loop instead).
+ */
+int rumble_timer_fd(const rumble_state_t *state);
+
+/**
+ * Next time rumble_tick() must run (used to drive virtual time).
+ *
+ * @param state    Rumble container to query.
+ * @param deadline Destination for the absolute monotonic deadline.
+ * @return true if a deadline is pending.
+ */
+bool rumble_next_deadline(const rumble_state_t *state, struct timespec *deadline);
+
 /**
  * Upload or replace an FF_RUMBLE effect in the local slot pool.
  *
@@ -60,6 +172,15 @@ int rumble_erase_effect(rumble_state_t *state, int effect_id);
  */
 void rumble_play_effect(rumble_state_t *state, int effect_id, int repeat);
 
+/**
+ * Start a haptic pattern, replacing any pattern already playing. Patterns are
+ * mixed with game effects (the stronger duty wins) and ignore the FF gain.
+ *
+ * @param state   Rumble container to mutate.
+ * @param pattern Precompiled pattern; must outlive playback.
+ */
+void rumble_play_pattern(rumble_state_t *state, const rumble_pattern_t *pattern);
+
 /**
  * Update the global rumble gain as provided by the host OS.
  *
@@ -69,8 +190,19 @@ void rumble_play_effect(rumble_state_t *state, int effect_id, int repeat);
 void rumble_apply_gain(rumble_state_t *state, uint16_t gain);
 
 /**
- * Periodic timer hook to turn the motor off when the requested duration expires.
+ * Timer hook: retires finished effects and pattern steps, advances kick/sustain/brake
+ * phases and PWM edges, then re-arms the rumble timer. Safe to call early or repeatedly.
  *
  * @param state Rumble container to service.
  */
 void rumble_tick(rumble_state_t *state);
+
+/**
+ * Bring the budget integral up to date and describe it.
+ *
+ * @param state Rumble container to query.
+ * @param buf   Destination buffer.
+ * @param len   Buffer size.
+ * @return Characters written.
+ */
+size_t rumble_budget_status(rumble_state_t *state, char *buf, size_t len);
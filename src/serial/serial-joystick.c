@@ -80,7 +80,7 @@ static inline uint16_t u16_from_be(uint8_t hi, uint8_t lo) {
     return (uint16_t)((hi << 8) | lo);
 }
 
-void parseRawData(const uint8_t *b, uint8_t rb, joypad_struct_t *j)
+static void parseRawData(const uint8_t *b, uint8_t rb, joypad_struct_t *j)
 {
     if (rb != 7) return;
 
@@ -90,24 +90,87 @@ void parseRawData(const uint8_t *b, uint8_t rb, joypad_struct_t *j)
     j->y          = u16_from_be(b[5], b[6]);
 }
 
-int readSerialJoypad(int fd, joypad_struct_t *j)
+void resetSerialParser(serial_parser_t *parser)
 {
-    static uint8_t frameBuf[7];
-    static size_t framePos = 0;
-    static int trackedFd = -1;
-    uint8_t tmp[32];
-    int parsed = 0;
+    parser->framePos = 0;
+}
 
-    if (fd < 0 || j == NULL) {
-        return -1;
+// A 12-bit ADC leaves the high nibble of X and Y clear; anything else means the
+// "header" was really payload (e.g. buttons=0xFF followed by X=0x01xx).
+static int frameLooksValid(const uint8_t *b)
+{
+    return (b[3] & 0xF0) == 0 && (b[5] & 0xF0) == 0;
+}
+
+// Header hunt for one byte; returns 1 if the byte was appended to the frame.
+static int huntByte(serial_parser_t *parser, uint8_t byte)
+{
+    if (parser->framePos == 0) {
+        if (byte != 0xFF) {
+            return 0;
+        }
+    } else if (parser->framePos == 1) {
+        if (byte != 0x01) {
+            // 0xFF 0xFF 0x01: the second 0xFF may be the real header start.
+            parser->framePos = (byte == 0xFF) ? 1 : 0;
+            return 0;
+        }
+    }
+    parser->frameBuf[parser->framePos++] = byte;
+    return 1;
+}
+
+size_t parseSerialFrames(serial_parser_t *parser, const uint8_t *data, size_t len,
+                         serial_frame_t *frames, size_t max)
+{
+    uint8_t *frameBuf = parser->frameBuf;
+    size_t count = 0;
+
+    for (size_t i = 0; i < len; ++i) {
+        huntByte(parser, data[i]);
+        if (parser->framePos < SERIAL_FRAME_LEN) {
+            continue;
+        }
+
+        parser->framePos = 0;
+        if (frameLooksValid(frameBuf)) {
+            serial_frame_t *out = &frames[count < max ? count++ : max - 1];
+            parseRawData(frameBuf, SERIAL_FRAME_LEN, &out->pad);
+            out->end = i + 1;
+            continue;
+        }
+
+        // Misaligned frame: rescan the bytes after the false header. Six bytes cannot
+        // complete a frame, so this never recurses and costs at most
+        // SERIAL_FRAME_LEN steps per input byte.
+        parser->rejectedFrames++;
+        uint8_t rescan[SERIAL_FRAME_LEN - 1];
+        memcpy(rescan, frameBuf + 1, sizeof rescan);
+        for (size_t k = 0; k < sizeof rescan; ++k) {
+            huntByte(parser, rescan[k]);
+        }
+    }
+
+    return count;
+}
+
+int parseSerialBytes(serial_parser_t *parser, const uint8_t *data, size_t len, joypad_struct_t *j)
+{
+    serial_frame_t last;
+    if (parseSerialFrames(parser, data, len, &last, 1) == 0) {
+        return 0;
     }
+    *j = last.pad;
+    return 1;
+}
 
-    if (trackedFd != fd) {
-        trackedFd = fd;
-        framePos = 0;
+int readSerialBytes(int fd, uint8_t *buf, size_t len)
+{
+    if (fd < 0 || buf == NULL) {
+        return -1;
     }
 
-    ssize_t r = read(fd, tmp, sizeof tmp);
+    ssize_t r = read(fd, buf, len);
     if (r < 0) {
         if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
             return 0;
@@ -115,37 +178,20 @@ int readSerialJoypad(int fd, joypad_struct_t *j)
         perror("read");
         return -1;
     }
-    if (r == 0) {
-        return 0;
-    }
-
-    for (ssize_t i = 0; i < r; ++i) {
-        uint8_t byte = tmp[i];
-
-        if (framePos == 0) {
-            if (byte != 0xFF) {
-                continue;
-            }
-        } else if (framePos == 1) {
-            if (byte != 0x01) {
-                if (byte == 0xFF) {
-                    frameBuf[0] = 0xFF;
-                    framePos = 1;
-                } else {
-                    framePos = 0;
-                }
-                continue;
-            }
-        }
+    return (int)r;
+}
 
-        frameBuf[framePos++] = byte;
+int readSerialJoypad(int fd, serial_parser_t *parser, joypad_struct_t *j)
+{
+    uint8_t tmp[32];
 
-        if (framePos == sizeof(frameBuf)) {
-            parseRawData(frameBuf, sizeof(frameBuf), j);
-            framePos = 0;
-            parsed = 1;
-        }
+    if (parser == NULL || j == NULL) {
+        return -1;
     }
 
-    return parsed;
+    int r = readSerialBytes(fd, tmp, sizeof tmp);
+    if (r <= 0) {
+        return r;
+    }
+    return parseSerialBytes(parser, tmp, (size_t)r, j);
 }
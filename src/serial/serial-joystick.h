@@ -3,8 +3,42 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #include "../common.h"
 
+/**
+ * Length of one pad frame on the wire (0xFF 0x01 header + buttons + X + Y).
+ */
+#define SERIAL_FRAME_LEN 7
+
+/**
+ * Time one byte spends on the wire at BAUD_RATE (8N1 = 10 bits at 19200 baud).
+ */
+#define SERIAL_BYTE_NS 520833
+
+/**
+ * Most frames one parse call can complete from len new bytes (plus a partial carried in).
+ */
+#define SERIAL_FRAMES_MAX(len) ((len) / SERIAL_FRAME_LEN + 1)
+
+/**
+ * Frame reassembly state; one per serial port.
+ */
+typedef struct {
+    uint8_t frameBuf[SERIAL_FRAME_LEN];
+    size_t framePos;
+    uint32_t rejectedFrames;  // Frames dropped as misaligned (X/Y outside the 12-bit ADC range).
+} serial_parser_t;
+
+/**
+ * One decoded frame and where it ended in the chunk it was parsed from.
+ */
+typedef struct {
+    joypad_struct_t pad;
+    size_t end;               // Offset just past the frame's last byte within the chunk.
+} serial_frame_t;
+
 /**
  * Opens the serial device for the *d* joypad
  *
@@ -23,10 +57,56 @@ int openSerialJoystick(const char *serialPort);
  */
 int closeSerialJoystick(int fd);
 
+/**
+ * Resets a parser so the next byte is treated as a potential header
+ *
+ * @param parser[in] the parser to reset
+ */
+void resetSerialParser(serial_parser_t *parser);
+
+/**
+ * Feeds raw bytes through the frame parser and hands over every frame they complete, in
+ * order. A completed frame whose X or Y does not fit the 12-bit ADC is treated as a false
+ * header and the buffered bytes are rescanned, so the cost per input byte stays bounded
+ * by SERIAL_FRAME_LEN steps.
+ *
+ * @param parser[in] reassembly state of the port the bytes came from
+ * @param data[in] received bytes
+ * @param len[in] number of bytes
+ * @param frames[out] completed frames; SERIAL_FRAMES_MAX(len) slots hold them all
+ * @param max[in] number of slots; once full, the last slot keeps the newest frame
+ * @return number of slots filled
+ */
+size_t parseSerialFrames(serial_parser_t *parser, const uint8_t *data, size_t len,
+                         serial_frame_t *frames, size_t max);
+
+/**
+ * Like parseSerialFrames(), keeping only the last complete frame
+ *
+ * @param parser[in] reassembly state of the port the bytes came from
+ * @param data[in] received bytes
+ * @param len[in] number of bytes
+ * @param j[out] joypad struct, updated with the last complete frame
+ * @return 1 if at least one frame completed, 0 otherwise
+ */
+int parseSerialBytes(serial_parser_t *parser, const uint8_t *data, size_t len, joypad_struct_t *j);
+
+/**
+ * Reads whatever bytes are pending on the port without parsing them
+ *
+ * @param fd[in] the handle of the device to read
+ * @param buf[out] destination buffer
+ * @param len[in] buffer size
+ * @return number of bytes read, 0 if none are pending, -1 on read error
+ */
+int readSerialBytes(int fd, uint8_t *buf, size_t len);
+
 /**
  * Reads Joypad raw data
  *
  * @param fd[in] the handle of the device to read
+ * @param parser[in] reassembly state for this device
  * @param j[in] joypad struct
+ * @return 1 if a frame was decoded, 0 if none yet, -1 on read error
  */
-int readSerialJoypad(int fd, joypad_struct_t *j);
+int readSerialJoypad(int fd, serial_parser_t *parser, joypad_struct_t *j);
@@ -0,0 +1,366 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Golden-trace regression check: event-stream diff plus a writes/frame gate and an opt-in
+// host-normalised timing gate.
+
+#include "check.h"
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../clock/clock.h"
+#include "../config/config.h"
+#include "../controller/controller.h"
+#include "../serial/serial-joystick.h"
+
+#define CHECK_MAX_TRACES 128
+#define CHECK_NAME_LEN 64
+#define CHECK_PERF_RUNS 5
+#define CHECK_CALIBRATION_FRAMES 16384
+#define CHECK_CALIBRATION_CHUNK 32
+#define CHECK_BASELINE_NAME "baseline"
+#define TRACE_SUFFIX ".trace"
+
+typedef struct {
+    char name[CHECK_NAME_LEN];
+    double ns_per_frame;
+    double cost_per_frame;    // ns_per_frame over the calibration loop's ns per parsed frame.
+    double writes_per_frame;
+    bool present;
+} check_entry_t;
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(((const check_entry_t *)a)->name, ((const check_entry_t *)b)->name);
+}
+
+static size_t list_traces(const char *dir, check_entry_t *entries, size_t max)
+{
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return 0;
+    }
+
+    size_t count = 0;
+    const size_t suffix_len = strlen(TRACE_SUFFIX);
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL && count < max) {
+        size_t len = strlen(de->d_name);
+        if (len <= suffix_len || len - suffix_len >= CHECK_NAME_LEN ||
+            strcmp(de->d_name + len - suffix_len, TRACE_SUFFIX) != 0) {
+            continue;
+        }
+        memset(&entries[count], 0, sizeof entries[count]);
+        memcpy(entries[count].name, de->d_name, len - suffix_len);
+        ++count;
+    }
+    closedir(d);
+
+    qsort(entries, count, sizeof entries[0], compare_names);
+    return count;
+}
+
+// Baseline lines: "<name> <cost_per_frame> <writes_per_frame>".
+static size_t load_baseline(const char *path, check_entry_t *entries, size_t max)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return 0;
+    }
+
+    size_t count = 0;
+    char line[256];
+    while (count < max && fgets(line, sizeof line, f)) {
+        check_entry_t *e = &entries[count];
+        if (line[0] == '#' ||
+            sscanf(line, "%63s %lf %lf", e->name, &e->cost_per_frame, &e->writes_per_frame) != 3) {
+            continue;
+        }
+        e->present = true;
+        ++count;
+    }
+    fclose(f);
+    return count;
+}
+
+static const check_entry_t *find_entry(const check_entry_t *entries, size_t count, const char *name)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return NULL;
+    }
+    char *buf = NULL;
+    size_t cap = 0;
+    *len = 0;
+    for (;;) {
+        if (*len == cap) {
+            cap = cap ? cap * 2 : 4096;
+            char *grown = realloc(buf, cap);
+            if (!grown) {
+                free(buf);
+                fclose(f);
+                return NULL;
+            }
+            buf = grown;
+        }
+        size_t n = fread(buf + *len, 1, cap - *len, f);
+        if (n == 0) {
+            break;
+        }
+        *len += n;
+    }
+    fclose(f);
+    return buf;
+}
+
+// Report the first line where the replay and the golden file disagree.
+static void report_diff(const char *name, const char *want, size_t want_len,
+                        const char *got, size_t got_len)
+{
+    size_t i = 0;
+    unsigned int line = 1;
+    size_t line_start = 0;
+    while (i < want_len && i < got_len && want[i] == got[i]) {
+        if (want[i] == '\n') {
+            ++line;
+            line_start = i + 1;
+        }
+        ++i;
+    }
+
+    const char *w = want + line_start;
+    const char *g = got + line_start;
+    int w_len = (int)(line_start < want_len ? strcspn(w, "\n") : 0);
+    int g_len = (int)(line_start < got_len ? strcspn(g, "\n") : 0);
+    if (line_start + (size_t)w_len > want_len) {
+        w_len = (int)(want_len - line_start);
+    }
+    if (line_start + (size_t)g_len > got_len) {
+        g_len = (int)(got_len - line_start);
+    }
+    fprintf(stderr, "  %s: event stream differs at line %u\n", name, line);
+    fprintf(stderr, "    golden: %.*s\n", w_len, line_start < want_len ? w : "<eof>");
+    fprintf(stderr, "    replay: %.*s\n", g_len, line_start < got_len ? g : "<eof>");
+}
+
+static bool check_events(const controller_options_t *opts, const char *dir, const char *name,
+                         bool bless, controller_sim_stats_t *stats)
+{
+    char trace_path[PATH_MAX];
+    char golden_path[PATH_MAX];
+    snprintf(trace_path, sizeof trace_path, "%s/%s" TRACE_SUFFIX, dir, name);
+    snprintf(golden_path, sizeof golden_path, "%s/%s.golden", dir, name);
+
+    char *got = NULL;
+    size_t got_len = 0;
+    FILE *mem = open_memstream(&got, &got_len);
+    if (!mem) {
+        perror("open_memstream");
+        return false;
+    }
+    int res = controller_simulate(opts, trace_path, mem, NULL, stats);
+    fclose(mem);
+    if (res != 0) {
+        fprintf(stderr, "  %s: replay failed\n", name);
+        free(got);
+        return false;
+    }
+
+    bool ok = true;
+    if (bless) {
+        FILE *f = fopen(golden_path, "w");
+        if (!f || fwrite(got, 1, got_len, f) != got_len) {
+            perror(golden_path);
+            ok = false;
+        }
+        if (f) {
+            fclose(f);
+        }
+    } else {
+        size_t want_len = 0;
+        char *want = read_file(golden_path, &want_len);
+        if (!want) {
+            fprintf(stderr, "  %s: no golden file (run with --check-bless)\n", name);
+            ok = false;
+        } else if (want_len != got_len || memcmp(want, got, got_len) != 0) {
+            report_diff(name, want, want_len, got, got_len);
+            ok = false;
+        }
+        free(want);
+    }
+    free(got);
+    return ok;
+}
+
+// Best-of-N ns to parse one frame of a fixed clean stream, read-sized chunks at a time.
+// Timed right before each trace, so host speed and load largely cancel out of the ratio.
+static double calibrate(void)
+{
+    static uint8_t stream[CHECK_CALIBRATION_FRAMES * SERIAL_FRAME_LEN];
+    for (size_t i = 0; i < CHECK_CALIBRATION_FRAMES; ++i) {
+        uint8_t *f = &stream[i * SERIAL_FRAME_LEN];
+        f[0] = 0xFF;
+        f[1] = 0x01;
+        f[2] = (uint8_t)i;
+        f[3] = (uint8_t)((i >> 8) & 0x0F);
+        f[4] = (uint8_t)i;
+        f[5] = 0x08;
+        f[6] = (uint8_t)(i * 3);
+    }
+
+    int64_t best_ns = INT64_MAX;
+    serial_frame_t frames[SERIAL_FRAMES_MAX(CHECK_CALIBRATION_CHUNK)];
+    volatile uint32_t sink = 0;
+    for (int run = 0; run < CHECK_PERF_RUNS; ++run) {
+        serial_parser_t parser;
+        resetSerialParser(&parser);
+        int64_t start = clock_host_ns();
+        for (size_t off = 0; off < sizeof stream; off += CHECK_CALIBRATION_CHUNK) {
+            size_t len = sizeof stream - off;
+            if (len > CHECK_CALIBRATION_CHUNK) {
+                len = CHECK_CALIBRATION_CHUNK;
+            }
+            size_t n = parseSerialFrames(&parser, stream + off, len, frames,
+                                         sizeof frames / sizeof frames[0]);
+            if (n > 0) {
+                sink += frames[n - 1].pad.x;
+            }
+        }
+        int64_t elapsed = clock_host_ns() - start;
+        if (elapsed < best_ns) {
+            best_ns = elapsed;
+        }
+    }
+    (void)sink;
+    return (double)best_ns / CHECK_CALIBRATION_FRAMES;
+}
+
+// Best-of-N replay time into the null sink, so the formatting of the golden log is not measured.
+static bool measure(const controller_options_t *opts, const char *dir, check_entry_t *e)
+{
+    char trace_path[PATH_MAX];
+    snprintf(trace_path, sizeof trace_path, "%s/%s" TRACE_SUFFIX, dir, e->name);
+
+    int64_t best_ns = INT64_MAX;
+    controller_sim_stats_t stats;
+    for (int run = 0; run < CHECK_PERF_RUNS; ++run) {
+        if (controller_simulate(opts, trace_path, NULL, NULL, &stats) != 0) {
+            return false;
+        }
+        if (stats.wall_ns < best_ns) {
+            best_ns = stats.wall_ns;
+        }
+    }
+
+    double frames = stats.frames ? (double)stats.frames : 1.0;
+    e->ns_per_frame = (double)best_ns / frames;
+    e->cost_per_frame = e->ns_per_frame / calibrate();
+    e->writes_per_frame = (double)stats.sink_writes / frames;
+    e->present = true;
+    return true;
+}
+
+static bool over_threshold(double value, double base, unsigned int threshold_pct)
+{
+    return value > base * (1.0 + threshold_pct / 100.0);
+}
+
+static bool write_baseline(const char *path, const check_entry_t *entries, size_t count)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fprintf(f, "# name cost_per_frame writes_per_frame (cost: ns/frame over ns per calibration parse)\n");
+    for (size_t i = 0; i < count; ++i) {
+        if (entries[i].present) {
+            fprintf(f, "%s %.2f %.3f\n", entries[i].name, entries[i].cost_per_frame,
+                    entries[i].writes_per_frame);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+int check_run(const char *corpus_dir, bool bless, unsigned int threshold_pct, unsigned int timing_pct)
+{
+    static check_entry_t traces[CHECK_MAX_TRACES];
+    static check_entry_t baseline[CHECK_MAX_TRACES];
+
+    size_t trace_count = list_traces(corpus_dir, traces, CHECK_MAX_TRACES);
+    if (trace_count == 0) {
+        fprintf(stderr, "Check: no *" TRACE_SUFFIX " files in %s\n", corpus_dir);
+        return 1;
+    }
+
+    char baseline_path[PATH_MAX];
+    snprintf(baseline_path, sizeof baseline_path, "%s/" CHECK_BASELINE_NAME, corpus_dir);
+    size_t baseline_count = bless ? 0 : load_baseline(baseline_path, baseline, CHECK_MAX_TRACES);
+
+    controller_options_t opts = { .config_override_dir = corpus_dir, .config_pinned = true };
+    config_set_verbose(false);
+
+    int failures = 0;
+    for (size_t i = 0; i < trace_count; ++i) {
+        check_entry_t *e = &traces[i];
+        controller_sim_stats_t stats;
+        bool ok = check_events(&opts, corpus_dir, e->name, bless, &stats);
+
+        if (!measure(&opts, corpus_dir, e)) {
+            fprintf(stderr, "  %s: timing replay failed\n", e->name);
+            ++failures;
+            continue;
+        }
+
+        const check_entry_t *base = find_entry(baseline, baseline_count, e->name);
+        if (base) {
+            // Timing only gates on request: even normalised, a shared host can swing it.
+            bool slow = timing_pct && over_threshold(e->cost_per_frame, base->cost_per_frame, timing_pct);
+            bool chatty = over_threshold(e->writes_per_frame, base->writes_per_frame, threshold_pct);
+            fprintf(stderr, "  %-20s %s  %8.1f ns/frame  %6.2f cost (base %.2f)%s  %.3f writes/frame (base %.3f)%s\n",
+                    e->name, ok ? "events ok" : "EVENTS DIFFER",
+                    e->ns_per_frame, e->cost_per_frame, base->cost_per_frame, slow ? " SLOWER" : "",
+                    e->writes_per_frame, base->writes_per_frame, chatty ? " MORE" : "");
+            ok = ok && !slow && !chatty;
+        } else {
+            fprintf(stderr, "  %-20s %s  %8.1f ns/frame  %6.2f cost  %.3f writes/frame%s\n",
+                    e->name, bless ? "blessed" : (ok ? "events ok" : "EVENTS DIFFER"),
+                    e->ns_per_frame, e->cost_per_frame, e->writes_per_frame, bless ? "" : " (no baseline)");
+        }
+        if (!ok) {
+            ++failures;
+        }
+    }
+
+    if (bless && !write_baseline(baseline_path, traces, trace_count)) {
+        ++failures;
+    }
+    config_set_verbose(true);
+
+    if (timing_pct) {
+        fprintf(stderr, "Check: %s (%zu traces, %d failing, threshold %u%%, timing %u%%)\n",
+                failures ? "FAIL" : "PASS", trace_count, failures, threshold_pct, timing_pct);
+    } else {
+        fprintf(stderr, "Check: %s (%zu traces, %d failing, threshold %u%%, timing not gated)\n",
+                failures ? "FAIL" : "PASS", trace_count, failures, threshold_pct);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+
+#define CHECK_DEFAULT_THRESHOLD_PCT 25
+#define CHECK_DEFAULT_TIMING_PCT 100
+
+/**
+ * Replay every NAME.trace in a corpus directory and compare the emitted event/GPIO
+ * stream with NAME.golden, then compare output writes/frame with the corpus "baseline"
+ * file. Replay time is reported as a cost: ns/frame divided by the ns per frame of a
+ * parser calibration loop timed in the same process. Config files placed in the
+ * directory pin the calibration, rumble and haptics settings used for the replay.
+ *
+ * @param corpus_dir    Directory holding the traces, goldens and baseline.
+ * @param bless         Rewrite goldens and baseline from the current build instead of comparing.
+ * @param threshold_pct Allowed write increase over the baseline, in percent.
+ * @param timing_pct    Allowed cost increase over the baseline, in percent; 0 reports it only.
+ * @return 0 if every trace matched and stayed within the thresholds, 1 otherwise.
+ */
+int check_run(const char *corpus_dir, bool bless, unsigned int threshold_pct, unsigned int timing_pct);
@@ -0,0 +1,198 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Text trace format for recording serial/FF input and replaying it in virtual time.
+
+#include "trace.h"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const kind_names[] = {
+    [TRACE_SERIAL_LEFT] = "L",
+    [TRACE_SERIAL_RIGHT] = "R",
+    [TRACE_FF_UPLOAD] = "FF_UPLOAD",
+    [TRACE_FF_PLAY] = "FF_PLAY",
+    [TRACE_FF_ERASE] = "FF_ERASE",
+    [TRACE_FF_GAIN] = "FF_GAIN",
+    [TRACE_HAPTIC] = "HAPTIC",
+    [TRACE_END] = "END",
+};
+
+int trace_open(trace_reader_t *r, const char *path)
+{
+    r->line = 0;
+    r->owned = strcmp(path, "-") != 0;
+    r->f = r->owned ? fopen(path, "r") : stdin;
+    if (!r->f) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+void trace_close(trace_reader_t *r)
+{
+    if (r->f && r->owned) {
+        fclose(r->f);
+    }
+    r->f = NULL;
+}
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    c = (char)tolower((unsigned char)c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static bool parse_hex(const char *s, trace_record_t *rec)
+{
+    size_t n = 0;
+    while (s[0] && s[1] && !isspace((unsigned char)s[0])) {
+        int hi = hex_nibble(s[0]);
+        int lo = hex_nibble(s[1]);
+        if (hi < 0 || lo < 0 || n >= TRACE_MAX_BYTES) {
+            return false;
+        }
+        rec->data[n++] = (uint8_t)((hi << 4) | lo);
+        s += 2;
+    }
+    rec->len = n;
+    return n > 0 && (*s == '\0' || isspace((unsigned char)*s));
+}
+
+static bool parse_line(char *line, trace_record_t *rec)
+{
+    char kind[16];
+    int consumed = 0;
+    long long t_us;
+
+    memset(rec, 0, sizeof *rec);
+    if (sscanf(line, "%lld %15s %n", &t_us, kind, &consumed) < 2 || t_us < 0) {
+        return false;
+    }
+    rec->t_ns = t_us * 1000LL;
+    const char *args = line + consumed;
+
+    unsigned int a, b, c, d;
+    int ia, ib;
+    if (strcmp(kind, "L") == 0 || strcmp(kind, "R") == 0) {
+        rec->kind = (kind[0] == 'L') ? TRACE_SERIAL_LEFT : TRACE_SERIAL_RIGHT;
+        return parse_hex(args, rec);
+    }
+    if (strcmp(kind, "FF_UPLOAD") == 0) {
+        rec->kind = TRACE_FF_UPLOAD;
+        if (sscanf(args, "%d %u %u %u", &ia, &b, &c, &d) != 4 || b > 0xFFFF || c > 0xFFFF || d > 0xFFFF) {
+            return false;
+        }
+        rec->id = ia;
+        rec->length_ms = (uint16_t)b;
+        rec->strong = (uint16_t)c;
+        rec->weak = (uint16_t)d;
+        return true;
+    }
+    if (strcmp(kind, "FF_PLAY") == 0) {
+        rec->kind = TRACE_FF_PLAY;
+        if (sscanf(args, "%d %d", &ia, &ib) != 2) return false;
+        rec->id = ia;
+        rec->value = ib;
+        return true;
+    }
+    if (strcmp(kind, "FF_ERASE") == 0) {
+        rec->kind = TRACE_FF_ERASE;
+        return sscanf(args, "%d", &rec->id) == 1;
+    }
+    if (strcmp(kind, "FF_GAIN") == 0) {
+        rec->kind = TRACE_FF_GAIN;
+        if (sscanf(args, "%u", &a) != 1 || a > 0xFFFF) return false;
+        rec->value = (int)a;
+        return true;
+    }
+    if (strcmp(kind, "HAPTIC") == 0) {
+        rec->kind = TRACE_HAPTIC;
+        return sscanf(args, "%23s", rec->name) == 1;
+    }
+    if (strcmp(kind, "END") == 0) {
+        rec->kind = TRACE_END;
+        return true;
+    }
+    return false;
+}
+
+int trace_next(trace_reader_t *r, trace_record_t *rec)
+{
+    char line[2 * TRACE_MAX_BYTES + 64];
+    while (fgets(line, sizeof line, r->f)) {
+        ++r->line;
+        char *p = line;
+        while (isspace((unsigned char)*p)) ++p;
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+        if (!parse_line(p, rec)) {
+            fprintf(stderr, "trace:%u: malformed record\n", r->line);
+            return -1;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int trace_writer_open(trace_writer_t *w, const char *path, int64_t t0_ns)
+{
+    w->t0_ns = t0_ns;
+    w->f = fopen(path, "w");
+    if (!w->f) {
+        perror(path);
+        return -1;
+    }
+    fprintf(w->f, "# trimui_inputd trace v1\n");
+    return 0;
+}
+
+void trace_write(trace_writer_t *w, int64_t now_ns, const trace_record_t *rec)
+{
+    if (!w || !w->f) return;
+
+    fprintf(w->f, "%" PRId64 " %s", (now_ns - w->t0_ns) / 1000, kind_names[rec->kind]);
+    switch (rec->kind) {
+    case TRACE_SERIAL_LEFT:
+    case TRACE_SERIAL_RIGHT:
+        fputc(' ', w->f);
+        for (size_t i = 0; i < rec->len; ++i) {
+            fprintf(w->f, "%02x", rec->data[i]);
+        }
+        break;
+    case TRACE_FF_UPLOAD:
+        fprintf(w->f, " %d %u %u %u", rec->id, rec->length_ms, rec->strong, rec->weak);
+        break;
+    case TRACE_FF_PLAY:
+        fprintf(w->f, " %d %d", rec->id, rec->value);
+        break;
+    case TRACE_FF_ERASE:
+        fprintf(w->f, " %d", rec->id);
+        break;
+    case TRACE_FF_GAIN:
+        fprintf(w->f, " %d", rec->value);
+        break;
+    case TRACE_HAPTIC:
+        fprintf(w->f, " %s", rec->name);
+        break;
+    case TRACE_END:
+    default:
+        break;
+    }
+    fputc('\n', w->f);
+}
+
+void trace_writer_close(trace_writer_t *w)
+{
+    if (w->f) {
+        fclose(w->f);
+    }
+    w->f = NULL;
+}
@@ -0,0 +1,110 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_MAX_BYTES 256
+#define TRACE_NAME_LEN 24
+
+/**
+ * Input record kinds. One text line each: "<t_us> <KIND> <args>".
+ *
+ *   L <hex>                              bytes read from the left serial port
+ *   R <hex>                              bytes read from the right serial port
+ *   FF_UPLOAD <id> <len_ms> <strong> <weak>
+ *   FF_PLAY <id> <repeat>
+ *   FF_ERASE <id>
+ *   FF_GAIN <gain>
+ *   HAPTIC <name>
+ *   END                                  keep simulating until this time
+ */
+typedef enum {
+    TRACE_SERIAL_LEFT = 0,
+    TRACE_SERIAL_RIGHT,
+    TRACE_FF_UPLOAD,
+    TRACE_FF_PLAY,
+    TRACE_FF_ERASE,
+    TRACE_FF_GAIN,
+    TRACE_HAPTIC,
+    TRACE_END
+} trace_kind_t;
+
+typedef struct {
+    int64_t t_ns;
+    trace_kind_t kind;
+    uint8_t data[TRACE_MAX_BYTES];
+    size_t len;
+    int id;
+    int value;     // repeat or gain
+    uint16_t length_ms;
+    uint16_t strong;
+    uint16_t weak;
+    char name[TRACE_NAME_LEN];
+} trace_record_t;
+
+typedef struct {
+    FILE *f;
+    unsigned int line;
+    bool owned;
+} trace_reader_t;
+
+typedef struct {
+    FILE *f;
+    int64_t t0_ns;
+} trace_writer_t;
+
+/**
+ * Open a trace for reading ("-" reads stdin).
+ *
+ * @param r    Reader to initialize.
+ * @param path Trace file.
+ * @return 0 on success, -1 on error.
+ */
+int trace_open(trace_reader_t *r, const char *path);
+
+/**
+ * Read the next record, skipping blank lines and '#' comments.
+ *
+ * @param r   Reader.
+ * @param rec Destination record.
+ * @return 1 on success, 0 at end of file, -1 on a malformed line (reported on stderr).
+ */
+int trace_next(trace_reader_t *r, trace_record_t *rec);
+
+/**
+ * Close a reader.
+ *
+ * @param r Reader to close.
+ */
+void trace_close(trace_reader_t *r);
+
+/**
+ * Start recording; timestamps are relative to t0_ns.
+ *
+ * @param w     Writer to initialize.
+ * @param path  Destination file (truncated).
+ * @param t0_ns Monotonic time that maps to t=0.
+ * @return 0 on success, -1 on error.
+ */
+int trace_writer_open(trace_writer_t *w, const char *path, int64_t t0_ns);
+
+/**
+ * Append one record stamped with now_ns.
+ *
+ * @param w      Writer (no-op if not open).
+ * @param now_ns Monotonic time of the record.
+ * @param rec    Record to write (t_ns is ignored).
+ */
+void trace_write(trace_writer_t *w, int64_t now_ns, const trace_record_t *rec);
+
+/**
+ * Flush and close a writer.
+ *
+ * @param w Writer to close.
+ */
+void trace_writer_close(trace_writer_t *w);
@@ -0,0 +1,90 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Fixed-size log-linear histogram used by the latency/cost instrumentation.
+
+#include "histogram.h"
+
+#include <string.h>
+
+static unsigned int bucket_index(uint64_t v)
+{
+    if (v < HISTOGRAM_SUB_BUCKETS) {
+        return (unsigned int)v;
+    }
+    unsigned int msb = 63u - (unsigned int)__builtin_clzll(v);
+    unsigned int shift = msb - HISTOGRAM_SUB_BITS;
+    unsigned int sub = (unsigned int)(v >> shift) & (HISTOGRAM_SUB_BUCKETS - 1u);
+    return (shift + 1u) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+static uint64_t bucket_upper(unsigned int idx)
+{
+    if (idx < HISTOGRAM_SUB_BUCKETS) {
+        return idx;
+    }
+    unsigned int shift = idx / HISTOGRAM_SUB_BUCKETS - 1u;
+    uint64_t sub = idx % HISTOGRAM_SUB_BUCKETS;
+    uint64_t base = (HISTOGRAM_SUB_BUCKETS + sub) << shift;
+    return base + ((uint64_t)1 << shift) - 1u;
+}
+
+void histogram_reset(histogram_t *h)
+{
+    memset(h, 0, sizeof *h);
+}
+
+void histogram_add(histogram_t *h, uint64_t ns)
+{
+    unsigned int idx = bucket_index(ns);
+    if (idx >= HISTOGRAM_BUCKETS) {
+        idx = HISTOGRAM_BUCKETS - 1u;
+    }
+    h->buckets[idx]++;
+    if (h->count == 0 || ns < h->min_ns) {
+        h->min_ns = ns;
+    }
+    if (ns > h->max_ns) {
+        h->max_ns = ns;
+    }
+    h->count++;
+    h->sum_ns += ns;
+}
+
+uint64_t histogram_percentile(const histogram_t *h, double p)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)((double)h->count * p / 100.0 + 0.5);
+    if (target == 0) target = 1;
+    if (target > h->count) target = h->count;
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += h->buckets[i];
+        if (seen >= target) {
+            uint64_t upper = bucket_upper(i);
+            return (upper > h->max_ns) ? h->max_ns : upper;
+        }
+    }
+    return h->max_ns;
+}
+
+void histogram_print(const histogram_t *h, const char *label, FILE *out)
+{
+    if (h->count == 0) {
+        fprintf(out, "%-12s n=0\n", label);
+        return;
+    }
+    fprintf(out,
+            "%-12s n=%" PRIu64 " min=%.1f mean=%.1f p50=%.1f p99=%.1f p99.9=%.1f max=%.1f us\n",
+            label,
+            h->count,
+            h->min_ns / 1000.0,
+            (double)h->sum_ns / (double)h->count / 1000.0,
+            histogram_percentile(h, 50.0) / 1000.0,
+            histogram_percentile(h, 99.0) / 1000.0,
+            histogram_percentile(h, 99.9) / 1000.0,
+            h->max_ns / 1000.0);
+}
@@ -0,0 +1,59 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Sub-buckets per power of two; 8 keeps percentile error under ~12%.
+ */
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_SUB_BUCKETS (1u << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS (64u * HISTOGRAM_SUB_BUCKETS)
+
+/**
+ * Log-linear latency histogram over nanosecond samples (fixed size, no allocation).
+ */
+typedef struct {
+    uint32_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+} histogram_t;
+
+/**
+ * Clear all samples.
+ *
+ * @param h Histogram to reset.
+ */
+void histogram_reset(histogram_t *h);
+
+/**
+ * Record one sample.
+ *
+ * @param h  Histogram to update.
+ * @param ns Sample value in nanoseconds.
+ */
+void histogram_add(histogram_t *h, uint64_t ns);
+
+/**
+ * Estimate a percentile from the bucket counts.
+ *
+ * @param h Histogram to query.
+ * @param p Percentile in the 0-100 range.
+ * @return Upper bound of the bucket holding the percentile (ns), 0 if empty.
+ */
+uint64_t histogram_percentile(const histogram_t *h, double p);
+
+/**
+ * Print a one-line summary (count, min, mean, p50/p99/p99.9, max) in microseconds.
+ *
+ * @param h     Histogram to print.
+ * @param label Row label.
+ * @param out   Destination stream.
+ */
+void histogram_print(const histogram_t *h, const char *label, FILE *out);
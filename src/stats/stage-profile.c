@@ -0,0 +1,265 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Per-stage CPU cost attribution from perf self-counters or the thread CPU clock.
+
+#include "stage-profile.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROFILE_MAX_DEPTH 8
+#define PROFILE_CALIBRATION_READS 256
+
+// Counter slots: CPU time is always present, the rest only with perf.
+enum {
+    COUNTER_NS = 0,
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_MISSES,
+    COUNTER_COUNT
+};
+
+static const char *const stage_names[PROFILE_STAGE_COUNT] = {
+    "read", "parse", "map", "diff", "emit", "ff", "gpio"
+};
+
+static struct {
+    bool enabled;
+    bool perf;                      // Counters come from perf_event_open().
+    bool user_only;                 // Kernel time excluded (perf_event_paranoid).
+    int fds[COUNTER_COUNT];         // Group members; fds[0] is the leader (task clock).
+    int slot[COUNTER_COUNT];        // Position of each counter in the group read, -1 if absent.
+    int nr;                         // Events in the group.
+    uint64_t overhead[COUNTER_COUNT];   // Cost of one sample, subtracted per attribution.
+    uint64_t last[COUNTER_COUNT];
+    int stack[PROFILE_MAX_DEPTH];
+    int depth;
+    int current;                    // Stage being charged, -1 for unattributed time.
+    uint64_t totals[PROFILE_STAGE_COUNT][COUNTER_COUNT];
+    uint64_t calls[PROFILE_STAGE_COUNT];
+    uint64_t frames;
+} prof = { .current = -1 };
+
+static int perf_open(uint32_t type, uint64_t config, int group_fd, bool user_only)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = (group_fd < 0);
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+static void close_counters(void)
+{
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        if (prof.fds[i] >= 0) {
+            close(prof.fds[i]);
+        }
+        prof.fds[i] = -1;
+        prof.slot[i] = -1;
+    }
+    prof.nr = 0;
+    prof.perf = false;
+}
+
+// Task clock leads the group so CPU time stays available when a hardware event is missing
+// (VMs, cores without a PMU driver).
+static bool open_counters(void)
+{
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[COUNTER_COUNT] = {
+        [COUNTER_NS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+        [COUNTER_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        [COUNTER_INSTRUCTIONS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        [COUNTER_CACHE_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    };
+
+    close_counters();
+    prof.user_only = false;
+    int leader = perf_open(events[0].type, events[0].config, -1, false);
+    if (leader < 0 && errno == EACCES) {
+        prof.user_only = true;
+        leader = perf_open(events[0].type, events[0].config, -1, true);
+    }
+    if (leader < 0) {
+        return false;
+    }
+    prof.fds[0] = leader;
+    prof.slot[0] = prof.nr++;
+
+    for (int i = 1; i < COUNTER_COUNT; ++i) {
+        int fd = perf_open(events[i].type, events[i].config, leader, prof.user_only);
+        if (fd >= 0) {
+            prof.fds[i] = fd;
+            prof.slot[i] = prof.nr++;
+        }
+    }
+    if (prof.nr == 1) {
+        // Task clock alone buys nothing over CLOCK_THREAD_CPUTIME_ID.
+        close_counters();
+        return false;
+    }
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    prof.perf = true;
+    return true;
+}
+
+static void sample(uint64_t *out)
+{
+    memset(out, 0, sizeof(uint64_t) * COUNTER_COUNT);
+    if (prof.perf) {
+        uint64_t buf[1 + COUNTER_COUNT];
+        if (read(prof.fds[0], buf, sizeof buf) >= (ssize_t)(sizeof(uint64_t) * (1 + (size_t)prof.nr))) {
+            for (int i = 0; i < COUNTER_COUNT; ++i) {
+                if (prof.slot[i] >= 0) {
+                    out[i] = buf[1 + prof.slot[i]];
+                }
+            }
+        }
+        return;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    out[COUNTER_NS] = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Average cost of one sample() so it can be taken back out of every attribution.
+static void calibrate(void)
+{
+    uint64_t first[COUNTER_COUNT];
+    uint64_t now[COUNTER_COUNT];
+    sample(first);
+    for (int i = 0; i < PROFILE_CALIBRATION_READS; ++i) {
+        sample(now);
+    }
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        prof.overhead[i] = (now[i] - first[i]) / PROFILE_CALIBRATION_READS;
+    }
+}
+
+// Charge everything since the previous transition to the current stage.
+static void charge(void)
+{
+    uint64_t now[COUNTER_COUNT];
+    sample(now);
+    if (prof.current >= 0) {
+        for (int i = 0; i < COUNTER_COUNT; ++i) {
+            uint64_t delta = now[i] - prof.last[i];
+            prof.totals[prof.current][i] += (delta > prof.overhead[i]) ? delta - prof.overhead[i] : 0;
+        }
+    }
+    memcpy(prof.last, now, sizeof now);
+}
+
+void stage_profile_enable(bool enable)
+{
+    if (prof.perf) {
+        close_counters();
+    }
+    memset(&prof, 0, sizeof prof);
+    prof.current = -1;
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        prof.fds[i] = -1;
+        prof.slot[i] = -1;
+    }
+    if (!enable) {
+        return;
+    }
+
+    if (!open_counters()) {
+        fprintf(stderr, "Stage profile: perf counters unavailable (%s), using thread CPU time\n",
+                strerror(errno));
+    }
+    calibrate();
+    prof.enabled = true;
+}
+
+bool stage_profile_enabled(void)
+{
+    return prof.enabled;
+}
+
+void stage_profile_enter(profile_stage_t stage)
+{
+    if (!prof.enabled || stage >= PROFILE_STAGE_COUNT) return;
+
+    charge();
+    if (prof.depth < PROFILE_MAX_DEPTH) {
+        prof.stack[prof.depth] = prof.current;
+    }
+    prof.depth++;
+    prof.current = (int)stage;
+    prof.calls[stage]++;
+}
+
+void stage_profile_leave(void)
+{
+    if (!prof.enabled || prof.depth == 0) return;
+
+    charge();
+    prof.depth--;
+    prof.current = (prof.depth < PROFILE_MAX_DEPTH) ? prof.stack[prof.depth] : prof.current;
+}
+
+void stage_profile_frame(void)
+{
+    if (prof.enabled) {
+        prof.frames++;
+    }
+}
+
+void stage_profile_report(FILE *out)
+{
+    if (!prof.enabled) return;
+
+    double frames = prof.frames ? (double)prof.frames : 1.0;
+    if (prof.perf) {
+        fprintf(out, "Stage profile (perf, %s): %" PRIu64 " frames, per frame:\n",
+                prof.user_only ? "user only" : "user+kernel", prof.frames);
+    } else {
+        fprintf(out, "Stage profile (thread CPU time): %" PRIu64 " frames, per frame:\n", prof.frames);
+    }
+    fprintf(out, "  %-6s %10s %10s %10s %10s %10s\n", "stage", "ns", "cycles", "instr", "misses", "calls");
+
+    uint64_t sum[COUNTER_COUNT] = { 0 };
+    for (int s = 0; s < PROFILE_STAGE_COUNT; ++s) {
+        fprintf(out, "  %-6s %10.0f", stage_names[s], (double)prof.totals[s][COUNTER_NS] / frames);
+        for (int i = COUNTER_CYCLES; i < COUNTER_COUNT; ++i) {
+            if (prof.slot[i] >= 0) {
+                fprintf(out, " %10.0f", (double)prof.totals[s][i] / frames);
+            } else {
+                fprintf(out, " %10s", "n/a");
+            }
+        }
+        fprintf(out, " %10.2f\n", (double)prof.calls[s] / frames);
+        for (int i = 0; i < COUNTER_COUNT; ++i) {
+            sum[i] += prof.totals[s][i];
+        }
+    }
+    fprintf(out, "  %-6s %10.0f", "total", (double)sum[COUNTER_NS] / frames);
+    for (int i = COUNTER_CYCLES; i < COUNTER_COUNT; ++i) {
+        if (prof.slot[i] >= 0) {
+            fprintf(out, " %10.0f", (double)sum[i] / frames);
+        } else {
+            fprintf(out, " %10s", "n/a");
+        }
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,69 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Pipeline stages whose CPU cost is attributed separately.
+ *
+ * READ:  read(2) on a pad port.
+ * PARSE: frame reassembly in the serial parser.
+ * MAP:   stick filter, calibration and deadzone.
+ * DIFF:  change detection against the last state (everything in process_sample()
+ *        not claimed by another stage).
+ * EMIT:  input_event writes, SYN_REPORT and the frame ring.
+ * FF:    uinput force-feedback requests and rumble timer ticks.
+ * GPIO:  motor and brake line writes (sysfs or the simulation backend).
+ */
+typedef enum {
+    PROFILE_STAGE_READ = 0,
+    PROFILE_STAGE_PARSE,
+    PROFILE_STAGE_MAP,
+    PROFILE_STAGE_DIFF,
+    PROFILE_STAGE_EMIT,
+    PROFILE_STAGE_FF,
+    PROFILE_STAGE_GPIO,
+    PROFILE_STAGE_COUNT
+} profile_stage_t;
+
+/**
+ * Turn profiling on or off (off by default; enter/leave are no-ops when off).
+ * Enabling opens perf_event_open() self-counters for cycles, instructions and cache
+ * misses; if the kernel refuses, thread CPU time is measured instead.
+ *
+ * @param enable true to start collecting.
+ */
+void stage_profile_enable(bool enable);
+
+/**
+ * @return true when profiling is collecting samples.
+ */
+bool stage_profile_enabled(void);
+
+/**
+ * Start attributing cost to a stage. Stages nest; the outer stage is charged only for
+ * time outside its inner stages.
+ *
+ * @param stage Stage being entered.
+ */
+void stage_profile_enter(profile_stage_t stage);
+
+/**
+ * Return to the enclosing stage (or to unattributed time).
+ */
+void stage_profile_leave(void);
+
+/**
+ * Count one decoded frame; the report divides every stage by this.
+ */
+void stage_profile_frame(void);
+
+/**
+ * Print per-frame averages per stage.
+ *
+ * @param out Destination stream.
+ */
+void stage_profile_report(FILE *out);
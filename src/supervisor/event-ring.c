@@ -0,0 +1,146 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Single-producer / single-consumer ring of event batches between worker and supervisor.
+
+#include "event-ring.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+int event_ring_create(event_ring_t *r)
+{
+    memset(r, 0, sizeof *r);
+    r->efd = -1;
+    void *map = mmap(NULL, sizeof *r->shm, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        perror("event ring mmap");
+        return -1;
+    }
+    r->efd = eventfd(0, EFD_NONBLOCK);
+    if (r->efd < 0) {
+        perror("event ring eventfd");
+        munmap(map, sizeof *r->shm);
+        return -1;
+    }
+    r->shm = map;
+    for (int i = 0; i < 2; ++i) {
+        r->shm->irq_prev[i] = (irq_affinity_prev_t){ .irq = -1, .cpu = -1 };
+    }
+    return 0;
+}
+
+void event_ring_destroy(event_ring_t *r)
+{
+    if (r->efd >= 0) {
+        close(r->efd);
+        r->efd = -1;
+    }
+    if (r->shm) {
+        munmap(r->shm, sizeof *r->shm);
+        r->shm = NULL;
+    }
+}
+
+void event_ring_append(event_ring_t *r, const struct input_event *ev)
+{
+    // The last entry is kept for the SYN_REPORT so a truncated batch still ends a report.
+    if (r->pending.count >= EVENT_RING_BATCH_MAX - (ev->type == EV_SYN ? 0 : 1)) {
+        __atomic_add_fetch(&r->shm->overflow_events, 1, __ATOMIC_RELAXED);
+        r->pending.dropped++;
+        return;
+    }
+    r->pending.events[r->pending.count++] = *ev;
+}
+
+bool event_ring_commit(event_ring_t *r, const event_ring_state_t *state)
+{
+    r->pending.state = *state;
+    return event_ring_flush(r);
+}
+
+bool event_ring_flush(event_ring_t *r)
+{
+    event_ring_shared_t *shm = r->shm;
+    if (r->pending.count == 0) {
+        return false;
+    }
+
+    uint64_t head = __atomic_load_n(&shm->head, __ATOMIC_RELAXED);
+    if (head - __atomic_load_n(&shm->tail, __ATOMIC_ACQUIRE) >= EVENT_RING_SLOTS) {
+        return false;
+    }
+    memcpy(&shm->slots[head & (EVENT_RING_SLOTS - 1)], &r->pending,
+           sizeof r->pending - sizeof r->pending.events + r->pending.count * sizeof r->pending.events[0]);
+    __atomic_store_n(&shm->head, head + 1, __ATOMIC_RELEASE);
+    bool truncated = r->pending.dropped != 0;
+    r->pending.count = 0;
+    r->pending.dropped = 0;
+
+    const uint64_t one = 1;
+    if (write(r->efd, &one, sizeof one) < 0 && errno != EAGAIN) {
+        perror("event ring wakeup");
+    }
+    return truncated;
+}
+
+void event_ring_ff_store(event_ring_t *r, const struct ff_effect *effect)
+{
+    if (effect->id < 0 || effect->id >= EVENT_RING_FF_EFFECTS) {
+        return;
+    }
+    // A worker killed mid-copy leaves the bit clear, so the next one never loads a torn effect.
+    event_ring_ff_t *ff = &r->shm->ff;
+    const uint32_t bit = 1u << effect->id;
+    __atomic_and_fetch(&ff->in_use, ~bit, __ATOMIC_RELEASE);
+    ff->effects[effect->id] = *effect;
+    __atomic_or_fetch(&ff->in_use, bit, __ATOMIC_RELEASE);
+}
+
+void event_ring_ff_erase(event_ring_t *r, int id)
+{
+    if (id >= 0 && id < EVENT_RING_FF_EFFECTS) {
+        __atomic_and_fetch(&r->shm->ff.in_use, ~(1u << id), __ATOMIC_RELEASE);
+    }
+}
+
+void event_ring_ff_gain(event_ring_t *r, uint16_t gain)
+{
+    r->shm->ff.gain = gain;
+    __atomic_store_n(&r->shm->ff.gain_set, 1, __ATOMIC_RELEASE);
+}
+
+void event_ring_ready(event_ring_t *r, int pid)
+{
+    __atomic_store_n(&r->shm->ready_pid, pid, __ATOMIC_RELEASE);
+    const uint64_t one = 1;
+    if (write(r->efd, &one, sizeof one) < 0 && errno != EAGAIN) {
+        perror("event ring wakeup");
+    }
+}
+
+const event_ring_slot_t *event_ring_peek(const event_ring_t *r)
+{
+    const event_ring_shared_t *shm = r->shm;
+    uint64_t tail = __atomic_load_n(&shm->tail, __ATOMIC_RELAXED);
+    if (tail == __atomic_load_n(&shm->head, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &shm->slots[tail & (EVENT_RING_SLOTS - 1)];
+}
+
+void event_ring_consume(event_ring_t *r)
+{
+    event_ring_shared_t *shm = r->shm;
+    uint64_t tail = __atomic_load_n(&shm->tail, __ATOMIC_RELAXED);
+    const event_ring_slot_t *slot = &shm->slots[tail & (EVENT_RING_SLOTS - 1)];
+    // A truncated batch did not bring the device to its state; a restarted worker would
+    // diff from values the device never got, so it re-primes until the re-sync arrives.
+    shm->prime = slot->state;
+    shm->prime_valid = slot->dropped == 0;
+    __atomic_store_n(&shm->tail, tail + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,166 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <linux/input.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../affinity/irq-affinity.h"
+
+#define EVENT_RING_SLOTS 128u       // Power of two.
+#define EVENT_RING_BATCH_MAX 64     // Events per batch; a full report is about 25.
+#define EVENT_RING_FF_EFFECTS 8     // Mirrored effect ids; matches RUMBLE_MAX_EFFECTS.
+
+/**
+ * Mapping state the device reflects once a batch has been written, so a restarted
+ * worker can continue diffing from it instead of re-priming the device.
+ */
+typedef struct {
+    uint8_t buttons[2];     // Raw button bitfields, left then right.
+    int16_t axes[4];        // Left X/Y, right X/Y as sent.
+    int8_t hat_x;
+    int8_t hat_y;
+} event_ring_state_t;
+
+/**
+ * Force-feedback setup the game made through the device. Games usually upload their
+ * effects once, so a restarted worker loads them from here instead of losing rumble.
+ */
+typedef struct {
+    struct ff_effect effects[EVENT_RING_FF_EFFECTS];
+    uint32_t in_use;            // Bit per effect id; cleared while its effect is rewritten.
+    uint32_t gain_set;
+    uint16_t gain;
+} event_ring_ff_t;
+
+/**
+ * One or more complete reports (each ending in SYN_REPORT) plus the state after them.
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t dropped;           // Events event_ring_append() could not fit.
+    event_ring_state_t state;
+    struct input_event events[EVENT_RING_BATCH_MAX];
+} event_ring_slot_t;
+
+/**
+ * Shared between the supervisor and its worker (anonymous MAP_SHARED, inherited on fork).
+ * The worker only writes head, the slots, ff and irq_prev; the supervisor only writes tail
+ * and prime.
+ */
+typedef struct {
+    uint64_t head;              // Batches published by the worker.
+    uint64_t tail;              // Batches written to the device by the supervisor.
+    uint64_t overflow_events;   // Events dropped because a batch outgrew its slot.
+    int64_t device_created_ns;  // Start of the stick settle window.
+    int32_t ready_pid;          // Set by a worker once it is reading the pads.
+    uint32_t prime_valid;
+    event_ring_state_t prime;   // State after the last batch the device received.
+    event_ring_ff_t ff;         // Effects and gain the device's FF clients have set.
+    irq_affinity_prev_t irq_prev[2];    // Pad IRQ routing before any worker steered it.
+    event_ring_slot_t slots[EVENT_RING_SLOTS];
+} event_ring_shared_t;
+
+/**
+ * A process's view of the ring. The worker also keeps the batch it is building.
+ */
+typedef struct {
+    event_ring_shared_t *shm;
+    int efd;                    // eventfd the worker signals after publishing.
+    event_ring_slot_t pending;
+} event_ring_t;
+
+/**
+ * Map a fresh ring and its eventfd; both survive fork().
+ *
+ * @param r Ring to initialize (shm is NULL on failure).
+ * @return 0 on success, -1 on error.
+ */
+int event_ring_create(event_ring_t *r);
+
+/**
+ * Unmap the ring and close the eventfd. Safe on a ring that never opened.
+ *
+ * @param r Ring.
+ */
+void event_ring_destroy(event_ring_t *r);
+
+/**
+ * Worker: add one event to the batch being built.
+ *
+ * @param r  Ring.
+ * @param ev Event to copy.
+ */
+void event_ring_append(event_ring_t *r, const struct input_event *ev);
+
+/**
+ * Worker: publish the pending batch with the state it leaves the device in, and wake the
+ * supervisor. If the ring is full (the supervisor is stalled) the batch is kept and goes
+ * out together with the next report.
+ *
+ * @param r     Ring.
+ * @param state Mapping state after the batch.
+ * @return true if the published batch had events dropped, so the caller must send its
+ *         full state again; false otherwise (including when the batch was kept).
+ */
+bool event_ring_commit(event_ring_t *r, const event_ring_state_t *state);
+
+/**
+ * Worker: retry publishing a batch event_ring_commit() had to keep because the ring was
+ * full. No-op when nothing is pending.
+ *
+ * @param r Ring.
+ * @return Same as event_ring_commit().
+ */
+bool event_ring_flush(event_ring_t *r);
+
+/**
+ * Worker: mirror an effect the worker accepted from UI_FF_UPLOAD.
+ *
+ * @param r      Ring.
+ * @param effect Effect with the id it was stored under.
+ */
+void event_ring_ff_store(event_ring_t *r, const struct ff_effect *effect);
+
+/**
+ * Worker: drop a mirrored effect after UI_FF_ERASE.
+ *
+ * @param r  Ring.
+ * @param id Effect id.
+ */
+void event_ring_ff_erase(event_ring_t *r, int id);
+
+/**
+ * Worker: mirror the last FF_GAIN.
+ *
+ * @param r    Ring.
+ * @param gain Gain, 0..0xFFFF.
+ */
+void event_ring_ff_gain(event_ring_t *r, uint16_t gain);
+
+/**
+ * Worker: announce that the worker is serving input.
+ *
+ * @param r   Ring.
+ * @param pid Worker pid.
+ */
+void event_ring_ready(event_ring_t *r, int pid);
+
+/**
+ * Supervisor: oldest published batch not yet consumed.
+ *
+ * @param r Ring.
+ * @return Slot to forward, NULL when the ring is empty.
+ */
+const event_ring_slot_t *event_ring_peek(const event_ring_t *r);
+
+/**
+ * Supervisor: release the slot returned by event_ring_peek() and record its state as
+ * the one a restarted worker primes from. A batch with dropped events leaves no valid
+ * state until the worker's full re-sync goes out.
+ *
+ * @param r Ring.
+ */
+void event_ring_consume(event_ring_t *r);
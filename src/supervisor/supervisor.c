@@ -0,0 +1,305 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Supervisor: owns the device and GPIOs, forwards worker batches, restarts the worker.
+
+#define _GNU_SOURCE
+
+#include "supervisor.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../clock/clock.h"
+#include "../control/control.h"
+#include "../gpio/gpio.h"
+#include "../ring/frame-ring.h"
+#include "event-ring.h"
+
+static volatile sig_atomic_t stop_requested = 0;
+static volatile sig_atomic_t dump_requested = 0;
+
+static void handle_stop(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static void handle_dump(int sig)
+{
+    (void)sig;
+    dump_requested = 1;
+}
+
+typedef struct {
+    pid_t pid;
+    int lifeline;           // Read end of a pipe only the worker holds open; HUP = worker gone.
+    int64_t started_ns;
+    int brake_gpio;         // Brake line from the rumble.config the worker started with.
+} worker_proc_t;
+
+// Created once and handed to every worker, so a restart does not orphan ring subscribers
+// or control clients.
+typedef struct {
+    frame_ring_t frames;
+    control_t control;
+    int keeper[2];          // Worker -> supervisor: new ring subscriptions (SOCK_SEQPACKET).
+} shared_endpoints_t;
+
+static bool spawn_worker(const controller_options_t *opts, int out_fd, event_ring_t *ring,
+                         shared_endpoints_t *shared, worker_proc_t *w)
+{
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        perror("pipe2");
+        return false;
+    }
+    __atomic_store_n(&ring->shm->ready_pid, 0, __ATOMIC_RELAXED);
+    // Read before the fork so the supervisor knows which line a dying worker may leave braking.
+    w->brake_gpio = controller_brake_gpio(opts);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(pipe_fds[0]);
+        // The lifeline write end stays open (and unused) until the worker exits.
+        controller_worker_t worker = {
+            .uinput_fd = opts->event_sink ? -1 : out_fd,
+            .ring = ring,
+            .frames = &shared->frames,
+            .control = &shared->control,
+            .keeper_fd = shared->keeper[1],
+        };
+        _exit(controller_run_worker(opts, &worker));
+    }
+    close(pipe_fds[1]);
+    w->pid = pid;
+    w->lifeline = pipe_fds[0];
+    w->started_ns = clock_now_ns();
+    return true;
+}
+
+// A worker killed mid-effect or mid-brake leaves its lines where they were.
+static void stop_motor(const worker_proc_t *w)
+{
+    gpio_set_line(GPIO_RUMBLE, false);
+    if (w->brake_gpio >= 0) {
+        gpio_set_line(w->brake_gpio, false);
+    }
+}
+
+// Write every published batch to the device, one write() per batch.
+static void forward_batches(event_ring_t *ring, int out_fd, uint64_t *batches)
+{
+    const event_ring_slot_t *slot;
+    while ((slot = event_ring_peek(ring)) != NULL) {
+        size_t len = slot->count * sizeof slot->events[0];
+        if (out_fd >= 0 && len > 0 && write(out_fd, slot->events, len) != (ssize_t)len) {
+            perror("supervisor write");
+        }
+        event_ring_consume(ring);
+        ++*batches;
+    }
+}
+
+static void describe_exit(int status, char *buf, size_t len)
+{
+    if (WIFSIGNALED(status)) {
+        snprintf(buf, len, "killed by signal %d", WTERMSIG(status));
+    } else {
+        snprintf(buf, len, "exited with status %d", WEXITSTATUS(status));
+    }
+}
+
+int supervisor_run(const controller_options_t *opts)
+{
+    signal(SIGINT, handle_stop);
+    signal(SIGTERM, handle_stop);
+    signal(SIGUSR1, handle_dump);
+    signal(SIGPIPE, SIG_IGN);
+
+    gpio_board_init();
+
+    int out_fd = -1;
+    if (opts->event_sink) {
+        out_fd = open(opts->event_sink, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out_fd < 0) {
+            perror(opts->event_sink);
+            return EXIT_FAILURE;
+        }
+    } else if (!opts->null_output) {
+        out_fd = controller_create_device(opts);
+        if (out_fd < 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    event_ring_t ring;
+    if (event_ring_create(&ring) != 0) {
+        controller_destroy_device(opts->event_sink ? -1 : out_fd);
+        return EXIT_FAILURE;
+    }
+    // Without a device there is nothing to settle (same as the standalone daemon).
+    ring.shm->device_created_ns = (opts->event_sink || opts->null_output) ? 0 : clock_now_ns();
+
+    shared_endpoints_t shared = { .control = { .fd = -1 }, .keeper = { -1, -1 } };
+    frame_ring_init(&shared.frames);
+    if (opts->frame_ring) {
+        frame_ring_create(&shared.frames, opts->frame_ring);
+    }
+    const char *control_path = opts->control_path ? opts->control_path : CONTROL_DEFAULT_PATH;
+    if (*control_path) {
+        control_open(&shared.control, control_path, opts->control_mode, opts->control_group);
+    }
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, shared.keeper) != 0) {
+        // Subscriptions then last only as long as the worker that took them.
+        perror("socketpair");
+        shared.keeper[0] = shared.keeper[1] = -1;
+    }
+
+    worker_proc_t w = { .pid = -1, .lifeline = -1, .brake_gpio = -1 };
+    uint64_t batches = 0;
+    uint64_t restarts = 0;
+    int64_t died_ns = 0;        // Set while a restarted worker has not reported ready.
+    int64_t respawn_ns = 0;     // Backoff deadline while no worker runs.
+    int64_t max_recovery_ns = 0;
+    unsigned int backoff_ms = 0;
+    int exit_code = EXIT_SUCCESS;
+
+    if (!spawn_worker(opts, out_fd, &ring, &shared, &w)) {
+        exit_code = EXIT_FAILURE;
+        stop_requested = 1;
+    }
+
+    while (!stop_requested) {
+        struct pollfd pfds[3] = {
+            { .fd = ring.efd, .events = POLLIN },
+            { .fd = w.lifeline, .events = POLLIN },
+            { .fd = shared.keeper[0], .events = POLLIN },
+        };
+        int timeout_ms = -1;
+        if (w.pid < 0) {
+            int64_t left = respawn_ns - clock_now_ns();
+            timeout_ms = left > 0 ? (int)((left + 999999) / 1000000) : 0;
+        }
+        int ret = poll(pfds, 3, timeout_ms);
+        if (ret < 0 && errno != EINTR) {
+            perror("poll");
+            exit_code = EXIT_FAILURE;
+            break;
+        }
+
+        if (dump_requested) {
+            dump_requested = 0;
+            fprintf(stderr, "Supervisor batches=%" PRIu64 " restarts=%" PRIu64 " max_recovery=%.1fms overflow=%" PRIu64 "\n",
+                    batches, restarts, max_recovery_ns / 1e6, ring.shm->overflow_events);
+            if (w.pid > 0) {
+                kill(w.pid, SIGUSR1);
+            }
+        }
+
+        if (ret > 0 && (pfds[0].revents & POLLIN)) {
+            uint64_t n;
+            if (read(ring.efd, &n, sizeof n) < 0 && errno != EAGAIN) {
+                perror("event ring read");
+            }
+            forward_batches(&ring, out_fd, &batches);
+            if (died_ns && __atomic_load_n(&ring.shm->ready_pid, __ATOMIC_ACQUIRE) == w.pid) {
+                int64_t recovery = clock_now_ns() - died_ns;
+                if (recovery > max_recovery_ns) {
+                    max_recovery_ns = recovery;
+                }
+                fprintf(stderr, "Worker %d serving input %.1f ms after the previous one died\n",
+                        (int)w.pid, recovery / 1e6);
+                died_ns = 0;
+            }
+        }
+
+        if (ret > 0 && (pfds[2].revents & POLLIN)) {
+            while (frame_ring_recv_subscription(&shared.frames, shared.keeper[0]) > 0) {
+            }
+        }
+
+        if (ret > 0 && (pfds[1].revents & (POLLHUP | POLLIN | POLLERR))) {
+            int status = 0;
+            char how[48];
+            int64_t now = clock_now_ns();
+            waitpid(w.pid, &status, 0);
+            close(w.lifeline);
+            // Whatever the worker finished publishing still goes out, in order.
+            forward_batches(&ring, out_fd, &batches);
+            stop_motor(&w);
+            describe_exit(status, how, sizeof how);
+
+            int64_t lived = now - w.started_ns;
+            if (lived >= (int64_t)SUPERVISOR_STABLE_MS * 1000000LL) {
+                backoff_ms = 0;
+            } else {
+                backoff_ms = backoff_ms ? backoff_ms * 2 : SUPERVISOR_BACKOFF_MIN_MS;
+                if (backoff_ms > SUPERVISOR_BACKOFF_MAX_MS) {
+                    backoff_ms = SUPERVISOR_BACKOFF_MAX_MS;
+                }
+            }
+            fprintf(stderr, "Worker %d %s after %.1f s; restarting%s\n", (int)w.pid, how, lived / 1e9,
+                    backoff_ms ? " after backoff" : "");
+            w.pid = -1;
+            w.lifeline = -1;
+            if (!died_ns) {
+                died_ns = now;
+            }
+            respawn_ns = now + (int64_t)backoff_ms * 1000000LL;
+        }
+
+        if (w.pid < 0 && clock_now_ns() >= respawn_ns) {
+            // Subscriptions the dead worker handed over last go to the new one too.
+            while (frame_ring_recv_subscription(&shared.frames, shared.keeper[0]) > 0) {
+            }
+            if (spawn_worker(opts, out_fd, &ring, &shared, &w)) {
+                restarts++;
+            } else {
+                respawn_ns = clock_now_ns() + (int64_t)SUPERVISOR_BACKOFF_MAX_MS * 1000000LL;
+            }
+        }
+    }
+
+    if (w.pid > 0) {
+        kill(w.pid, SIGTERM);
+        waitpid(w.pid, NULL, 0);
+        close(w.lifeline);
+        forward_batches(&ring, out_fd, &batches);
+    }
+    stop_motor(&w);
+    for (int i = 0; i < 2; ++i) {
+        irq_affinity_restore(&ring.shm->irq_prev[i], stderr);
+    }
+    fprintf(stderr, "Supervisor batches=%" PRIu64 " restarts=%" PRIu64 " max_recovery=%.1fms overflow=%" PRIu64 "\n",
+            batches, restarts, max_recovery_ns / 1e6, ring.shm->overflow_events);
+    event_ring_destroy(&ring);
+    control_close(&shared.control);
+    frame_ring_destroy(&shared.frames);
+    if (shared.keeper[0] >= 0) {
+        close(shared.keeper[0]);
+        close(shared.keeper[1]);
+    }
+    if (opts->event_sink) {
+        close(out_fd);
+    } else {
+        controller_destroy_device(out_fd);
+    }
+    return exit_code;
+}
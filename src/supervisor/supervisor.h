@@ -0,0 +1,23 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "../controller/controller.h"
+
+#define SUPERVISOR_STABLE_MS 1000        // A worker that lived this long is not crash-looping.
+#define SUPERVISOR_BACKOFF_MIN_MS 10
+#define SUPERVISOR_BACKOFF_MAX_MS 2000
+
+/**
+ * Run the daemon split in two processes. This process brings up the GPIOs, creates the
+ * uinput device (or opens --event-sink) and keeps both for its whole life. A forked worker
+ * reads the pads and handles FF; its reports come back as batches over a shared ring and
+ * are written to the device one batch per write(). When the worker dies, the rumble line
+ * is forced low and a new worker is forked at once (with backoff if it keeps dying early),
+ * continuing from the state the device last received. The device never re-enumerates.
+ *
+ * @param opts Runtime options (never NULL).
+ * @return process exit code.
+ */
+int supervisor_run(const controller_options_t *opts);
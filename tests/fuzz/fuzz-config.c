@@ -0,0 +1,52 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// libFuzzer entry point for config_parse_file(), reached through the calibration loader so
+// every pair also goes through the calibration key handler and its range checks.
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../../src/calibration/cross-axis.h"
+#include "../../src/config/config.h"
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    (void)argc;
+    (void)argv;
+    config_set_verbose(false);
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    // The loader takes a path; a memfd gives it one without touching the filesystem.
+    int fd = memfd_create("fuzz-config", MFD_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    if (write(fd, data, size) != (ssize_t)size) {
+        close(fd);
+        return 0;
+    }
+    char path[64];
+    snprintf(path, sizeof path, "/proc/self/fd/%d", fd);
+
+    joypad_cali_t c;
+    load_calibration_chain(NULL, path, NULL, "joypad.config", &c);
+    close(fd);
+
+    // Whatever the file said, the loader must hand back a usable calibration.
+    if (c.x_min > c.x_zero || c.x_zero > c.x_max || c.y_min > c.y_zero || c.y_zero > c.y_max ||
+        !cross_axis_valid(&c)) {
+        abort();
+    }
+    return 0;
+}
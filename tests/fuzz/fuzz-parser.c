@@ -0,0 +1,73 @@
+// Copyright 2025 Jose Pablo Ramirez (@Jpe230)
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// libFuzzer entry point for parseSerialFrames(): coverage-guided, so it reaches the
+// false-header rescan and partial-frame carry paths a blind mutation loop rarely hits.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/serial/serial-joystick.h"
+
+#define FUZZ_MAX_CHUNK 64
+
+static void check_frames(const serial_frame_t *frames, size_t count, size_t len)
+{
+    size_t prev_end = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const joypad_struct_t *j = &frames[i].pad;
+        if (j->header != 0xFF01 || j->x > 0x0FFF || j->y > 0x0FFF) {
+            abort();
+        }
+        // Frames complete in stream order, each at a later byte of the chunk.
+        if (frames[i].end > len || (i > 0 && frames[i].end <= prev_end)) {
+            abort();
+        }
+        prev_end = frames[i].end;
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size < 1) {
+        return 0;
+    }
+    // The first byte picks the read sizes, so the same stream is also split differently.
+    const size_t chunk_max = 1 + data[0] % FUZZ_MAX_CHUNK;
+    const uint8_t *stream = data + 1;
+    size_t len = size - 1;
+
+    serial_parser_t parser;
+    resetSerialParser(&parser);
+    serial_frame_t frames[SERIAL_FRAMES_MAX(FUZZ_MAX_CHUNK)];
+    for (size_t off = 0; off < len;) {
+        size_t chunk = 1 + (off * 31 + len) % chunk_max;
+        if (chunk > len - off) {
+            chunk = len - off;
+        }
+        size_t count = parseSerialFrames(&parser, stream + off, chunk, frames, SERIAL_FRAMES_MAX(chunk));
+        if (count > SERIAL_FRAMES_MAX(chunk) || parser.framePos >= SERIAL_FRAME_LEN) {
+            abort();
+        }
+        check_frames(frames, count, chunk);
+        off += chunk;
+    }
+
+    // Whatever came before, three clean frames must leave the parser on the last one.
+    static const uint8_t tail[3 * SERIAL_FRAME_LEN] = {
+        0xFF, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xFF, 0x01, 0x5A, 0x01, 0x23, 0x0A, 0xBC,
+        0xFF, 0x01, 0xA5, 0x08, 0x00, 0x07, 0xFF,
+    };
+    size_t count = parseSerialFrames(&parser, tail, sizeof tail, frames, SERIAL_FRAMES_MAX(sizeof tail));
+    if (count == 0) {
+        abort();
+    }
+    const joypad_struct_t *last = &frames[count - 1].pad;
+    if (frames[count - 1].end != sizeof tail || last->buttons.b != 0xA5 || last->x != 0x0800 || last->y != 0x07FF) {
+        abort();
+    }
+    return 0;
+}